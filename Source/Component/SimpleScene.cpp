@@ -132,9 +132,10 @@ void SimpleScene::ReloadShaders() const
 	cout << "=============================" << endl;
 	cout << endl;
 
+	// The shaders are rebuilt in the background, the current programs are used until then
 	for (auto &shader : shaders)
 	{
-		shader.second->Reload();
+		ShaderManager::RequestReload(shader.second);
 	}
 }
 
@@ -28,6 +28,11 @@ WindowObject* Engine::Init(WindowProperties & props)
 		exit(0);
 	}
 
+	AssetLoader::Init();
+	JobSystem::Init();
+	TextureCache::Init();
+	ShaderCache::Init();
+	ShaderManager::Init();
 	TextureManager::Init();
 
 	return window;
@@ -42,6 +47,9 @@ void Engine::Exit()
 {
 	cout << "=====================================================" << endl;
 	cout << "Engine closed. Exit" << endl;
+	AssetLoader::Shutdown();
+	JobSystem::Shutdown();
+	ShaderManager::Shutdown();
 	glfwTerminate();
 }
 
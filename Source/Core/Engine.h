@@ -20,6 +20,11 @@
 
 #include <Core/Managers/ResourcePath.h>
 #include <Core/Managers/TextureManager.h>
+#include <Core/Managers/AssetLoader.h>
+#include <Core/Managers/JobSystem.h>
+#include <Core/Managers/TextureCache.h>
+#include <Core/Managers/ShaderCache.h>
+#include <Core/Managers/ShaderManager.h>
 
 #include <Core/Window/WindowObject.h>
 #include <Core/Window/InputController.h>
@@ -0,0 +1,124 @@
+#include "FrameArena.h"
+
+#include <cstdint>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <include/math.h>
+
+using namespace std;
+
+FrameArena::FrameArena(size_t capacity)
+{
+	this->capacity = capacity;
+	memory = static_cast<char*>(::operator new(capacity));
+	offset = 0;
+	peak = 0;
+	overflow = nullptr;
+	overflows = 0;
+}
+
+FrameArena::~FrameArena()
+{
+	Reset();
+	::operator delete(memory);
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	uintptr_t address = reinterpret_cast<uintptr_t>(memory) + offset;
+	uintptr_t aligned = (address + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	size_t end = (size_t)(aligned - reinterpret_cast<uintptr_t>(memory)) + size;
+
+	if (end <= capacity) {
+		offset = end;
+		peak = MAX(peak, offset);
+		return reinterpret_cast<void*>(aligned);
+	}
+
+	// Too big for what is left, the block is allocated after a header chaining it to the others
+	// (with operator new, so it is counted with the other heap allocations)
+	size_t header = MAX(alignment, sizeof(void*));
+	char *block = static_cast<char*>(::operator new(header + size));
+
+	*reinterpret_cast<void**>(block) = overflow;
+	overflow = block;
+	overflows++;
+	return block + header;
+}
+
+void FrameArena::Reset()
+{
+	offset = 0;
+
+	while (overflow) {
+		void *next = *reinterpret_cast<void**>(overflow);
+		::operator delete(overflow);
+		overflow = next;
+	}
+}
+
+size_t FrameArena::GetUsed() const
+{
+	return offset;
+}
+
+size_t FrameArena::GetPeak() const
+{
+	return peak;
+}
+
+unsigned int FrameArena::GetOverflows() const
+{
+	return overflows;
+}
+
+#ifdef COUNT_ALLOCATIONS
+
+// Replaces the global operator new, the arrays and the deletes go through these too
+static thread_local unsigned long long threadAllocations = 0;
+static atomic<unsigned long long> allocations(0);
+
+void* operator new(size_t size)
+{
+	threadAllocations++;
+	allocations.fetch_add(1, memory_order_relaxed);
+	void *pointer = malloc(size ? size : 1);
+	if (!pointer) throw bad_alloc();
+	return pointer;
+}
+
+void operator delete(void *pointer) noexcept
+{
+	free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+	free(pointer);
+}
+
+unsigned long long GetThreadAllocations()
+{
+	return threadAllocations;
+}
+
+unsigned long long GetAllocations()
+{
+	return allocations.load(memory_order_relaxed);
+}
+
+#else
+
+unsigned long long GetThreadAllocations()
+{
+	return 0;
+}
+
+unsigned long long GetAllocations()
+{
+	return 0;
+}
+
+#endif
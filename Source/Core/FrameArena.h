@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+#include <include/span.h>
+
+// Size of the memory of a frame arena, the allocations past it go to the heap
+#define FRAME_ARENA_SIZE	(64 * 1024)
+
+// Hands out the memory of the short-lived containers of a frame
+// An allocation only moves an offset in a block allocated once, and everything is freed at once
+// when the arena is reset at the start of the next frame. Nothing is destroyed: only trivially
+// destructible values are allocated. An arena is used by one thread at a time.
+class FrameArena
+{
+	public:
+		FrameArena(size_t capacity = FRAME_ARENA_SIZE);
+		~FrameArena();
+
+		FrameArena(const FrameArena &) = delete;
+		FrameArena& operator=(const FrameArena &) = delete;
+
+		void* Allocate(size_t size, size_t alignment);
+
+		// An uninitialized array of "count" values
+		template <class T>
+		Span<T> Allocate(size_t count)
+		{
+			static_assert(std::is_trivially_destructible<T>::value, "The arena doesn't destroy its values");
+			return Span<T>(static_cast<T*>(Allocate(count * sizeof(T), alignof(T))), count);
+		}
+
+		// Frees everything allocated since the last reset
+		void Reset();
+
+		// The memory used since the last reset, the most used in a frame, and the allocations that didn't fit
+		size_t GetUsed() const;
+		size_t GetPeak() const;
+		unsigned int GetOverflows() const;
+
+	private:
+		char *memory;
+		size_t capacity;
+		size_t offset;
+		size_t peak;
+
+		// The allocations that didn't fit, chained through their first bytes and freed on reset
+		void *overflow;
+		unsigned int overflows;
+};
+
+// The heap allocations (operator new) made by the calling thread so far, and by all the threads
+// Only counted when built with COUNT_ALLOCATIONS (the Debug configurations), 0 otherwise
+unsigned long long GetThreadAllocations();
+unsigned long long GetAllocations();
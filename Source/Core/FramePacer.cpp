@@ -0,0 +1,184 @@
+#include "FramePacer.h"
+
+#include <cmath>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+	#pragma comment(lib, "winmm.lib")
+#endif
+
+#include <Core/Engine.h>
+
+using namespace std;
+
+FramePacer::FramePacer()
+{
+	targetPeriod = 0;
+	nextFrameTime = 0;
+	previousFrameTime = -1;
+	timerPeriodRaised = false;
+
+	maxFramesInFlight = 0;
+	fenceIndex = 0;
+	for (auto &fence : fences)
+		fence = 0;
+}
+
+FramePacer::~FramePacer()
+{
+	SetTargetRate(0);
+}
+
+void FramePacer::SetTargetRate(double framesPerSecond)
+{
+	targetPeriod = framesPerSecond > 0 ? 1.0 / framesPerSecond : 0;
+	nextFrameTime = 0;
+
+#ifdef _WIN32
+	// The default timer of Windows wakes the sleeping threads every 15.6 ms. The period is raised
+	// once, and released when the frames aren't paced anymore (it is global to the system)
+	bool raise = targetPeriod > 0;
+	if (raise != timerPeriodRaised)
+	{
+		if (raise)
+			timeBeginPeriod(1);
+		else
+			timeEndPeriod(1);
+		timerPeriodRaised = raise;
+	}
+#endif
+}
+
+double FramePacer::GetTargetRate() const
+{
+	return targetPeriod > 0 ? 1.0 / targetPeriod : 0;
+}
+
+void FramePacer::SetMaxFramesInFlight(unsigned int frames)
+{
+	maxFramesInFlight = min(frames, (unsigned int)PACER_MAX_FRAMES_IN_FLIGHT);
+}
+
+void FramePacer::WaitForFrame()
+{
+	double now = Engine::GetElapsedTime();
+	double sleepTime = 0;
+	double spinTime = 0;
+	bool missed = false;
+
+	if (targetPeriod > 0)
+	{
+		if (nextFrameTime == 0)
+			nextFrameTime = now;
+
+		// A frame late by more than a period isn't caught up, the pacing starts again from now
+		missed = now > nextFrameTime;
+		if (now > nextFrameTime + targetPeriod)
+			nextFrameTime = now;
+
+		// Sleep until shortly before the deadline, then spin
+		while (now < nextFrameTime)
+		{
+			double remaining = nextFrameTime - now;
+			if (remaining > PACER_SPIN_TIME) {
+				this_thread::sleep_for(chrono::duration<double>(remaining - PACER_SPIN_TIME));
+				double woken = Engine::GetElapsedTime();
+				sleepTime += woken - now;
+				now = woken;
+			}
+			else {
+				this_thread::yield();
+				double spun = Engine::GetElapsedTime();
+				spinTime += spun - now;
+				now = spun;
+			}
+		}
+
+		nextFrameTime += targetPeriod;
+	}
+
+	lock_guard<mutex> lock(statisticsMutex);
+	if (previousFrameTime >= 0)
+	{
+		double period = now - previousFrameTime;
+		statistics.frames++;
+		statistics.periodSum += period;
+		statistics.periodSquares += period * period;
+		statistics.worstPeriod = max(statistics.worstPeriod, period);
+	}
+	if (missed)
+		statistics.missed++;
+	statistics.sleepTime += sleepTime;
+	statistics.spinTime += spinTime;
+	previousFrameTime = now;
+}
+
+void FramePacer::WaitForGPU()
+{
+	// The oldest fence, put maxFramesInFlight frames ago
+	GLsync &fence = fences[fenceIndex];
+	if (!maxFramesInFlight || !fence)
+		return;
+
+	double start = Engine::GetElapsedTime();
+	GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	while (status == GL_TIMEOUT_EXPIRED) {
+		// Checked every half millisecond
+		status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 500000);
+	}
+	double waited = Engine::GetElapsedTime() - start;
+
+	glDeleteSync(fence);
+	fence = 0;
+
+	lock_guard<mutex> lock(statisticsMutex);
+	statistics.gpuWaitTime += waited;
+	statistics.gpuWaits++;
+}
+
+void FramePacer::FenceFrame()
+{
+	if (!maxFramesInFlight)
+		return;
+
+	GLsync &fence = fences[fenceIndex];
+	if (fence)
+		glDeleteSync(fence);
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	fenceIndex = (fenceIndex + 1) % maxFramesInFlight;
+}
+
+void FramePacer::PrintStatistics()
+{
+	PacingStatistics printed;
+	{
+		lock_guard<mutex> lock(statisticsMutex);
+		printed = statistics;
+		statistics = PacingStatistics();
+	}
+
+	if (!printed.frames) {
+		cout << "Frame pacing: no frames yet" << endl;
+		return;
+	}
+
+	double average = printed.periodSum / printed.frames;
+	double jitter = sqrt(max(0.0, printed.periodSquares / printed.frames - average * average));
+
+	cout << "Frame pacing: " << average * 1000 << " ms per frame (" << 1 / average << " fps";
+	if (targetPeriod > 0)
+		cout << ", target " << GetTargetRate();
+	cout << "), jitter " << jitter * 1000 << " ms, worst " << printed.worstPeriod * 1000 << " ms, "
+		<< printed.missed << " late frames out of " << printed.frames << endl;
+	cout << "    waiting " << printed.sleepTime * 1000 / printed.frames << " ms asleep and "
+		<< printed.spinTime * 1000 / printed.frames << " ms spinning per frame";
+	if (printed.gpuWaits)
+		cout << ", " << printed.gpuWaitTime * 1000 / printed.gpuWaits << " ms for the GPU (" << maxFramesInFlight << " frames in flight)";
+	cout << endl;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <mutex>
+
+#include <include/gl.h>
+
+// The most frames the GPU can be given before the CPU waits for it
+#define PACER_MAX_FRAMES_IN_FLIGHT	4
+
+// The end of a wait is spun instead of slept, the sleeps of the OS overshoot by about a millisecond
+#define PACER_SPIN_TIME				0.002
+
+// How the frames were paced since the last print (times in seconds)
+struct PacingStatistics
+{
+	unsigned int frames = 0;
+
+	// The time between the starts of the frames: the sum, the sum of the squares (for the jitter) and the worst one
+	double periodSum = 0;
+	double periodSquares = 0;
+	double worstPeriod = 0;
+
+	// The frames that started after their deadline
+	unsigned int missed = 0;
+
+	// The time spent sleeping and spinning before the frames
+	double sleepTime = 0;
+	double spinTime = 0;
+
+	// The time the OpenGL thread waited for the GPU, to keep the frames in flight under the limit
+	double gpuWaitTime = 0;
+	unsigned int gpuWaits = 0;
+};
+
+// Paces the frames of the main loop
+// The main thread waits for the start of each frame at a target rate: it sleeps most of the wait
+// and spins the end of it, so it neither burns a core nor misses the deadline by a scheduler tick.
+// The frame samples the input right after the wait, as late as possible.
+// The OpenGL thread puts a fence after each swap, and waits for the fence of the frame N frames
+// before it, so the CPU never gets more than N frames ahead of the GPU (without a glFinish).
+class FramePacer
+{
+	public:
+		FramePacer();
+		~FramePacer();
+
+		FramePacer(const FramePacer &) = delete;
+		FramePacer& operator=(const FramePacer &) = delete;
+
+		// 0 doesn't wait (the swap interval paces the frames, with vSync)
+		void SetTargetRate(double framesPerSecond);
+		double GetTargetRate() const;
+
+		// 0 doesn't limit them, at most PACER_MAX_FRAMES_IN_FLIGHT. Set before the first frame
+		void SetMaxFramesInFlight(unsigned int frames);
+
+		// Main thread: waits for the start of the next frame
+		void WaitForFrame();
+
+		// OpenGL thread: waits for the GPU to finish the frame N frames before (before drawing),
+		// and puts the fence of the frame (after its swap)
+		void WaitForGPU();
+		void FenceFrame();
+
+		// Prints the statistics since the last print, and starts measuring again
+		void PrintStatistics();
+
+	private:
+		double targetPeriod;
+		double nextFrameTime;
+		double previousFrameTime;
+
+		// The 1 ms timer period of Windows is raised while there is a target rate
+		bool timerPeriodRaised;
+
+		unsigned int maxFramesInFlight;
+		GLsync fences[PACER_MAX_FRAMES_IN_FLIGHT];
+		unsigned int fenceIndex;
+
+		// Measured on the main thread and the OpenGL thread
+		std::mutex statisticsMutex;
+		PacingStatistics statistics;
+};
@@ -0,0 +1,301 @@
+#include "CommandBuffer.h"
+
+#include <cstring>
+
+using namespace std;
+
+CommandState::CommandState() : generation(0)
+{
+	memset(textures, 0, sizeof(textures));
+	memset(programs, 0, sizeof(programs));
+	Reset();
+}
+
+void CommandState::Reset()
+{
+	executed = 0;
+	skipped = 0;
+	program = 0;
+	vertexArray = 0;
+	programCount = 0;
+	currentUniforms = nullptr;
+
+	// The entries are stale once the generation changed (they are cleared when it wraps around)
+	if (++generation == 0) {
+		memset(textures, 0, sizeof(textures));
+		memset(programs, 0, sizeof(programs));
+		generation = 1;
+	}
+}
+
+void CommandState::SelectProgram(GLuint program)
+{
+	for (unsigned int i = 0; i < programCount; i++) {
+		if (programs[i].program == program) {
+			currentUniforms = &programs[i];
+			return;
+		}
+	}
+
+	currentUniforms = nullptr;
+	if (programCount == COMMAND_STATE_PROGRAMS)
+		return;
+
+	// The slot was last filled before the reset, its uniforms are all stale
+	currentUniforms = &programs[programCount++];
+	currentUniforms->program = program;
+}
+
+void CommandState::Finish()
+{
+	if (vertexArray) {
+		glBindVertexArray(0);
+		vertexArray = 0;
+	}
+}
+
+CommandBuffer::CommandBuffer() : commandCount(0)
+{
+}
+
+void CommandBuffer::Clear()
+{
+	data.clear();
+	commandCount = 0;
+}
+
+bool CommandBuffer::IsEmpty() const
+{
+	return commandCount == 0;
+}
+
+unsigned int CommandBuffer::GetCommandCount() const
+{
+	return commandCount;
+}
+
+size_t CommandBuffer::GetSize() const
+{
+	return data.size();
+}
+
+void CommandBuffer::Write(CommandType type, const void *arguments, size_t size)
+{
+	CommandHeader header = { type, (unsigned short)size };
+
+	size_t offset = data.size();
+	data.resize(offset + sizeof(CommandHeader) + size);
+	memcpy(&data[offset], &header, sizeof(CommandHeader));
+	if (size) memcpy(&data[offset + sizeof(CommandHeader)], arguments, size);
+
+	commandCount++;
+}
+
+void CommandBuffer::UseProgram(GLuint program)
+{
+	Write(CommandType::USE_PROGRAM, &program, sizeof(program));
+}
+
+void CommandBuffer::SetUniform(GLint location, int value)
+{
+	if (location < 0) return;
+
+	unsigned char arguments[sizeof(GLint) + sizeof(value)];
+	memcpy(arguments, &location, sizeof(GLint));
+	memcpy(arguments + sizeof(GLint), &value, sizeof(value));
+	Write(CommandType::UNIFORM_1I, arguments, sizeof(arguments));
+}
+
+void CommandBuffer::SetUniform(GLint location, float value)
+{
+	if (location < 0) return;
+
+	unsigned char arguments[sizeof(GLint) + sizeof(value)];
+	memcpy(arguments, &location, sizeof(GLint));
+	memcpy(arguments + sizeof(GLint), &value, sizeof(value));
+	Write(CommandType::UNIFORM_1F, arguments, sizeof(arguments));
+}
+
+void CommandBuffer::SetUniform(GLint location, const glm::vec3 &value)
+{
+	if (location < 0) return;
+
+	unsigned char arguments[sizeof(GLint) + sizeof(glm::vec3)];
+	memcpy(arguments, &location, sizeof(GLint));
+	memcpy(arguments + sizeof(GLint), glm::value_ptr(value), sizeof(glm::vec3));
+	Write(CommandType::UNIFORM_3F, arguments, sizeof(arguments));
+}
+
+void CommandBuffer::SetUniform(GLint location, const glm::vec4 &value)
+{
+	if (location < 0) return;
+
+	unsigned char arguments[sizeof(GLint) + sizeof(glm::vec4)];
+	memcpy(arguments, &location, sizeof(GLint));
+	memcpy(arguments + sizeof(GLint), glm::value_ptr(value), sizeof(glm::vec4));
+	Write(CommandType::UNIFORM_4F, arguments, sizeof(arguments));
+}
+
+void CommandBuffer::SetUniform(GLint location, const glm::mat4 &value)
+{
+	if (location < 0) return;
+
+	unsigned char arguments[sizeof(GLint) + sizeof(glm::mat4)];
+	memcpy(arguments, &location, sizeof(GLint));
+	memcpy(arguments + sizeof(GLint), glm::value_ptr(value), sizeof(glm::mat4));
+	Write(CommandType::UNIFORM_MATRIX_4F, arguments, sizeof(arguments));
+}
+
+void CommandBuffer::BindVertexArray(GLuint vertexArray)
+{
+	Write(CommandType::BIND_VERTEX_ARRAY, &vertexArray, sizeof(vertexArray));
+}
+
+void CommandBuffer::BindTexture(GLenum textureUnit, GLuint texture)
+{
+	TextureArguments arguments = { textureUnit, texture };
+	Write(CommandType::BIND_TEXTURE, &arguments, sizeof(arguments));
+}
+
+void CommandBuffer::DrawElements(GLenum mode, GLsizei count, GLuint firstIndex, GLint baseVertex, GLsizei instances)
+{
+	DrawArguments arguments = { mode, count, firstIndex, baseVertex, instances };
+	Write(CommandType::DRAW_ELEMENTS, &arguments, sizeof(arguments));
+}
+
+void CommandBuffer::BeginConditionalRender(GLuint query)
+{
+	Write(CommandType::BEGIN_CONDITIONAL_RENDER, &query, sizeof(query));
+}
+
+void CommandBuffer::EndConditionalRender()
+{
+	Write(CommandType::END_CONDITIONAL_RENDER, nullptr, 0);
+}
+
+bool CommandBuffer::CacheUniform(CommandState &state, GLint location, const unsigned char *value, size_t size)
+{
+	// Past the table, the uniform is always set
+	if (!state.currentUniforms || location >= COMMAND_STATE_LOCATIONS)
+		return true;
+
+	auto &cached = state.currentUniforms->uniforms[location];
+	if (cached.generation == state.generation && cached.size == size && !memcmp(cached.data, value, size))
+		return false;
+
+	cached.generation = state.generation;
+	cached.size = (unsigned char)size;
+	memcpy(cached.data, value, size);
+	return true;
+}
+
+void CommandBuffer::Execute(CommandState &state) const
+{
+	size_t offset = 0;
+	while (offset < data.size())
+	{
+		CommandHeader header;
+		memcpy(&header, &data[offset], sizeof(CommandHeader));
+		const unsigned char *arguments = &data[offset + sizeof(CommandHeader)];
+		offset += sizeof(CommandHeader) + header.size;
+
+		// The arguments aren't aligned in the stream, they are copied out
+		bool execute = true;
+		switch (header.type)
+		{
+			case CommandType::USE_PROGRAM:
+			{
+				GLuint program;
+				memcpy(&program, arguments, sizeof(program));
+				execute = program != state.program;
+				if (execute) {
+					glUseProgram(program);
+					state.program = program;
+					state.SelectProgram(program);
+				}
+			} break;
+
+			case CommandType::UNIFORM_1I:
+			case CommandType::UNIFORM_1F:
+			case CommandType::UNIFORM_3F:
+			case CommandType::UNIFORM_4F:
+			case CommandType::UNIFORM_MATRIX_4F:
+			{
+				GLint location;
+				memcpy(&location, arguments, sizeof(GLint));
+				const unsigned char *value = arguments + sizeof(GLint);
+				size_t size = header.size - sizeof(GLint);
+
+				execute = CacheUniform(state, location, value, size);
+				if (!execute) break;
+
+				float values[16];
+				memcpy(values, value, size);
+				if (header.type == CommandType::UNIFORM_1I) {
+					int integer;
+					memcpy(&integer, value, sizeof(integer));
+					glUniform1i(location, integer);
+				}
+				else if (header.type == CommandType::UNIFORM_1F)
+					glUniform1f(location, values[0]);
+				else if (header.type == CommandType::UNIFORM_3F)
+					glUniform3fv(location, 1, values);
+				else if (header.type == CommandType::UNIFORM_4F)
+					glUniform4fv(location, 1, values);
+				else
+					glUniformMatrix4fv(location, 1, GL_FALSE, values);
+			} break;
+
+			case CommandType::BIND_VERTEX_ARRAY:
+			{
+				GLuint vertexArray;
+				memcpy(&vertexArray, arguments, sizeof(vertexArray));
+				execute = vertexArray != state.vertexArray;
+				if (execute) {
+					glBindVertexArray(vertexArray);
+					state.vertexArray = vertexArray;
+				}
+			} break;
+
+			case CommandType::BIND_TEXTURE:
+			{
+				TextureArguments texture;
+				memcpy(&texture, arguments, sizeof(texture));
+				unsigned int unit = texture.textureUnit - GL_TEXTURE0;
+				auto *bound = unit < COMMAND_STATE_TEXTURE_UNITS ? &state.textures[unit] : nullptr;
+				execute = !bound || bound->generation != state.generation || bound->texture != texture.texture;
+				if (execute) {
+					glActiveTexture(texture.textureUnit);
+					glBindTexture(GL_TEXTURE_2D, texture.texture);
+					if (bound) {
+						bound->generation = state.generation;
+						bound->texture = texture.texture;
+					}
+				}
+			} break;
+
+			case CommandType::DRAW_ELEMENTS:
+			{
+				DrawArguments draw;
+				memcpy(&draw, arguments, sizeof(draw));
+				glDrawElementsInstancedBaseVertex(draw.mode, draw.count, GL_UNSIGNED_SHORT,
+					(void*)(sizeof(unsigned short) * draw.firstIndex), draw.instances, draw.baseVertex);
+			} break;
+
+			case CommandType::BEGIN_CONDITIONAL_RENDER:
+			{
+				GLuint query;
+				memcpy(&query, arguments, sizeof(query));
+				glBeginConditionalRender(query, GL_QUERY_NO_WAIT);
+			} break;
+
+			case CommandType::END_CONDITIONAL_RENDER:
+			{
+				glEndConditionalRender();
+			} break;
+		}
+
+		if (execute) state.executed++;
+		else state.skipped++;
+	}
+}
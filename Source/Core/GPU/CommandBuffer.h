@@ -0,0 +1,157 @@
+#pragma once
+#include <vector>
+
+#include <include/gl.h>
+#include <include/glm.h>
+
+// The programs, uniform locations and texture units whose state the replay of a pass remembers,
+// the commands past them are always executed
+#define COMMAND_STATE_PROGRAMS		16
+#define COMMAND_STATE_LOCATIONS		64
+#define COMMAND_STATE_TEXTURE_UNITS	32
+
+// What the replay of the command buffers has set, the commands that wouldn't change it are skipped
+// It only knows the state set by the commands it replayed: reset it when the state may have been
+// changed by other GL calls in between (once per pass). The state lives in fixed tables, a reset
+// only bumps the generation of their entries, nothing is freed or allocated between the frames.
+class CommandState
+{
+	public:
+		CommandState();
+
+		void Reset();
+
+		// Unbinds the vertex array left bound by the replay
+		void Finish();
+
+	public:
+		// The commands replayed, and the ones skipped because they didn't change anything
+		unsigned int executed;
+		unsigned int skipped;
+
+	private:
+		friend class CommandBuffer;
+
+		// The value of a uniform of a program, stale when it was set in an older generation
+		struct UniformValue
+		{
+			unsigned int generation;
+			unsigned char size;
+			unsigned char data[sizeof(glm::mat4)];
+		};
+
+		struct BoundTexture
+		{
+			unsigned int generation;
+			GLuint texture;
+		};
+
+		// The uniforms of a program used since the reset, indexed by their location
+		struct ProgramUniforms
+		{
+			GLuint program;
+			UniformValue uniforms[COMMAND_STATE_LOCATIONS];
+		};
+
+		// Finds the uniforms of the program, or gives it the next slot of the table
+		void SelectProgram(GLuint program);
+
+		unsigned int generation;
+		GLuint program;
+		GLuint vertexArray;
+		BoundTexture textures[COMMAND_STATE_TEXTURE_UNITS];
+
+		// Filled in the order the programs are used after a reset
+		ProgramUniforms programs[COMMAND_STATE_PROGRAMS];
+		unsigned int programCount;
+
+		// The uniforms of the current program, null when the table is full
+		ProgramUniforms *currentUniforms;
+};
+
+// A list of OpenGL commands, recorded on any thread and replayed on the OpenGL thread
+// The commands are packed in a byte stream: a header with their type and size, followed by their
+// arguments. Nothing calls OpenGL while recording, the resources (programs, uniform locations,
+// vertex arrays) must be created before. The buffers are reused between the frames, clearing one
+// keeps its memory.
+class CommandBuffer
+{
+	public:
+		CommandBuffer();
+
+		void Clear();
+		bool IsEmpty() const;
+
+		// The number of commands, and of bytes they take
+		unsigned int GetCommandCount() const;
+		size_t GetSize() const;
+
+		void UseProgram(GLuint program);
+
+		// Uniforms of the current program, the ones with a location of -1 aren't recorded
+		void SetUniform(GLint location, int value);
+		void SetUniform(GLint location, float value);
+		void SetUniform(GLint location, const glm::vec3 &value);
+		void SetUniform(GLint location, const glm::vec4 &value);
+		void SetUniform(GLint location, const glm::mat4 &value);
+
+		void BindVertexArray(GLuint vertexArray);
+		void BindTexture(GLenum textureUnit, GLuint texture);
+
+		// glDrawElementsInstancedBaseVertex, with GL_UNSIGNED_SHORT indices starting at "firstIndex"
+		void DrawElements(GLenum mode, GLsizei count, GLuint firstIndex, GLint baseVertex, GLsizei instances = 1);
+
+		// The draws in between are discarded by the GPU if the query found no samples (GL_QUERY_NO_WAIT)
+		void BeginConditionalRender(GLuint query);
+		void EndConditionalRender();
+
+		// Replays the commands in order, skipping the ones that don't change the state
+		void Execute(CommandState &state) const;
+
+	private:
+		enum class CommandType : unsigned short
+		{
+			USE_PROGRAM,
+			UNIFORM_1I,
+			UNIFORM_1F,
+			UNIFORM_3F,
+			UNIFORM_4F,
+			UNIFORM_MATRIX_4F,
+			BIND_VERTEX_ARRAY,
+			BIND_TEXTURE,
+			DRAW_ELEMENTS,
+			BEGIN_CONDITIONAL_RENDER,
+			END_CONDITIONAL_RENDER,
+		};
+
+		struct CommandHeader
+		{
+			CommandType type;
+			// The size of the arguments, in bytes
+			unsigned short size;
+		};
+
+		struct TextureArguments
+		{
+			GLenum textureUnit;
+			GLuint texture;
+		};
+
+		struct DrawArguments
+		{
+			GLenum mode;
+			GLsizei count;
+			GLuint firstIndex;
+			GLint baseVertex;
+			GLsizei instances;
+		};
+
+		void Write(CommandType type, const void *arguments, size_t size);
+
+		// Sets a uniform, unless the program already has the same value
+		static bool CacheUniform(CommandState &state, GLint location, const unsigned char *value, size_t size);
+
+	private:
+		std::vector<unsigned char> data;
+		unsigned int commandCount;
+};
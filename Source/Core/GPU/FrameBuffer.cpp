@@ -0,0 +1,157 @@
+#include "FrameBuffer.h"
+
+#include <iostream>
+
+using namespace std;
+
+FrameBuffer::FrameBuffer()
+{
+	frameBufferID = 0;
+	depthTexture = 0;
+	depthFormat = 0;
+	depthCompare = false;
+	width = 0;
+	height = 0;
+}
+
+FrameBuffer::~FrameBuffer()
+{
+	Release();
+}
+
+void FrameBuffer::Release()
+{
+	if (colorTextures.size())
+		glDeleteTextures((GLsizei)colorTextures.size(), colorTextures.data());
+	if (depthTexture)
+		glDeleteTextures(1, &depthTexture);
+	if (frameBufferID)
+		glDeleteFramebuffers(1, &frameBufferID);
+
+	colorTextures.clear();
+	depthTexture = 0;
+	frameBufferID = 0;
+}
+
+bool FrameBuffer::Create(unsigned int width, unsigned int height, const vector<GLenum> &colorFormats, GLenum depthFormat, bool depthCompare)
+{
+	Release();
+
+	this->width = width;
+	this->height = height;
+	this->colorFormats = colorFormats;
+	this->depthFormat = depthFormat;
+	this->depthCompare = depthCompare;
+
+	glGenFramebuffers(1, &frameBufferID);
+	glBindFramebuffer(GL_FRAMEBUFFER, frameBufferID);
+
+	// The format of the data given to glTexImage2D doesn't matter, nothing is uploaded
+	colorTextures.resize(colorFormats.size());
+	vector<GLenum> drawBuffers;
+	if (colorTextures.size())
+		glGenTextures((GLsizei)colorTextures.size(), colorTextures.data());
+
+	for (unsigned int i = 0; i < colorTextures.size(); i++) {
+		glBindTexture(GL_TEXTURE_2D, colorTextures[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, colorFormats[i], width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, colorTextures[i], 0);
+		drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + i);
+	}
+
+	if (depthFormat) {
+		glGenTextures(1, &depthTexture);
+		glBindTexture(GL_TEXTURE_2D, depthTexture);
+		glTexImage2D(GL_TEXTURE_2D, 0, depthFormat, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, depthCompare ? GL_LINEAR : GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, depthCompare ? GL_LINEAR : GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		if (depthCompare) {
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+		}
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+	}
+
+	if (drawBuffers.size()) {
+		glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+	}
+	else {
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+	}
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		cout << "Frame buffer " << width << "x" << height << " is incomplete (status 0x" << hex << status << dec << ")" << endl;
+		Release();
+		return false;
+	}
+
+	CheckOpenGLError();
+	return true;
+}
+
+bool FrameBuffer::Resize(unsigned int width, unsigned int height)
+{
+	if (width == this->width && height == this->height && frameBufferID)
+		return true;
+
+	vector<GLenum> formats = colorFormats;
+	return Create(width, height, formats, depthFormat, depthCompare);
+}
+
+void FrameBuffer::Bind() const
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, frameBufferID);
+	glViewport(0, 0, width, height);
+}
+
+void FrameBuffer::BindDefault()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void FrameBuffer::BindTexture(unsigned int index, GLenum TextureUnit) const
+{
+	if (index >= colorTextures.size()) return;
+	glActiveTexture(TextureUnit);
+	glBindTexture(GL_TEXTURE_2D, colorTextures[index]);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void FrameBuffer::BindDepthTexture(GLenum TextureUnit) const
+{
+	if (!depthTexture) return;
+	glActiveTexture(TextureUnit);
+	glBindTexture(GL_TEXTURE_2D, depthTexture);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+GLuint FrameBuffer::GetFrameBufferID() const
+{
+	return frameBufferID;
+}
+
+GLuint FrameBuffer::GetTextureID(unsigned int index) const
+{
+	return index < colorTextures.size() ? colorTextures[index] : 0;
+}
+
+GLuint FrameBuffer::GetDepthTextureID() const
+{
+	return depthTexture;
+}
+
+glm::ivec2 FrameBuffer::GetResolution() const
+{
+	return glm::ivec2(width, height);
+}
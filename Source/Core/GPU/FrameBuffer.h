@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+
+#include <include/gl.h>
+#include <include/glm.h>
+
+// An off-screen render target, with color textures and an optional depth texture
+// The depth texture can be created with GL_COMPARE_REF_TO_TEXTURE, to be read through
+// a sampler2DShadow (shadow maps).
+class FrameBuffer
+{
+	public:
+		FrameBuffer();
+		~FrameBuffer();
+
+		// One color texture per format (none for a depth only target)
+		// depthFormat can be 0 for a target without depth
+		bool Create(unsigned int width, unsigned int height, const std::vector<GLenum> &colorFormats,
+					GLenum depthFormat = GL_DEPTH_COMPONENT24, bool depthCompare = false);
+
+		// Recreates the textures with a new size, keeping the formats
+		bool Resize(unsigned int width, unsigned int height);
+
+		// Binds the frame buffer and sets the viewport to cover it
+		void Bind() const;
+		static void BindDefault();
+
+		void BindTexture(unsigned int index, GLenum TextureUnit) const;
+		void BindDepthTexture(GLenum TextureUnit) const;
+
+		GLuint GetFrameBufferID() const;
+		GLuint GetTextureID(unsigned int index) const;
+		GLuint GetDepthTextureID() const;
+		glm::ivec2 GetResolution() const;
+
+	private:
+		void Release();
+
+	private:
+		GLuint frameBufferID;
+		std::vector<GLuint> colorTextures;
+		GLuint depthTexture;
+
+		std::vector<GLenum> colorFormats;
+		GLenum depthFormat;
+		bool depthCompare;
+
+		unsigned int width;
+		unsigned int height;
+};
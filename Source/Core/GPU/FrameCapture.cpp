@@ -0,0 +1,229 @@
+#include "FrameCapture.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <stb/stb_image_write.h>
+#include <Core/Managers/FileSystem.h>
+
+using namespace std;
+
+FrameCapture::FrameCapture()
+{
+	running = false;
+	format = Format::PNG_SEQUENCE;
+	width = 0;
+	height = 0;
+	oldest = 0;
+	inFlight = 0;
+	frameCount = 0;
+	stopEncoder = false;
+	rawFile = nullptr;
+
+	for (int i = 0; i < CAPTURE_PBO_COUNT; i++) {
+		pixelBuffers[i] = 0;
+		fences[i] = 0;
+		frameIndices[i] = 0;
+	}
+}
+
+FrameCapture::~FrameCapture()
+{
+	Stop();
+}
+
+bool FrameCapture::Start(const string &path, Format format, unsigned int width, unsigned int height)
+{
+	if (running) Stop();
+
+	this->path = path;
+	this->format = format;
+	this->width = width;
+	this->height = height;
+	oldest = 0;
+	inFlight = 0;
+	frameCount = 0;
+
+	FileSystem::CreateDirectories(path);
+
+	if (format == Format::RAW_VIDEO) {
+		string file = path + "/capture_" + to_string(width) + "x" + to_string(height) + ".rgba";
+		rawFile = fopen(file.c_str(), "wb");
+		if (!rawFile) {
+			cout << "Could not create the capture file " << file << endl;
+			return false;
+		}
+	}
+
+	// GL_STREAM_READ: written by the GPU, read once by the application
+	glGenBuffers(CAPTURE_PBO_COUNT, pixelBuffers);
+	for (int i = 0; i < CAPTURE_PBO_COUNT; i++) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[i]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	stopEncoder = false;
+	encoder = thread(&FrameCapture::EncoderLoop, this);
+	running = true;
+
+	cout << "Capturing " << width << "x" << height << " frames to " << path << endl;
+	return true;
+}
+
+void FrameCapture::Capture(GLuint frameBuffer)
+{
+	if (!running) return;
+
+	// The ring is full, the oldest read must be done before its buffer is reused
+	if (inFlight == CAPTURE_PBO_COUNT) {
+		Collect(true);
+	}
+
+	// Also collect the reads that already finished, without waiting
+	while (inFlight && Collect(false));
+
+	unsigned int slot = (oldest + inFlight) % CAPTURE_PBO_COUNT;
+
+	GLint previousFrameBuffer;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousFrameBuffer);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, frameBuffer);
+	glReadBuffer(frameBuffer ? GL_COLOR_ATTACHMENT0 : GL_BACK);
+
+	// With a pixel pack buffer bound, the read is queued and returns immediately
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[slot]);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, previousFrameBuffer);
+
+	fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	frameIndices[slot] = frameCount++;
+	inFlight++;
+}
+
+bool FrameCapture::Collect(bool wait)
+{
+	if (!inFlight) return false;
+
+	GLsync &fence = fences[oldest];
+	GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GL_TIMEOUT_IGNORED : 0);
+	if (status == GL_TIMEOUT_EXPIRED) return false;
+
+	glDeleteSync(fence);
+	fence = 0;
+
+	Frame frame;
+	frame.index = frameIndices[oldest];
+	frame.pixels.resize((size_t)width * height * 4);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[oldest]);
+	void *data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frame.pixels.size(), GL_MAP_READ_BIT);
+	if (data) {
+		memcpy(frame.pixels.data(), data, frame.pixels.size());
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	oldest = (oldest + 1) % CAPTURE_PBO_COUNT;
+	inFlight--;
+
+	if (!data) return true;
+
+	// Don't let the encoder fall too far behind, the frames would pile up in memory
+	unique_lock<mutex> lock(pendingMutex);
+	pendingCondition.wait(lock, [this] { return pending.size() < CAPTURE_MAX_PENDING; });
+	pending.push_back(move(frame));
+	lock.unlock();
+	pendingCondition.notify_all();
+
+	return true;
+}
+
+void FrameCapture::Stop()
+{
+	if (!running) return;
+
+	while (inFlight) {
+		Collect(true);
+	}
+
+	{
+		lock_guard<mutex> lock(pendingMutex);
+		stopEncoder = true;
+	}
+	pendingCondition.notify_all();
+	encoder.join();
+
+	glDeleteBuffers(CAPTURE_PBO_COUNT, pixelBuffers);
+	for (int i = 0; i < CAPTURE_PBO_COUNT; i++) {
+		pixelBuffers[i] = 0;
+	}
+
+	if (rawFile) {
+		fclose(rawFile);
+		rawFile = nullptr;
+	}
+
+	running = false;
+	cout << "Captured " << frameCount << " frames to " << path << endl;
+}
+
+bool FrameCapture::IsRunning() const
+{
+	return running;
+}
+
+unsigned int FrameCapture::GetFrameCount() const
+{
+	return frameCount;
+}
+
+void FrameCapture::EncoderLoop()
+{
+	while (true) {
+		Frame frame;
+
+		{
+			unique_lock<mutex> lock(pendingMutex);
+			pendingCondition.wait(lock, [this] { return stopEncoder || !pending.empty(); });
+
+			// Finish the queued frames before stopping
+			if (pending.empty()) break;
+
+			frame = move(pending.front());
+			pending.pop_front();
+		}
+		pendingCondition.notify_all();
+
+		Encode(frame);
+	}
+}
+
+void FrameCapture::Encode(Frame &frame)
+{
+	// OpenGL reads the bottom row first
+	const size_t rowSize = (size_t)width * 4;
+	vector<unsigned char> row(rowSize);
+	for (unsigned int y = 0; y < height / 2; y++) {
+		unsigned char *top = &frame.pixels[y * rowSize];
+		unsigned char *bottom = &frame.pixels[(height - 1 - y) * rowSize];
+		memcpy(row.data(), top, rowSize);
+		memcpy(top, bottom, rowSize);
+		memcpy(bottom, row.data(), rowSize);
+	}
+
+	if (format == Format::RAW_VIDEO) {
+		fwrite(frame.pixels.data(), 1, frame.pixels.size(), rawFile);
+		return;
+	}
+
+	char name[32];
+	sprintf(name, "/frame_%06u.png", frame.index);
+	string file = path + name;
+	if (!stbi_write_png(file.c_str(), width, height, 4, frame.pixels.data(), (int)rowSize)) {
+		cout << "Could not write " << file << endl;
+	}
+}
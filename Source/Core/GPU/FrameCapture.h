@@ -0,0 +1,84 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include <include/gl.h>
+
+// Number of pixel buffers the frames are read into, a frame is mapped this many frames after it was read
+#define CAPTURE_PBO_COUNT		3
+// Frames waiting to be encoded, Capture blocks when the encoder is this far behind
+#define CAPTURE_MAX_PENDING		8
+
+// Records the frames rendered in a frame buffer without stalling the pipeline
+// glReadPixels writes into a ring of pixel buffer objects, so the copy is done by the GPU in the
+// background. A fence marks each read, and the buffer is only mapped once its fence signaled (a
+// few frames later). The pixels are then flipped and written to disk by an encoder thread.
+class FrameCapture
+{
+	public:
+		enum class Format
+		{
+			// One PNG per frame, "<path>/frame_000000.png"
+			PNG_SEQUENCE,
+			// All the frames in one file of raw RGBA pixels (top row first), "<path>/capture_<width>x<height>.rgba"
+			// ffmpeg -f rawvideo -pix_fmt rgba -s <width>x<height> -i capture.rgba capture.mp4
+			RAW_VIDEO
+		};
+
+	public:
+		FrameCapture();
+		~FrameCapture();
+
+		// Starts the encoder, the output directory is created if it's missing
+		bool Start(const std::string &path, Format format, unsigned int width, unsigned int height);
+
+		// Reads the color attachment 0 of a frame buffer (0 for the default one), its size must be the one given to Start
+		void Capture(GLuint frameBuffer);
+
+		// Waits for the frames in flight and the encoder
+		void Stop();
+
+		bool IsRunning() const;
+		unsigned int GetFrameCount() const;
+
+	private:
+		struct Frame
+		{
+			unsigned int index;
+			std::vector<unsigned char> pixels;
+		};
+
+		// Maps the oldest pixel buffer and queues its frame, waiting for its fence if "wait" is set
+		bool Collect(bool wait);
+
+		void EncoderLoop();
+		void Encode(Frame &frame);
+
+	private:
+		bool running;
+		Format format;
+		std::string path;
+		unsigned int width;
+		unsigned int height;
+
+		GLuint pixelBuffers[CAPTURE_PBO_COUNT];
+		GLsync fences[CAPTURE_PBO_COUNT];
+		unsigned int frameIndices[CAPTURE_PBO_COUNT];
+
+		// The ring: "inFlight" reads starting at "oldest"
+		unsigned int oldest;
+		unsigned int inFlight;
+		unsigned int frameCount;
+
+		std::thread encoder;
+		std::deque<Frame> pending;
+		std::mutex pendingMutex;
+		std::condition_variable pendingCondition;
+		bool stopEncoder;
+
+		FILE *rawFile;
+};
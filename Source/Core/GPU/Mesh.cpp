@@ -2,7 +2,9 @@
 
 #include <include/utils.h>
 
+#include <Core/GPU/Shader.h>
 #include <Core/GPU/GPUBuffers.h>
+#include <Core/GPU/CommandBuffer.h>
 #include <Core/GPU/Texture2D.h>
 #include <Core/Managers/TextureManager.h>
 
@@ -48,6 +50,11 @@ void Mesh::ClearData()
 }
 
 bool Mesh::LoadMesh(const string& fileLocation, const string& fileName)
+{
+	return ReadMeshFile(fileLocation, fileName) && UploadToGPU();
+}
+
+bool Mesh::ReadMeshFile(const string& fileLocation, const string& fileName)
 {
 	ClearData();
 	this->fileLocation = fileLocation;
@@ -70,6 +77,21 @@ bool Mesh::LoadMesh(const string& fileLocation, const string& fileName)
 	return false;
 }
 
+bool Mesh::UploadToGPU()
+{
+	// The textures are loaded in the background as well, until then the default one is used
+	for (auto material : materials) {
+		if (material && !material->textureFile.empty()) {
+			material->texture = TextureManager::LoadTexture(fileLocation, material->textureFile.c_str());
+		}
+	}
+	CheckOpenGLError();
+
+	buffers->ReleaseMemory();
+	*buffers = UtilsGPU::UploadData(positions, normals, texCoords, indices);
+	return buffers->VAO != 0;
+}
+
 void Mesh::InitFromData()
 {
 	meshEntries.clear();
@@ -171,9 +193,7 @@ bool Mesh::InitFromScene(const aiScene* pScene)
 	if (useMaterial && !InitMaterials(pScene))
 		return false;
 
-	buffers->ReleaseMemory();
-	*buffers = UtilsGPU::UploadData(positions, normals, texCoords, indices);
-	return buffers->VAO != 0;
+	return true;
 }
 
 void Mesh::InitMesh(const aiMesh* paiMesh)
@@ -217,7 +237,7 @@ bool Mesh::InitMaterials(const aiScene* pScene)
 			aiString Path;
 			if (pMaterial->GetTexture(aiTextureType_DIFFUSE, 0, &Path, NULL, NULL, NULL, NULL, NULL) == AI_SUCCESS)
 			{
-				materials[i]->texture = TextureManager::LoadTexture(fileLocation, Path.data);
+				materials[i]->textureFile = Path.data;
 			}
 		}
 
@@ -234,7 +254,6 @@ bool Mesh::InitMaterials(const aiScene* pScene)
 			memcpy(&materials[i]->emissive, &color, sizeof(color));
 	}
 
-	CheckOpenGLError();
 	return ret;
 }
 
@@ -255,13 +274,16 @@ void Mesh::UseMaterials(bool value)
 
 void Mesh::Render() const
 {
+	// Not uploaded yet (still loading in the background)
+	if (!buffers->VAO) return;
+
 	glBindVertexArray(buffers->VAO);
 	for (unsigned int i = 0; i < meshEntries.size(); i++)
 	{
 		if (useMaterial)
 		{
 			auto materialIndex = meshEntries[i].materialIndex;
-			if (materialIndex != INVALID_MATERIAL && materials[materialIndex]->texture)
+			if (materialIndex != INVALID_MATERIAL && materials[materialIndex]->texture && materials[materialIndex]->texture->GetTextureID())
 			{
 				(materials[materialIndex]->texture)->BindToTextureUnit(GL_TEXTURE0);
 			}
@@ -276,3 +298,70 @@ void Mesh::Render() const
 	}
 	glBindVertexArray(0);
 }
+
+void Mesh::Render(GLint textureLayerLocation) const
+{
+	// Not uploaded yet (still loading in the background)
+	if (!buffers->VAO) return;
+
+	// Start with a value that no texture can have, so the first entry always sets the uniform
+	int currentLayer = INVALID_LOC - 1;
+
+	glBindVertexArray(buffers->VAO);
+	for (unsigned int i = 0; i < meshEntries.size(); i++)
+	{
+		// Shaders that don't sample the texture array don't get any texture state
+		if (useMaterial && textureLayerLocation != INVALID_LOC)
+		{
+			auto materialIndex = meshEntries[i].materialIndex;
+			Texture2D *texture = TextureManager::GetTexture(static_cast<unsigned int>(0));
+			if (materialIndex != INVALID_MATERIAL && materials[materialIndex]->texture && materials[materialIndex]->texture->GetTextureID())
+			{
+				texture = materials[materialIndex]->texture;
+			}
+
+			int layer = texture->GetArrayLayer();
+			if (layer < 0) {
+				texture->BindToTextureUnit(GL_TEXTURE0);
+			}
+			if (layer != currentLayer) {
+				glUniform1i(textureLayerLocation, layer);
+				currentLayer = layer;
+			}
+		}
+
+		glDrawElementsBaseVertex(glDrawMode, meshEntries[i].nrIndices,
+			GL_UNSIGNED_SHORT, (void*)(sizeof(unsigned short) * meshEntries[i].baseIndex),
+			meshEntries[i].baseVertex);
+	}
+	glBindVertexArray(0);
+}
+
+void Mesh::Record(CommandBuffer &commands, GLint textureLayerLocation) const
+{
+	// Not uploaded yet (still loading in the background)
+	if (!buffers->VAO) return;
+
+	commands.BindVertexArray(buffers->VAO);
+	for (unsigned int i = 0; i < meshEntries.size(); i++)
+	{
+		if (useMaterial && textureLayerLocation != INVALID_LOC)
+		{
+			auto materialIndex = meshEntries[i].materialIndex;
+			Texture2D *texture = TextureManager::GetTexture(static_cast<unsigned int>(0));
+			if (materialIndex != INVALID_MATERIAL && materials[materialIndex]->texture && materials[materialIndex]->texture->GetTextureID())
+			{
+				texture = materials[materialIndex]->texture;
+			}
+
+			// The replay skips the layers and textures that are already set
+			int layer = texture->GetArrayLayer();
+			if (layer < 0 && texture->GetTextureID()) {
+				commands.BindTexture(GL_TEXTURE0, texture->GetTextureID());
+			}
+			commands.SetUniform(textureLayerLocation, layer);
+		}
+
+		commands.DrawElements(glDrawMode, meshEntries[i].nrIndices, meshEntries[i].baseIndex, meshEntries[i].baseVertex);
+	}
+}
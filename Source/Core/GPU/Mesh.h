@@ -10,6 +10,7 @@
 
 class GPUBuffers;
 class Texture2D;
+class CommandBuffer;
 
 struct VertexFormat
 {
@@ -45,6 +46,8 @@ struct Material
 	glm::vec4 emissive;
 	float shininess;
 
+	// Diffuse texture file, relative to the mesh location
+	std::string textureFile;
 	Texture2D* texture;
 };
 
@@ -68,6 +71,7 @@ struct MeshEntry
 class Mesh
 {
 	typedef unsigned int GLenum;
+	typedef int GLint;
 
 	public:
 		Mesh(std::string meshID);
@@ -95,6 +99,12 @@ class Mesh
 
 		bool LoadMesh(const std::string& fileLocation, const std::string& fileName);
 
+		// The two halves of LoadMesh. ReadMeshFile only parses the file into the CPU side
+		// buffers (safe to call from a worker thread), UploadToGPU creates the GPU buffers
+		// and requests the material textures (must be called on the OpenGL thread)
+		bool ReadMeshFile(const std::string& fileLocation, const std::string& fileName);
+		bool UploadToGPU();
+
 		void UseMaterials(bool value);
 
 		// GL_POINTS, GL_TRIANGLES, GL_LINES, GL_LINE_STRIP, GL_LINE_LOOP, GL_LINE_STRIP_ADJACENCY, GL_LINES_ADJACENCY,
@@ -104,6 +114,16 @@ class Mesh
 
 		void Render() const;
 
+		// Renders with the textures taken from the texture array (bound once per frame by
+		// TextureManager::BindTextureArray). Instead of binding a texture for each entry, only
+		// the "texture_layer" uniform is changed, and only when the layer differs. Textures that
+		// didn't fit in the array get layer -1 and are still bound on GL_TEXTURE0.
+		void Render(GLint textureLayerLocation) const;
+
+		// Records the same draws as Render(textureLayerLocation) in a command buffer (from any
+		// thread, while the mesh isn't being uploaded)
+		void Record(CommandBuffer &commands, GLint textureLayerLocation) const;
+
 		const GPUBuffers* GetBuffers() const;
 		const char* GetMeshID() const;
 
@@ -1,8 +1,10 @@
 #include "Shader.h"
 
 #include <fstream>
+#include <algorithm>
 #include <iostream>
 #include <include/gl.h>
+#include <Core/Managers/ShaderCache.h>
 
 using namespace std;
 
@@ -53,6 +55,21 @@ void Shader::BindTexturesUnits()
 		if (loc_textures[i] >= 0)
 			glUniform1i(loc_textures[i], i);
 	}
+
+	if (loc_texture_array >= 0)
+		glUniform1i(loc_texture_array, TEXTURE_ARRAY_UNIT);
+
+	if (loc_shadow_static >= 0)
+		glUniform1i(loc_shadow_static, SHADOW_STATIC_UNIT);
+	if (loc_shadow_dynamic >= 0)
+		glUniform1i(loc_shadow_dynamic, SHADOW_DYNAMIC_UNIT);
+
+	if (loc_lights >= 0)
+		glUniform1i(loc_lights, LIGHTS_UNIT);
+	if (loc_light_grid >= 0)
+		glUniform1i(loc_light_grid, LIGHT_GRID_UNIT);
+	if (loc_light_indices >= 0)
+		glUniform1i(loc_light_indices, LIGHT_INDICES_UNIT);
 }
 
 GLint Shader::GetUniformLocation(const char *uniformName) const
@@ -77,6 +94,18 @@ void Shader::GetUniforms()
 	loc_light_color = GetUniformLocation("light_color");
 	loc_light_radius = GetUniformLocation("light_radius");
 	loc_light_direction = GetUniformLocation("light_direction");
+	loc_shadow_static = GetUniformLocation("u_shadow_static");
+	loc_shadow_dynamic = GetUniformLocation("u_shadow_dynamic");
+	loc_lights = GetUniformLocation("u_lights");
+	loc_light_grid = GetUniformLocation("u_light_grid");
+	loc_light_indices = GetUniformLocation("u_light_indices");
+
+	// Material
+	loc_material_shininess = GetUniformLocation("material_shininess");
+	loc_material_kd = GetUniformLocation("material_kd");
+	loc_material_ks = GetUniformLocation("material_ks");
+	loc_material_emission = GetUniformLocation("material_emission");
+	loc_object_color = GetUniformLocation("object_color");
 
 	// Camera
 	loc_eye_pos = GetUniformLocation("eye_position");
@@ -86,6 +115,7 @@ void Shader::GetUniforms()
 
 	// General
 	loc_resolution = GetUniformLocation("resolution");
+	loc_time = GetUniformLocation("time");
 
 	char buffer[64];
 
@@ -94,6 +124,8 @@ void Shader::GetUniforms()
 		sprintf(buffer, "u_texture_%d", i);
 		loc_textures[i]	 = GetUniformLocation(buffer);
 	}
+	loc_texture_array = GetUniformLocation("u_texture_array");
+	loc_texture_layer = GetUniformLocation("texture_layer");
 
 	// Text
 	text_color = GetUniformLocation("text_color");
@@ -111,35 +143,141 @@ void Shader::AddShader(const string & shaderFile, GLenum shaderType)
 	shaderFiles.push_back(S);
 }
 
-unsigned int Shader::CreateAndLink()
+const vector<Shader::ShaderFile>& Shader::GetShaderFiles() const
 {
-	vector<unsigned int> shaders;
+	return shaderFiles;
+}
+
+void Shader::SetDefines(const vector<string> &defines)
+{
+	this->defines = defines;
+}
 
-	// Compile shaders
-	for (auto S : shaderFiles) {
-		auto shaderID = Shader::CreateShader(S.file, S.type);
-		if (shaderID) {
-			shaders.push_back(shaderID);
+void Shader::SetTransformFeedbackVaryings(const vector<string> &varyings)
+{
+	feedbackVaryings = varyings;
+}
+
+void Shader::PrepareLink(GLuint program) const
+{
+	if (feedbackVaryings.size()) {
+		vector<const char*> names;
+		for (auto &varying : feedbackVaryings) {
+			names.push_back(varying.c_str());
 		}
-		else {
-			return 0;
+		glTransformFeedbackVaryings(program, (GLsizei)names.size(), names.data(), GL_INTERLEAVED_ATTRIBS);
+	}
+
+	// Allow the linked program to be saved in the shader cache
+	if (ShaderCache::IsEnabled())
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+bool Shader::ReadSources(vector<string> &sources, uint64_t &sourceHash) const
+{
+	sources.clear();
+	sourceHash = ShaderCache::Hash(nullptr, 0);
+
+	for (auto &S : shaderFiles) {
+		string code;
+		if (!ReadShaderFile(S.file, code)) {
+			cout << "\tCould not open file: " << S.file << endl;
+			return false;
+		}
+
+		if (defines.size()) {
+			string header;
+			for (auto &define : defines) {
+				header += "#define " + define + "\n";
+			}
+
+			// #version must stay the first directive, the defines go on the next line
+			// and #line restores the numbering used in the error messages
+			size_t version = code.find("#version");
+			if (version == string::npos) {
+				code = header + "#line 1\n" + code;
+			}
+			else {
+				size_t versionEnd = code.find('\n', version);
+				if (versionEnd == string::npos) {
+					versionEnd = code.size();
+					code += '\n';
+				}
+
+				size_t nextLine = count(code.begin(), code.begin() + versionEnd, '\n') + 2;
+				code.insert(versionEnd + 1, header + "#line " + to_string(nextLine) + "\n");
+			}
 		}
+
+		sourceHash = ShaderCache::Hash(&S.type, sizeof(S.type), sourceHash);
+		sourceHash = ShaderCache::Hash(code.data(), code.size(), sourceHash);
+		sources.push_back(move(code));
+	}
+
+	// The captured outputs are part of the program too
+	for (auto &varying : feedbackVaryings) {
+		sourceHash = ShaderCache::Hash(varying.data(), varying.size() + 1, sourceHash);
+	}
+	return true;
+}
+
+void Shader::SwapProgram(GLuint newProgram)
+{
+	if (program) {
+		glDeleteProgram(program);
 	}
 
-	// Create Program and Link
-	if (shaders.size()) {
-		program = Shader::CreateProgram(shaders);
+	program = newProgram;
+	glUseProgram(program);
+	GetUniforms();
+	for (auto Observer : loadObservers) {
+		Observer();
+	}
+}
 
-		if (program)
-		{
-			glUseProgram(program);
-			GetUniforms();
-			for (auto Observer : loadObservers) {
-				Observer();
+unsigned int Shader::CreateAndLink()
+{
+	// Read the sources, their hash identifies the program in the cache
+	vector<string> sources;
+	uint64_t sourceHash;
+	if (!ReadSources(sources, sourceHash)) {
+		terminate();
+	}
+
+	program = ShaderCache::Load(shaderName, sourceHash);
+	if (program) {
+		cout << "\tPROGRAM = " << shaderName << "\t ..... LOADED FROM CACHE " << endl;
+	}
+	else {
+		vector<unsigned int> shaders;
+
+		// Compile shaders
+		for (unsigned int i = 0; i < shaderFiles.size(); i++) {
+			auto shaderID = Shader::CreateShader(shaderFiles[i].file, sources[i], shaderFiles[i].type);
+			if (shaderID) {
+				shaders.push_back(shaderID);
 			}
-			return program;
+			else {
+				return 0;
+			}
+		}
+
+		// Create Program and Link
+		if (shaders.size()) {
+			program = Shader::CreateProgram(shaders);
+			ShaderCache::Save(shaderName, sourceHash, program);
 		}
 	}
+
+	if (program)
+	{
+		glUseProgram(program);
+		GetUniforms();
+		for (auto Observer : loadObservers) {
+			Observer();
+		}
+		return program;
+	}
 	return 0;
 }
 
@@ -148,18 +286,14 @@ void Shader::ClearShaders()
 	shaderFiles.clear();
 }
 
-unsigned int Shader::CreateShader(const string &shaderFile, GLenum shaderType)
+bool Shader::ReadShaderFile(const string &shaderFile, string &shader_code)
 {
-	string shader_code;
 	ifstream file(shaderFile.c_str(), ios::in);
 
 	if(!file.good()) {
-		cout << "\tCould not open file: " << shaderFile << endl;
-		terminate();
+		return false;
 	}
 
-	cout << "\tFILE = " << shaderFile;
-
 	// Get file content
 	file.seekg(0, ios::end);
 	shader_code.resize((unsigned int)file.tellg());
@@ -167,6 +301,15 @@ unsigned int Shader::CreateShader(const string &shaderFile, GLenum shaderType)
 	file.read(&shader_code[0], shader_code.size());
 	file.close();
 
+	// Text mode reads can return less than the file size (line endings)
+	shader_code.resize((size_t)file.gcount());
+	return true;
+}
+
+unsigned int Shader::CreateShader(const string &shaderFile, const string &shader_code, GLenum shaderType)
+{
+	cout << "\tFILE = " << shaderFile;
+
 	int infoLogLength = 0;
 	int compileResult = 0;
 	unsigned int glShaderObject;
@@ -216,7 +359,7 @@ unsigned int Shader::CreateShader(const string &shaderFile, GLenum shaderType)
 	return glShaderObject;
 }
 
-unsigned int Shader::CreateProgram(const vector<unsigned int> &shaderObjects)
+unsigned int Shader::CreateProgram(const vector<unsigned int> &shaderObjects) const
 {
 	int infoLogLength = 0;
 	int linkResult = 0;
@@ -227,6 +370,7 @@ unsigned int Shader::CreateProgram(const vector<unsigned int> &shaderObjects)
 	for (auto shader: shaderObjects)
 		glAttachShader(glProgramObject, shader);
 
+	PrepareLink(glProgramObject);
 	glLinkProgram(glProgramObject);
 	glGetProgramiv(glProgramObject, GL_LINK_STATUS, &linkResult);
 
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <cstdint>
 #include <vector>
 #include <list>
 #include <functional>
@@ -7,10 +8,23 @@
 #include <include/gl.h>
 
 #define MAX_2D_TEXTURES		16
+#define TEXTURE_ARRAY_UNIT	MAX_2D_TEXTURES
+#define LIGHTS_UNIT			(TEXTURE_ARRAY_UNIT + 1)
+#define LIGHT_GRID_UNIT		(TEXTURE_ARRAY_UNIT + 2)
+#define LIGHT_INDICES_UNIT	(TEXTURE_ARRAY_UNIT + 3)
+#define SHADOW_STATIC_UNIT	(TEXTURE_ARRAY_UNIT + 4)
+#define SHADOW_DYNAMIC_UNIT	(TEXTURE_ARRAY_UNIT + 5)
 #define INVALID_LOC			-1
 
 class Shader
 {
+	public:
+		struct ShaderFile
+		{
+			std::string file;
+			GLenum type;
+		};
+
 	public:
 		Shader(const char *name);
 		~Shader();
@@ -30,16 +44,39 @@ class Shader
 
 		void OnLoad(std::function<void()> onLoad);
 
+		const std::vector<ShaderFile>& GetShaderFiles() const;
+
+		// Preprocessor symbols defined in every shader file, right after its #version line
+		// Must be set before CreateAndLink
+		void SetDefines(const std::vector<std::string> &defines);
+
+		// Outputs of the last vertex stage captured with transform feedback (interleaved)
+		// Must be set before CreateAndLink
+		void SetTransformFeedbackVaryings(const std::vector<std::string> &varyings);
+
+		// Sets the program state that must be given before linking
+		void PrepareLink(GLuint program) const;
+
+		// Reads the source of every shader file and hashes them (the key of the program cache)
+		bool ReadSources(std::vector<std::string> &sources, uint64_t &sourceHash) const;
+
+		// Replaces the program with an already linked one, built from the same files
+		// The old program is deleted, the uniforms are queried again and the observers notified
+		void SwapProgram(GLuint newProgram);
+
 	private:
 		void GetUniforms();
-		static unsigned int CreateShader(const std::string &shaderFile, GLenum shaderType);
-		static unsigned int CreateProgram(const std::vector<unsigned int> &shaderObjects);
+		static bool ReadShaderFile(const std::string &shaderFile, std::string &shaderCode);
+		static unsigned int CreateShader(const std::string &shaderFile, const std::string &shaderCode, GLenum shaderType);
+		unsigned int CreateProgram(const std::vector<unsigned int> &shaderObjects) const;
 
 	public:
 		GLuint program;
 
 		// Textures
 		GLint loc_textures[MAX_2D_TEXTURES];
+		GLint loc_texture_array;
+		GLint loc_texture_layer;
 
 		// MVP
 		GLint loc_model_matrix;
@@ -51,6 +88,20 @@ class Shader
 		GLint loc_light_color;
 		GLint loc_light_radius;
 		GLint loc_light_direction;
+		GLint loc_shadow_static;
+		GLint loc_shadow_dynamic;
+
+		// Clustered lights (buffer textures)
+		GLint loc_lights;
+		GLint loc_light_grid;
+		GLint loc_light_indices;
+
+		// Material
+		GLint loc_material_shininess;
+		GLint loc_material_kd;
+		GLint loc_material_ks;
+		GLint loc_material_emission;
+		GLint loc_object_color;
 
 		// Camera
 		GLint loc_eye_pos;
@@ -60,6 +111,7 @@ class Shader
 
 		// General
 		GLint loc_resolution;
+		GLint loc_time;
 		
 		// Text
 		GLint text_color;
@@ -68,13 +120,9 @@ class Shader
 
 		bool compileErrors;
 
-		struct ShaderFile
-		{
-			std::string file;
-			GLenum type;
-		};
-
 		std::string shaderName;
 		std::vector<ShaderFile> shaderFiles;
+		std::vector<std::string> defines;
+		std::vector<std::string> feedbackVaryings;
 		std::list<std::function<void()>> loadObservers;
 };
@@ -0,0 +1,68 @@
+#include "ShaderVariants.h"
+
+using namespace std;
+
+ShaderVariants::ShaderVariants(const char *name, const vector<string> &features)
+{
+	this->name = string(name);
+	this->features = features;
+}
+
+ShaderVariants::~ShaderVariants()
+{
+	for (auto &variant : variants) {
+		delete variant.second;
+	}
+}
+
+const char * ShaderVariants::GetName() const
+{
+	return name.c_str();
+}
+
+void ShaderVariants::AddShader(const string &shaderFile, GLenum shaderType)
+{
+	Shader::ShaderFile S;
+	S.file = shaderFile;
+	S.type = shaderType;
+	shaderFiles.push_back(S);
+}
+
+void ShaderVariants::OnCreate(function<void(Shader*)> onCreate)
+{
+	createObservers.push_back(onCreate);
+}
+
+Shader* ShaderVariants::Get(unsigned int mask)
+{
+	auto variant = variants.find(mask);
+	if (variant != variants.end()) {
+		return variant->second;
+	}
+
+	// The variant is named after its features, e.g. "Object_LIT_NOISE"
+	string variantName = name;
+	vector<string> defines;
+	for (unsigned int i = 0; i < features.size(); i++) {
+		if (mask & (1u << i)) {
+			variantName += "_" + features[i];
+			defines.push_back(features[i]);
+		}
+	}
+
+	Shader *shader = new Shader(variantName.c_str());
+	for (auto &S : shaderFiles) {
+		shader->AddShader(S.file, S.type);
+	}
+	shader->SetDefines(defines);
+
+	// A variant that fails to link is kept as well (it renders nothing), so it isn't
+	// compiled again every frame. It can still be fixed by reloading the shaders.
+	shader->CreateAndLink();
+	variants[mask] = shader;
+
+	for (auto Observer : createObservers) {
+		Observer(shader);
+	}
+	return shader;
+}
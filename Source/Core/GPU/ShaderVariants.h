@@ -0,0 +1,37 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <list>
+#include <functional>
+#include <unordered_map>
+
+#include <include/gl.h>
+#include <Core/GPU/Shader.h>
+
+// A set of programs built from the same shader files, specialized with #define's
+// Each feature is a preprocessor symbol, and a variant is picked with a mask (bit i enables
+// features[i]). The code of the disabled features is removed by the preprocessor instead of
+// being skipped at runtime. The variants are compiled the first time they are requested.
+class ShaderVariants
+{
+	public:
+		ShaderVariants(const char *name, const std::vector<std::string> &features);
+		~ShaderVariants();
+
+		const char *GetName() const;
+
+		void AddShader(const std::string &shaderFile, GLenum shaderType);
+
+		// Called for every new variant, after it was linked
+		void OnCreate(std::function<void(Shader*)> onCreate);
+
+		// Returns the variant for a feature mask, compiling it if it doesn't exist yet
+		Shader* Get(unsigned int mask);
+
+	private:
+		std::string name;
+		std::vector<std::string> features;
+		std::vector<Shader::ShaderFile> shaderFiles;
+		std::unordered_map<unsigned int, Shader*> variants;
+		std::list<std::function<void(Shader*)>> createObservers;
+};
@@ -36,6 +36,7 @@ Texture2D::Texture2D()
 	height = 0;
 	channels = 0;
 	textureID = 0;
+	arrayLayer = -1;
 	targetType = GL_TEXTURE_2D;
 	wrappingMode = GL_REPEAT;
 	textureMinFilter = GL_LINEAR;
@@ -50,6 +51,16 @@ GLuint Texture2D::GetTextureID() const
 	return textureID;
 }
 
+int Texture2D::GetArrayLayer() const
+{
+	return arrayLayer;
+}
+
+void Texture2D::SetArrayLayer(int layer)
+{
+	arrayLayer = layer;
+}
+
 void Texture2D::Init(GLuint gpuTextureID, unsigned int width, unsigned int height, unsigned int channels)
 {
 	this->textureID = gpuTextureID;
@@ -61,7 +72,7 @@ void Texture2D::Init(GLuint gpuTextureID, unsigned int width, unsigned int heigh
 bool Texture2D::Load2D(const char* fileName, GLenum wrapping_mode)
 {
 	int width, height, chn;
-	unsigned char *data = stbi_load(fileName, &width, &height, &chn, 0);
+	unsigned char *data = LoadImageData(fileName, width, height, chn);
 
 	if (data == NULL) {
 		#ifdef DEBUG_INFO
@@ -75,17 +86,58 @@ bool Texture2D::Load2D(const char* fileName, GLenum wrapping_mode)
 	cout << width << " * " << height << " channels: " << chn << endl << endl;
 	#endif
 
+	Upload2D(data, width, height, chn, wrapping_mode);
+
+	FreeImageData(data);
+	return true;
+}
+
+void Texture2D::Upload2D(const unsigned char* img, int width, int height, int chn, GLenum wrapping_mode)
+{
 	textureMinFilter = GL_LINEAR_MIPMAP_LINEAR;
 	wrappingMode = wrapping_mode;
 
 	Init2DTexture(width, height, chn);
-	glTexImage2D(targetType, 0, internalFormat[0][chn], width, height, 0, pixelFormat[chn], GL_UNSIGNED_BYTE, data);
+	glTexImage2D(targetType, 0, internalFormat[0][chn], width, height, 0, pixelFormat[chn], GL_UNSIGNED_BYTE, img);
 	glGenerateMipmap(targetType);
 	glBindTexture(targetType, 0);
 	CheckOpenGLError();
+}
+
+void Texture2D::UploadMipChain(unsigned int width, unsigned int height, unsigned int chn, GLenum compressedFormat,
+								const vector<MipLevel> &levels, GLenum wrapping_mode)
+{
+	textureMinFilter = levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR;
+	wrappingMode = wrapping_mode;
 
+	Init2DTexture(width, height, chn);
+	glTexParameteri(targetType, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size() - 1);
+
+	// The rows of the cached levels are tightly packed
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (unsigned int i = 0; i < levels.size(); i++) {
+		const MipLevel &level = levels[i];
+		if (compressedFormat) {
+			glCompressedTexImage2D(targetType, i, compressedFormat, level.width, level.height, 0, level.size, level.data);
+		}
+		else {
+			glTexImage2D(targetType, i, internalFormat[0][chn], level.width, level.height, 0, pixelFormat[chn], GL_UNSIGNED_BYTE, level.data);
+		}
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	glBindTexture(targetType, 0);
+	CheckOpenGLError();
+}
+
+unsigned char* Texture2D::LoadImageData(const char* fileName, int &width, int &height, int &chn)
+{
+	return stbi_load(fileName, &width, &height, &chn, 0);
+}
+
+void Texture2D::FreeImageData(unsigned char* data)
+{
 	stbi_image_free(data);
-	return true;
 }
 
 void Texture2D::SaveToFile(const char * fileName) const
@@ -1,9 +1,21 @@
 #pragma once
+#include <vector>
+
 #include <include/gl.h>
 #include <include/utils.h>
 
 class Texture2D
 {
+	public:
+		// A single level of a precomputed mip chain
+		struct MipLevel
+		{
+			unsigned int width;
+			unsigned int height;
+			unsigned int size;
+			const unsigned char *data;
+		};
+
 	public:
 		Texture2D();
 		~Texture2D();
@@ -20,6 +32,12 @@ class Texture2D
 		void CreateU16(const unsigned short* img, int width, int height, int chn);
 
 		bool Load2D(const char* fileName, GLenum wrappingMode = GL_REPEAT);
+		void Upload2D(const unsigned char* img, int width, int height, int chn, GLenum wrappingMode = GL_REPEAT);
+
+		// Upload a texture together with its already generated mip levels
+		// If compressedFormat is not 0, the levels hold block compressed data in that format
+		void UploadMipChain(unsigned int width, unsigned int height, unsigned int chn, GLenum compressedFormat,
+							const std::vector<MipLevel> &levels, GLenum wrappingMode = GL_REPEAT);
 		void SaveToFile(const char* fileName) const;
 
 		unsigned int GetWidth() const;
@@ -31,6 +49,15 @@ class Texture2D
 
 		GLuint GetTextureID() const;
 
+		// Layer of the texture inside the shared texture array, -1 if it isn't packed there
+		int GetArrayLayer() const;
+		void SetArrayLayer(int layer);
+
+		// Decode an image file into memory, without touching OpenGL (safe to call from any thread)
+		// The returned data must be released with FreeImageData
+		static unsigned char* LoadImageData(const char* fileName, int &width, int &height, int &chn);
+		static void FreeImageData(unsigned char* data);
+
 	private:
 		void SetTextureParameters();
 		void Init2DTexture(unsigned int width, unsigned int height, unsigned int channels);
@@ -44,4 +71,5 @@ class Texture2D
 		GLenum wrappingMode;
 		GLenum textureMinFilter;
 		GLenum textureMagFilter;
+		int arrayLayer;
 };
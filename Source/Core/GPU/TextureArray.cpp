@@ -0,0 +1,140 @@
+#include "TextureArray.h"
+
+#include <cmath>
+
+#include <include/math.h>
+
+using namespace std;
+
+TextureArray::TextureArray()
+{
+	textureID = 0;
+	layerSize = 0;
+	maxLayers = 0;
+	layerCount = 0;
+	mipmapsDirty = false;
+}
+
+TextureArray::~TextureArray()
+{
+	if (textureID)
+		glDeleteTextures(1, &textureID);
+}
+
+void TextureArray::Create(unsigned int layerSize, unsigned int maxLayers)
+{
+	this->layerSize = layerSize;
+	this->maxLayers = maxLayers;
+	layerCount = 0;
+
+	if (textureID)
+		glDeleteTextures(1, &textureID);
+
+	unsigned int levels = 1;
+	while ((layerSize >> levels) > 0) levels++;
+
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+	// Allocate every level of every layer up front
+	for (unsigned int level = 0; level < levels; level++) {
+		unsigned int size = MAX(layerSize >> level, 1u);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, size, size, maxLayers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	}
+
+	UnBind();
+}
+
+int TextureArray::AddLayer(const unsigned char *rgba)
+{
+	if (!textureID || layerCount == maxLayers)
+		return -1;
+
+	Bind();
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layerCount, layerSize, layerSize, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+	UnBind();
+
+	mipmapsDirty = true;
+	return layerCount++;
+}
+
+void TextureArray::Update()
+{
+	if (!mipmapsDirty) return;
+
+	Bind();
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	UnBind();
+	mipmapsDirty = false;
+}
+
+void TextureArray::Bind() const
+{
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+}
+
+void TextureArray::BindToTextureUnit(GLenum TextureUnit) const
+{
+	if (!textureID) return;
+	glActiveTexture(TextureUnit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void TextureArray::UnBind() const
+{
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	CheckOpenGLError();
+}
+
+GLuint TextureArray::GetTextureID() const
+{
+	return textureID;
+}
+
+unsigned int TextureArray::GetLayerSize() const
+{
+	return layerSize;
+}
+
+unsigned int TextureArray::GetLayerCount() const
+{
+	return layerCount;
+}
+
+void TextureArray::Resample(const unsigned char *img, int width, int height, int chn, unsigned int size, unsigned char *rgba)
+{
+	for (unsigned int y = 0; y < size; y++) {
+		// Sample at the texel centers, clamping at the edges
+		float sy = MAX((y + 0.5f) * height / size - 0.5f, 0.f);
+		int y0 = MIN((int)sy, height - 1);
+		int y1 = MIN(y0 + 1, height - 1);
+		float fy = sy - y0;
+
+		for (unsigned int x = 0; x < size; x++) {
+			float sx = MAX((x + 0.5f) * width / size - 0.5f, 0.f);
+			int x0 = MIN((int)sx, width - 1);
+			int x1 = MIN(x0 + 1, width - 1);
+			float fx = sx - x0;
+
+			float texel[4];
+			for (int c = 0; c < chn; c++) {
+				float top = lerp(img[(y0 * width + x0) * chn + c], img[(y0 * width + x1) * chn + c], fx);
+				float bottom = lerp(img[(y1 * width + x0) * chn + c], img[(y1 * width + x1) * chn + c], fx);
+				texel[c] = lerp(top, bottom, fy);
+			}
+
+			// Expand gray / gray-alpha / RGB images to RGBA
+			unsigned char *out = rgba + (y * size + x) * 4;
+			out[0] = (unsigned char)(texel[0] + 0.5f);
+			out[1] = (unsigned char)((chn >= 3 ? texel[1] : texel[0]) + 0.5f);
+			out[2] = (unsigned char)((chn >= 3 ? texel[2] : texel[0]) + 0.5f);
+			out[3] = chn == 4 ? (unsigned char)(texel[3] + 0.5f) : chn == 2 ? (unsigned char)(texel[1] + 0.5f) : 255;
+		}
+	}
+}
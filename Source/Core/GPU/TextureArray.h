@@ -0,0 +1,41 @@
+#pragma once
+#include <include/gl.h>
+#include <include/utils.h>
+
+// A GL_TEXTURE_2D_ARRAY where small textures are packed, one per layer
+// All the layers have the same size and format (RGBA8), so the images are resampled
+// before being added. A draw can then select its texture with a layer index instead
+// of binding a different texture.
+class TextureArray
+{
+	public:
+		TextureArray();
+		~TextureArray();
+
+		void Create(unsigned int layerSize, unsigned int maxLayers);
+
+		// Adds a "layerSize" x "layerSize" RGBA image, returns its layer or -1 if the array is full
+		int AddLayer(const unsigned char *rgba);
+
+		// Regenerates the mip levels if new layers were added since the last call
+		void Update();
+
+		void Bind() const;
+		void BindToTextureUnit(GLenum TextureUnit) const;
+		void UnBind() const;
+
+		GLuint GetTextureID() const;
+		unsigned int GetLayerSize() const;
+		unsigned int GetLayerCount() const;
+
+		// Converts an image to a "size" x "size" RGBA one using bilinear filtering
+		// Doesn't use OpenGL, so it can be called from any thread
+		static void Resample(const unsigned char *img, int width, int height, int chn, unsigned int size, unsigned char *rgba);
+
+	private:
+		GLuint textureID;
+		unsigned int layerSize;
+		unsigned int maxLayers;
+		unsigned int layerCount;
+		bool mipmapsDirty;
+};
@@ -0,0 +1,210 @@
+#include "AssetLoader.h"
+
+#include <memory>
+#include <cstdint>
+#include <iostream>
+
+#include <include/math.h>
+
+#include <Core/GPU/Mesh.h>
+#include <Core/GPU/Texture2D.h>
+#include <Core/GPU/TextureArray.h>
+#include <Core/Managers/TextureCache.h>
+
+using namespace std;
+
+std::vector<std::thread> AssetLoader::workers;
+std::atomic<bool> AssetLoader::running(false);
+
+std::queue<std::function<void()>> AssetLoader::jobs;
+std::mutex AssetLoader::jobsMutex;
+std::condition_variable AssetLoader::jobsCondition;
+
+std::queue<AssetLoader::Upload> AssetLoader::uploads;
+std::mutex AssetLoader::uploadsMutex;
+
+std::atomic<int> AssetLoader::pendingAssets(0);
+
+void AssetLoader::Init(unsigned int workerCount)
+{
+	if (running) return;
+
+	if (workerCount == 0) {
+		// Leave a core for the main thread, the workers are mostly waiting on I/O anyway
+		unsigned int cores = thread::hardware_concurrency();
+		workerCount = cores > 1 ? MIN(cores - 1, 4u) : 1u;
+	}
+
+	running = true;
+	for (unsigned int i = 0; i < workerCount; i++) {
+		workers.emplace_back(WorkerLoop);
+	}
+}
+
+void AssetLoader::Shutdown()
+{
+	if (!running) return;
+
+	{
+		lock_guard<mutex> lock(jobsMutex);
+		running = false;
+	}
+	jobsCondition.notify_all();
+
+	for (auto &worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+
+	// Drop everything that didn't get the chance to be uploaded
+	// The decoded data is owned by the queued functions, so it is released here
+	jobs = queue<function<void()>>();
+	uploads = queue<Upload>();
+	pendingAssets = 0;
+}
+
+void AssetLoader::WorkerLoop()
+{
+	while (true) {
+		function<void()> job;
+
+		{
+			unique_lock<mutex> lock(jobsMutex);
+			jobsCondition.wait(lock, [] { return !running || !jobs.empty(); });
+
+			if (!running) return;
+
+			job = move(jobs.front());
+			jobs.pop();
+		}
+
+		job();
+	}
+}
+
+void AssetLoader::QueueJob(function<void()> job)
+{
+	pendingAssets++;
+
+	if (!running) {
+		// No workers, load the asset right away (the upload is still deferred)
+		job();
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock(jobsMutex);
+		jobs.push(move(job));
+	}
+	jobsCondition.notify_one();
+}
+
+void AssetLoader::QueueUpload(size_t size, function<void()> upload)
+{
+	lock_guard<mutex> lock(uploadsMutex);
+	uploads.push({ size, move(upload) });
+}
+
+void AssetLoader::LoadTexture(Texture2D *texture, const string &fileName, GLenum wrappingMode, TextureArray *textureArray)
+{
+	unsigned int layerSize = textureArray ? textureArray->GetLayerSize() : 0;
+
+	QueueJob([texture, fileName, wrappingMode, textureArray, layerSize]() {
+		shared_ptr<CookedTexture> cooked = make_shared<CookedTexture>();
+		unique_ptr<unsigned char, void(*)(unsigned char*)> data(nullptr, Texture2D::FreeImageData);
+
+		// Prefer the cooked version, decode and cook the image only if it's missing or out of date
+		if (!TextureCache::Load(fileName, *cooked)) {
+			int width, height, channels;
+			data.reset(Texture2D::LoadImageData(fileName.c_str(), width, height, channels));
+
+			if (data == nullptr) {
+				cout << "ERROR loading texture: " << fileName << endl;
+				QueueUpload(0, [] {});
+				return;
+			}
+
+			TextureCache::Cook(fileName, data.get(), width, height, channels, *cooked);
+		}
+
+		// Small textures also get a layer in the texture array
+		shared_ptr<vector<unsigned char>> layer;
+		if (textureArray && cooked->width <= layerSize && cooked->height <= layerSize) {
+			const unsigned char *pixels = cooked->levels[0].data;
+
+			// Block compressed levels can't be resampled, go back to the source image
+			if (cooked->compressedFormat && data == nullptr) {
+				int width, height, channels;
+				data.reset(Texture2D::LoadImageData(fileName.c_str(), width, height, channels));
+			}
+			if (cooked->compressedFormat) {
+				pixels = data.get();
+			}
+
+			if (pixels) {
+				layer = make_shared<vector<unsigned char>>(layerSize * layerSize * 4);
+				TextureArray::Resample(pixels, cooked->width, cooked->height, cooked->channels, layerSize, layer->data());
+			}
+		}
+
+		size_t size = cooked->GetSize() + (layer ? layer->size() : 0);
+		QueueUpload(size, [texture, cooked, wrappingMode, textureArray, layer]() {
+			texture->UploadMipChain(cooked->width, cooked->height, cooked->channels, cooked->compressedFormat, cooked->levels, wrappingMode);
+			if (layer) {
+				texture->SetArrayLayer(textureArray->AddLayer(layer->data()));
+			}
+		});
+	});
+}
+
+void AssetLoader::LoadMesh(Mesh *mesh, const string &fileLocation, const string &fileName)
+{
+	QueueJob([mesh, fileLocation, fileName]() {
+		if (!mesh->ReadMeshFile(fileLocation, fileName)) {
+			QueueUpload(0, [] {});
+			return;
+		}
+
+		size_t size = mesh->positions.size() * (2 * sizeof(glm::vec3) + sizeof(glm::vec2)) + mesh->indices.size() * sizeof(unsigned short);
+		QueueUpload(size, [mesh]() {
+			mesh->UploadToGPU();
+		});
+	});
+}
+
+void AssetLoader::Update(size_t uploadBudget)
+{
+	size_t uploaded = 0;
+
+	while (true) {
+		Upload next;
+
+		{
+			lock_guard<mutex> lock(uploadsMutex);
+			if (uploads.empty()) break;
+
+			// Always do at least one upload per frame
+			if (uploaded > 0 && uploaded + uploads.front().size > uploadBudget) break;
+
+			next = move(uploads.front());
+			uploads.pop();
+		}
+
+		next.upload();
+		uploaded += next.size;
+		pendingAssets--;
+	}
+}
+
+void AssetLoader::WaitAll()
+{
+	while (!IsIdle()) {
+		Update(SIZE_MAX);
+		this_thread::yield();
+	}
+}
+
+bool AssetLoader::IsIdle()
+{
+	return pendingAssets == 0;
+}
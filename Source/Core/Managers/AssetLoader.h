@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <queue>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+#include <include/gl.h>
+
+class Mesh;
+class Texture2D;
+class TextureArray;
+
+// Default amount of data (in bytes) uploaded to the GPU in a single frame
+#define DEFAULT_UPLOAD_BUDGET	(8 * 1024 * 1024)
+
+// Loads assets in the background
+// File reading and decoding (stb, Assimp) run on a pool of worker threads,
+// while the GL uploads are queued and executed on the thread that owns the
+// OpenGL context, a few each frame (see Update). The objects handed to the
+// loader are placeholders that can be used right away, they simply render
+// nothing (or the default texture) until their upload is done.
+class AssetLoader
+{
+	public:
+		// Starts the worker threads. A count of 0 picks one based on the number of cores
+		static void Init(unsigned int workerCount = 0);
+		static void Shutdown();
+
+		// Decodes the image file in the background and uploads it into "texture"
+		// If "textureArray" is given and the image isn't larger than its layers, the image is
+		// also resampled and packed in the array, and the texture remembers its layer
+		static void LoadTexture(Texture2D *texture, const std::string &fileName, GLenum wrappingMode = GL_REPEAT, TextureArray *textureArray = nullptr);
+
+		// Parses the mesh file in the background and uploads it into "mesh"
+		static void LoadMesh(Mesh *mesh, const std::string &fileLocation, const std::string &fileName);
+
+		// Runs the pending GL uploads, stopping once "uploadBudget" bytes were sent this frame
+		// At least one upload is done every call, so large assets can't stall the queue
+		// Must be called from the thread that owns the OpenGL context
+		static void Update(size_t uploadBudget = DEFAULT_UPLOAD_BUDGET);
+
+		// Blocks until every queued asset has been uploaded
+		// Must be called from the thread that owns the OpenGL context
+		static void WaitAll();
+
+		// True if there are no assets being loaded or waiting to be uploaded
+		static bool IsIdle();
+
+	protected:
+		AssetLoader() = delete;
+		~AssetLoader() = delete;
+
+	private:
+		struct Upload
+		{
+			size_t size;
+			std::function<void()> upload;
+		};
+
+		static void WorkerLoop();
+		static void QueueJob(std::function<void()> job);
+		static void QueueUpload(size_t size, std::function<void()> upload);
+
+	private:
+		static std::vector<std::thread> workers;
+		static std::atomic<bool> running;
+
+		// Jobs waiting for a worker
+		static std::queue<std::function<void()>> jobs;
+		static std::mutex jobsMutex;
+		static std::condition_variable jobsCondition;
+
+		// Decoded assets waiting for the GL thread
+		static std::queue<Upload> uploads;
+		static std::mutex uploadsMutex;
+
+		// Assets queued but not yet uploaded
+		static std::atomic<int> pendingAssets;
+};
@@ -0,0 +1,181 @@
+#include "FileSystem.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+	#include <direct.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+bool FileSystem::CreateDirectories(const string &path)
+{
+	for (size_t i = 1; i <= path.size(); i++) {
+		if (i < path.size() && path[i] != '/' && path[i] != '\\')
+			continue;
+
+		string parent = path.substr(0, i);
+		#ifdef _WIN32
+		_mkdir(parent.c_str());
+		#else
+		mkdir(parent.c_str(), 0755);
+		#endif
+	}
+
+	struct stat info;
+	return stat(path.c_str(), &info) == 0 && (info.st_mode & S_IFDIR);
+}
+
+bool FileSystem::GetFileInfo(const string &fileName, uint64_t &size, int64_t &modifiedTime)
+{
+	struct stat info;
+	if (stat(fileName.c_str(), &info) != 0)
+		return false;
+
+	size = static_cast<uint64_t>(info.st_size);
+	modifiedTime = static_cast<int64_t>(info.st_mtime);
+	return true;
+}
+
+bool FileSystem::ReadFile(const string &fileName, string &content)
+{
+	ifstream file(fileName.c_str(), ios::in | ios::binary);
+	if (!file.good())
+		return false;
+
+	file.seekg(0, ios::end);
+	content.resize((size_t)file.tellg());
+	file.seekg(0, ios::beg);
+	file.read(&content[0], content.size());
+	return true;
+}
+
+bool FileSystem::WriteFile(const string &fileName, const void *data, size_t size)
+{
+	string tempName = fileName + ".tmp";
+
+	{
+		ofstream file(tempName.c_str(), ios::out | ios::binary | ios::trunc);
+		if (!file.good())
+			return false;
+
+		file.write(static_cast<const char*>(data), size);
+		if (!file.good())
+			return false;
+	}
+
+	// rename doesn't overwrite on Windows
+	remove(fileName.c_str());
+	return rename(tempName.c_str(), fileName.c_str()) == 0;
+}
+
+MappedFile::MappedFile()
+{
+	data = nullptr;
+	size = 0;
+	fileHandle = nullptr;
+	mappingHandle = nullptr;
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const string &fileName)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL) {
+		CloseHandle(file);
+		return false;
+	}
+
+	void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == NULL) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	fileHandle = file;
+	mappingHandle = mapping;
+	size = static_cast<size_t>(fileSize.QuadPart);
+	data = static_cast<const unsigned char*>(view);
+#else
+	int file = open(fileName.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size == 0) {
+		close(file);
+		return false;
+	}
+
+	void *view = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+
+	if (view == MAP_FAILED)
+		return false;
+
+	size = static_cast<size_t>(info.st_size);
+	data = static_cast<const unsigned char*>(view);
+#endif
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (!data) return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle(mappingHandle);
+	CloseHandle(fileHandle);
+#else
+	munmap(const_cast<unsigned char*>(data), size);
+#endif
+
+	data = nullptr;
+	size = 0;
+	fileHandle = nullptr;
+	mappingHandle = nullptr;
+}
+
+bool MappedFile::IsOpen() const
+{
+	return data != nullptr;
+}
+
+const unsigned char* MappedFile::GetData() const
+{
+	return data;
+}
+
+size_t MappedFile::GetSize() const
+{
+	return size;
+}
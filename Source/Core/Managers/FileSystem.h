@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+// Small file helpers used by the resource caches
+namespace FileSystem
+{
+	// Creates the directory and all its missing parents
+	bool CreateDirectories(const std::string &path);
+
+	// Gets the size and the last modification time of a file, false if it doesn't exist
+	bool GetFileInfo(const std::string &fileName, uint64_t &size, int64_t &modifiedTime);
+
+	// Reads a whole file in memory
+	bool ReadFile(const std::string &fileName, std::string &content);
+
+	// Writes the file through a temporary one, so a reader never sees a partial file
+	bool WriteFile(const std::string &fileName, const void *data, size_t size);
+}
+
+// Read-only memory mapping of a whole file
+// The mapping is released when the object is destroyed
+class MappedFile
+{
+	public:
+		MappedFile();
+		~MappedFile();
+
+		bool Open(const std::string &fileName);
+		void Close();
+
+		bool IsOpen() const;
+		const unsigned char* GetData() const;
+		size_t GetSize() const;
+
+	private:
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+	private:
+		const unsigned char *data;
+		size_t size;
+
+		// Platform specific handles
+		void *fileHandle;
+		void *mappingHandle;
+};
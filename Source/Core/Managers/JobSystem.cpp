@@ -0,0 +1,367 @@
+#include "JobSystem.h"
+
+#include <include/math.h>
+
+using namespace std;
+
+struct Job
+{
+	JobFunction work;
+
+	// The range of a ParallelFor job
+	size_t begin;
+	size_t end;
+
+	JobCounter *counter;
+
+	// The next job waiting for the same counter
+	Job *nextContinuation;
+
+	// Taken by its thread when queued, given back by the thread that ran it
+	atomic<bool> available;
+
+	Job() : begin(0), end(0), counter(nullptr), nextContinuation(nullptr), available(true) {}
+};
+
+struct JobPool
+{
+	Job jobs[JOB_POOL_SIZE];
+
+	// The slot after the last job taken, the jobs mostly finish in the order they were queued
+	unsigned int next = 0;
+};
+
+std::vector<std::thread> JobSystem::workers;
+std::atomic<bool> JobSystem::running(false);
+
+std::vector<JobSystem::WorkQueue*> JobSystem::queues;
+std::vector<JobPool*> JobSystem::pools;
+std::mutex JobSystem::attachMutex;
+std::vector<bool> JobSystem::attached;
+
+std::atomic<int> JobSystem::queuedJobs(0);
+std::mutex JobSystem::wakeMutex;
+std::condition_variable JobSystem::wakeCondition;
+
+// The queue of the current thread, -1 for the threads that don't belong to the system
+static thread_local int threadIndex = -1;
+
+JobCounter::JobCounter() : value(0), continuations(nullptr)
+{
+}
+
+bool JobCounter::IsDone() const
+{
+	return value.load(memory_order_acquire) == 0;
+}
+
+JobSystem::WorkQueue::WorkQueue() : top(0), bottom(0)
+{
+	for (auto &job : jobs) {
+		job.store(nullptr, memory_order_relaxed);
+	}
+}
+
+bool JobSystem::WorkQueue::Push(Job *job)
+{
+	long long b = bottom.load(memory_order_relaxed);
+	long long t = top.load(memory_order_acquire);
+	if (b - t >= JOB_QUEUE_SIZE) return false;
+
+	jobs[b & (JOB_QUEUE_SIZE - 1)].store(job, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	bottom.store(b + 1, memory_order_relaxed);
+	return true;
+}
+
+Job* JobSystem::WorkQueue::Pop()
+{
+	long long b = bottom.load(memory_order_relaxed) - 1;
+	bottom.store(b, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	long long t = top.load(memory_order_relaxed);
+
+	if (t > b) {
+		// Empty
+		bottom.store(b + 1, memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job *job = jobs[b & (JOB_QUEUE_SIZE - 1)].load(memory_order_relaxed);
+	if (t == b) {
+		// The last job, a thief may be taking it at the same time
+		if (!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed)) {
+			job = nullptr;
+		}
+		bottom.store(b + 1, memory_order_relaxed);
+	}
+	return job;
+}
+
+Job* JobSystem::WorkQueue::Steal()
+{
+	long long t = top.load(memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	long long b = bottom.load(memory_order_acquire);
+	if (t >= b) return nullptr;
+
+	Job *job = jobs[t & (JOB_QUEUE_SIZE - 1)].load(memory_order_relaxed);
+	if (!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed)) {
+		// Taken by the owner or another thief
+		return nullptr;
+	}
+	return job;
+}
+
+void JobSystem::Init(unsigned int workerCount)
+{
+	if (running) return;
+
+	if (workerCount == 0) {
+		unsigned int cores = thread::hardware_concurrency();
+		workerCount = cores > 1 ? cores - 1 : 1u;
+	}
+
+	for (unsigned int i = 0; i <= workerCount + JOB_ATTACHED_THREADS; i++) {
+		queues.push_back(new WorkQueue());
+		pools.push_back(new JobPool());
+	}
+	attached.assign(JOB_ATTACHED_THREADS, false);
+
+	threadIndex = 0;
+	running = true;
+	for (unsigned int i = 1; i <= workerCount; i++) {
+		workers.emplace_back(WorkerLoop, i);
+	}
+}
+
+void JobSystem::Shutdown()
+{
+	if (!running) return;
+
+	{
+		lock_guard<mutex> lock(wakeMutex);
+		running = false;
+	}
+	wakeCondition.notify_all();
+
+	for (auto &worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+
+	// The jobs still queued are dropped (no one waits for them anymore)
+	for (auto queue : queues) {
+		delete queue;
+	}
+	for (auto pool : pools) {
+		delete pool;
+	}
+	queues.clear();
+	pools.clear();
+	attached.clear();
+	threadIndex = -1;
+}
+
+void JobSystem::Run(const JobFunction &function, JobCounter *counter, JobCounter *dependency)
+{
+	Queue(function, 0, 0, counter, dependency);
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grain, const JobFunction &function, JobCounter *counter)
+{
+	if (count == 0) return;
+
+	// A few ranges per thread, so the threads that finish early can steal the rest
+	if (grain == 0) {
+		grain = MAX(count / (GetThreadCount() * 4), (size_t)1);
+	}
+
+	JobCounter localCounter;
+	JobCounter *rangeCounter = counter ? counter : &localCounter;
+
+	// Each range job gets a copy of the function (in the job, nothing is allocated)
+	for (size_t begin = 0; begin < count; begin += grain) {
+		Queue(function, begin, MIN(begin + grain, count), rangeCounter, nullptr);
+	}
+
+	if (!counter) {
+		Wait(&localCounter);
+	}
+}
+
+void JobSystem::Wait(JobCounter *counter)
+{
+	while (!counter->IsDone()) {
+		Job *job = GetJob();
+		if (job) {
+			Execute(job);
+		}
+		else {
+			this_thread::yield();
+		}
+	}
+
+	// The thread that finished the last job may still hold the lock, the counter can only be
+	// destroyed once it released it
+	lock_guard<mutex> lock(counter->continuationsMutex);
+}
+
+void JobSystem::AttachThread()
+{
+	if (!running || threadIndex >= 0) return;
+
+	lock_guard<mutex> lock(attachMutex);
+	for (unsigned int i = 0; i < attached.size(); i++) {
+		if (attached[i]) continue;
+		attached[i] = true;
+		threadIndex = (int)(workers.size() + 1 + i);
+		return;
+	}
+}
+
+void JobSystem::DetachThread()
+{
+	int first = (int)workers.size() + 1;
+	if (!running || threadIndex < first) return;
+
+	lock_guard<mutex> lock(attachMutex);
+	attached[threadIndex - first] = false;
+	threadIndex = -1;
+}
+
+unsigned int JobSystem::GetThreadCount()
+{
+	return (unsigned int)workers.size() + 1;
+}
+
+void JobSystem::WorkerLoop(unsigned int index)
+{
+	threadIndex = index;
+
+	while (true) {
+		Job *job = GetJob();
+		if (job) {
+			Execute(job);
+			continue;
+		}
+
+		unique_lock<mutex> lock(wakeMutex);
+		wakeCondition.wait(lock, [] { return !running || queuedJobs.load() > 0; });
+		if (!running) break;
+	}
+}
+
+void JobSystem::Queue(const JobFunction &function, size_t begin, size_t end, JobCounter *counter, JobCounter *dependency)
+{
+	if (counter) {
+		counter->value.fetch_add(1, memory_order_relaxed);
+	}
+
+	Job *job = AllocateJob();
+	if (!job) {
+		// Outside of the system, or with all the jobs of the thread in use, the job runs right away
+		if (dependency) {
+			Wait(dependency);
+		}
+
+		Job local;
+		local.work = function;
+		local.begin = begin;
+		local.end = end;
+		local.counter = counter;
+		Execute(&local);
+		return;
+	}
+
+	job->work = function;
+	job->begin = begin;
+	job->end = end;
+	job->counter = counter;
+
+	if (dependency) {
+		lock_guard<mutex> lock(dependency->continuationsMutex);
+		if (!dependency->IsDone()) {
+			job->nextContinuation = dependency->continuations;
+			dependency->continuations = job;
+			return;
+		}
+	}
+
+	Push(job);
+}
+
+Job* JobSystem::AllocateJob()
+{
+	if (threadIndex < 0 || !running) return nullptr;
+
+	JobPool *pool = pools[threadIndex];
+	for (unsigned int i = 0; i < JOB_POOL_SIZE; i++) {
+		unsigned int slot = (pool->next + i) & (JOB_POOL_SIZE - 1);
+		Job &job = pool->jobs[slot];
+		if (!job.available.load(memory_order_acquire)) continue;
+
+		job.available.store(false, memory_order_relaxed);
+		pool->next = (slot + 1) & (JOB_POOL_SIZE - 1);
+		return &job;
+	}
+	return nullptr;
+}
+
+void JobSystem::Push(Job *job)
+{
+	// Outside of the system (or in a full queue) the job runs right away
+	if (threadIndex < 0 || !running || !queues[threadIndex]->Push(job)) {
+		Execute(job);
+		return;
+	}
+
+	queuedJobs.fetch_add(1);
+	{
+		// Taken so the notification can't fall between the check of a worker and its wait
+		lock_guard<mutex> lock(wakeMutex);
+	}
+	wakeCondition.notify_one();
+}
+
+Job* JobSystem::GetJob()
+{
+	if (threadIndex < 0) return nullptr;
+
+	// The newest job of the thread first (its data is still in the cache), then the oldest of the others
+	Job *job = queues[threadIndex]->Pop();
+	for (size_t i = 1; !job && i < queues.size(); i++) {
+		job = queues[(threadIndex + i) % queues.size()]->Steal();
+	}
+
+	if (job) queuedJobs.fetch_sub(1);
+	return job;
+}
+
+void JobSystem::Execute(Job *job)
+{
+	job->work(job->begin, job->end);
+
+	JobCounter *counter = job->counter;
+
+	// The slot can be taken again once the captures are destroyed
+	job->work.Reset();
+	job->nextContinuation = nullptr;
+	job->available.store(true, memory_order_release);
+
+	if (!counter) return;
+
+	// The jobs that waited for the group are queued by its last job
+	Job *continuations;
+	{
+		lock_guard<mutex> lock(counter->continuationsMutex);
+		if (counter->value.fetch_sub(1, memory_order_acq_rel) != 1) return;
+		continuations = counter->continuations;
+		counter->continuations = nullptr;
+	}
+	while (continuations) {
+		Job *continuation = continuations;
+		continuations = continuation->nextContinuation;
+		Push(continuation);
+	}
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <new>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <condition_variable>
+
+// Capacity of the job queue of each thread (a power of 2), a job pushed in a full queue runs right away
+#define JOB_QUEUE_SIZE			4096
+
+// Jobs each thread can have queued or waiting at once (a power of 2), past it its jobs run right away
+#define JOB_POOL_SIZE			1024
+
+// Size of the captures of a job function
+#define JOB_FUNCTION_SIZE		128
+
+// Threads besides the main one and the workers that can be attached to queue jobs (a render thread)
+#define JOB_ATTACHED_THREADS	2
+
+struct Job;
+struct JobPool;
+
+// A function stored in the job itself, where a std::function would allocate its captures
+// It takes the range of a ParallelFor, "function(begin, end)", or nothing ("function()").
+// The captures must fit in JOB_FUNCTION_SIZE bytes, larger data is captured by pointer.
+class JobFunction
+{
+	public:
+		JobFunction() : invoke(nullptr), manage(nullptr) {}
+
+		template <class Function, class = typename std::enable_if<!std::is_same<typename std::decay<Function>::type, JobFunction>::value>::type>
+		JobFunction(Function &&function)
+		{
+			typedef typename std::decay<Function>::type Callable;
+			static_assert(sizeof(Callable) <= JOB_FUNCTION_SIZE, "The captures of the job don't fit in JOB_FUNCTION_SIZE");
+			static_assert(alignof(Callable) <= alignof(std::max_align_t), "The captures of the job are over-aligned");
+
+			new (storage) Callable(std::forward<Function>(function));
+			invoke = &Invoke<Callable>;
+			manage = &Manage<Callable>;
+		}
+
+		JobFunction(const JobFunction &other) : invoke(nullptr), manage(nullptr)
+		{
+			*this = other;
+		}
+
+		JobFunction& operator=(const JobFunction &other)
+		{
+			if (this == &other) return *this;
+
+			Reset();
+			if (other.manage) {
+				other.manage(storage, other.storage);
+			}
+			invoke = other.invoke;
+			manage = other.manage;
+			return *this;
+		}
+
+		~JobFunction()
+		{
+			Reset();
+		}
+
+		void operator()(size_t begin, size_t end)
+		{
+			invoke(storage, begin, end);
+		}
+
+		// Destroys the captures
+		void Reset()
+		{
+			if (manage) {
+				manage(storage, nullptr);
+			}
+			invoke = nullptr;
+			manage = nullptr;
+		}
+
+	private:
+		template <class Callable>
+		static void Invoke(void *callable, size_t begin, size_t end)
+		{
+			if constexpr (std::is_invocable<Callable&, size_t, size_t>::value) {
+				(*static_cast<Callable*>(callable))(begin, end);
+			}
+			else {
+				(*static_cast<Callable*>(callable))();
+			}
+		}
+
+		// Copies "source" in "destination", or destroys "destination" without a source
+		template <class Callable>
+		static void Manage(void *destination, const void *source)
+		{
+			if (source) {
+				new (destination) Callable(*static_cast<const Callable*>(source));
+			}
+			else {
+				static_cast<Callable*>(destination)->~Callable();
+			}
+		}
+
+		alignas(std::max_align_t) unsigned char storage[JOB_FUNCTION_SIZE];
+		void (*invoke)(void *callable, size_t begin, size_t end);
+		void (*manage)(void *destination, const void *source);
+};
+
+// Counts the unfinished jobs of a group
+// A job can be given a counter to wait for: it is only queued once the counter reaches 0
+class JobCounter
+{
+	public:
+		JobCounter();
+
+		bool IsDone() const;
+
+	private:
+		friend class JobSystem;
+
+		std::atomic<int> value;
+
+		// The jobs waiting for the counter to reach 0, chained through the jobs
+		std::mutex continuationsMutex;
+		Job *continuations;
+};
+
+// Runs the per-frame work of the engine on all the cores
+// Every thread (the main one and the workers) owns a Chase-Lev deque: it pushes and pops its
+// jobs at the bottom without locks, while the idle threads steal from the top of the others.
+// Jobs are grouped with counters, and a thread waiting for a counter runs queued jobs meanwhile,
+// so jobs can wait for other jobs (ParallelFor inside a job) without blocking a worker.
+// Only the main thread, the workers and the attached threads can queue jobs, on another thread
+// they run right away. The jobs of a thread are taken from its pool and their functions hold their
+// captures, so queuing a job allocates nothing.
+class JobSystem
+{
+	public:
+		// Starts the worker threads. A count of 0 starts one per core, besides the main thread
+		static void Init(unsigned int workerCount = 0);
+		static void Shutdown();
+
+		// Queues a job, "counter" is incremented now and decremented once the job is done
+		// If "dependency" is given, the job is only queued once it reaches 0
+		static void Run(const JobFunction &function, JobCounter *counter = nullptr, JobCounter *dependency = nullptr);
+
+		// Splits [0, count) in ranges of "grain" elements (0 picks a size from the number of
+		// threads) and runs "function(begin, end)" on each range as a job
+		// Without a counter, it waits for the ranges before returning
+		static void ParallelFor(size_t count, size_t grain, const JobFunction &function, JobCounter *counter = nullptr);
+
+		// Runs queued jobs until the counter reaches 0, a counter must be waited for before it is destroyed
+		static void Wait(JobCounter *counter);
+
+		// Gives the calling thread a queue, so its jobs are spread on the workers too
+		// A thread must wait for its jobs before it is detached
+		static void AttachThread();
+		static void DetachThread();
+
+		// The number of threads running jobs (the workers and the main thread)
+		static unsigned int GetThreadCount();
+
+	protected:
+		JobSystem() = delete;
+		~JobSystem() = delete;
+
+	private:
+		// Chase-Lev work-stealing deque, "Dynamic Circular Work-Stealing Deque" (with a fixed buffer)
+		// Push and Pop are called by the owner thread only, Steal by any thread
+		class WorkQueue
+		{
+			public:
+				WorkQueue();
+
+				bool Push(Job *job);
+				Job* Pop();
+				Job* Steal();
+
+			private:
+				std::atomic<long long> top;
+				std::atomic<long long> bottom;
+				std::atomic<Job*> jobs[JOB_QUEUE_SIZE];
+		};
+
+		static void WorkerLoop(unsigned int index);
+
+		static void Queue(const JobFunction &function, size_t begin, size_t end, JobCounter *counter, JobCounter *dependency);
+		static Job* AllocateJob();
+		static void Push(Job *job);
+		static Job* GetJob();
+		static void Execute(Job *job);
+
+	private:
+		static std::vector<std::thread> workers;
+		static std::atomic<bool> running;
+
+		// One queue per thread, the main thread uses the first one and the attached threads the last ones
+		static std::vector<WorkQueue*> queues;
+		static std::vector<JobPool*> pools;
+		static std::mutex attachMutex;
+		static std::vector<bool> attached;
+
+		// Jobs queued and not taken yet, the workers sleep while it is 0
+		static std::atomic<int> queuedJobs;
+		static std::mutex wakeMutex;
+		static std::condition_variable wakeCondition;
+};
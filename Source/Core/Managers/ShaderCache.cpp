@@ -0,0 +1,141 @@
+#include "ShaderCache.h"
+
+#include <vector>
+#include <cstring>
+#include <iostream>
+
+#include <Core/Managers/FileSystem.h>
+#include <Core/Managers/ResourcePath.h>
+
+using namespace std;
+
+bool ShaderCache::enabled = false;
+uint64_t ShaderCache::driverHash = 0;
+
+namespace
+{
+	const char CACHE_MAGIC[4] = { 'S', 'P', 'R', 'G' };
+	const uint32_t CACHE_VERSION = 1;
+
+	// Layout of a cache file: header, program binary
+	struct CacheHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t sourceHash;
+		uint64_t driverHash;
+		uint32_t binaryFormat;
+		uint32_t binarySize;
+	};
+}
+
+void ShaderCache::Init()
+{
+	GLint formats = 0;
+	if (GLEW_ARB_get_program_binary) {
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	}
+
+	// Some drivers expose the extension without supporting any format
+	enabled = formats > 0;
+	if (!enabled) return;
+
+	// A driver update invalidates every binary
+	const GLenum names[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	driverHash = Hash(nullptr, 0);
+	for (GLenum name : names) {
+		const char *value = reinterpret_cast<const char*>(glGetString(name));
+		if (value) {
+			driverHash = Hash(value, strlen(value), driverHash);
+		}
+	}
+
+	FileSystem::CreateDirectories(RESOURCE_PATH::CACHE + "Shaders");
+}
+
+bool ShaderCache::IsEnabled()
+{
+	return enabled;
+}
+
+uint64_t ShaderCache::Hash(const void *data, size_t size, uint64_t hash)
+{
+	const unsigned char *bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+string ShaderCache::GetCacheFile(const string &name)
+{
+	string fileName;
+	for (char c : name) {
+		bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_';
+		fileName += valid ? c : '_';
+	}
+
+	return RESOURCE_PATH::CACHE + "Shaders/" + fileName + ".bin";
+}
+
+GLuint ShaderCache::Load(const string &name, uint64_t sourceHash)
+{
+	if (!enabled) return 0;
+
+	string data;
+	if (!FileSystem::ReadFile(GetCacheFile(name), data))
+		return 0;
+
+	const CacheHeader *header = reinterpret_cast<const CacheHeader*>(data.data());
+	bool valid = data.size() >= sizeof(CacheHeader) &&
+		memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 &&
+		header->version == CACHE_VERSION &&
+		header->sourceHash == sourceHash &&
+		header->driverHash == driverHash &&
+		data.size() >= sizeof(CacheHeader) + header->binarySize;
+
+	if (!valid) return 0;
+
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, header->binaryFormat, data.data() + sizeof(CacheHeader), header->binarySize);
+
+	// The driver can still reject the binary, the sources are compiled then
+	GLint linkResult = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &linkResult);
+	if (linkResult == GL_FALSE) {
+		glDeleteProgram(program);
+		return 0;
+	}
+
+	return program;
+}
+
+void ShaderCache::Save(const string &name, uint64_t sourceHash, GLuint program)
+{
+	if (!enabled || !program) return;
+
+	GLint binarySize = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+	if (binarySize <= 0) return;
+
+	vector<char> data(sizeof(CacheHeader) + binarySize);
+
+	GLenum binaryFormat = 0;
+	GLsizei length = 0;
+	glGetProgramBinary(program, binarySize, &length, &binaryFormat, data.data() + sizeof(CacheHeader));
+	if (length <= 0) return;
+
+	CacheHeader header;
+	memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.version = CACHE_VERSION;
+	header.sourceHash = sourceHash;
+	header.driverHash = driverHash;
+	header.binaryFormat = binaryFormat;
+	header.binarySize = length;
+	memcpy(data.data(), &header, sizeof(header));
+
+	if (!FileSystem::WriteFile(GetCacheFile(name), data.data(), sizeof(CacheHeader) + length)) {
+		cout << "Could not write the shader cache for " << name << endl;
+	}
+}
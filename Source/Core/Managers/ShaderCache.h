@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include <include/gl.h>
+
+// Disk cache for linked shader programs (GL_ARB_get_program_binary)
+// A program is stored under the name of its shader, together with a hash of its sources
+// and a hash of the driver (vendor, renderer and version strings). A cached binary is only
+// used when both hashes match and the driver accepts it, otherwise the caller compiles the
+// sources as usual and saves the new binary. All the functions must be called on the
+// OpenGL thread.
+class ShaderCache
+{
+	public:
+		// Must be called after OpenGL was initialized
+		static void Init();
+
+		// False if the driver can't return program binaries
+		static bool IsEnabled();
+
+		// FNV-1a hash, used to identify the sources of a program
+		static uint64_t Hash(const void *data, size_t size, uint64_t hash = 14695981039346656037ULL);
+
+		// Creates a program from the cached binary, returns 0 if there is no valid one
+		static GLuint Load(const std::string &name, uint64_t sourceHash);
+
+		// Saves the binary of a linked program, created with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+		static void Save(const std::string &name, uint64_t sourceHash, GLuint program);
+
+	protected:
+		ShaderCache() = delete;
+		~ShaderCache() = delete;
+
+	private:
+		static std::string GetCacheFile(const std::string &name);
+
+	private:
+		static bool enabled;
+		static uint64_t driverHash;
+};
@@ -0,0 +1,350 @@
+#include "ShaderManager.h"
+
+#include <chrono>
+#include <iostream>
+
+#include <Core/GPU/Shader.h>
+#include <Core/Managers/FileSystem.h>
+#include <Core/Managers/ShaderCache.h>
+
+using namespace std;
+
+std::atomic<bool> ShaderManager::running(false);
+bool ShaderManager::parallelCompile = false;
+
+std::thread ShaderManager::watcher;
+std::vector<ShaderManager::WatchedFile> ShaderManager::watchedFiles;
+std::mutex ShaderManager::watchMutex;
+std::condition_variable ShaderManager::watchCondition;
+
+std::unordered_set<Shader*> ShaderManager::requested;
+std::mutex ShaderManager::requestedMutex;
+
+std::unordered_set<Shader*> ShaderManager::building;
+std::vector<ShaderManager::Build> ShaderManager::parallelBuilds;
+
+std::thread ShaderManager::compiler;
+GLFWwindow* ShaderManager::compilerContext = nullptr;
+std::queue<std::function<void()>> ShaderManager::compileJobs;
+std::mutex ShaderManager::compileMutex;
+std::condition_variable ShaderManager::compileCondition;
+std::vector<ShaderManager::Build> ShaderManager::finishedBuilds;
+std::mutex ShaderManager::finishedMutex;
+
+void ShaderManager::Init()
+{
+	if (running) return;
+	running = true;
+
+	parallelCompile = GLEW_ARB_parallel_shader_compile != 0;
+	if (parallelCompile) {
+		// Let the driver pick the number of threads
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+	}
+	else {
+		// A hidden window whose context shares the objects with the current one
+		// The other window hints are still the ones used for the main window
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		compilerContext = glfwCreateWindow(1, 1, "Shader Compiler", NULL, glfwGetCurrentContext());
+		glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+		if (compilerContext) {
+			compiler = thread(CompilerLoop);
+		}
+		else {
+			cout << "Could not create the shader compiler context, shaders are reloaded synchronously" << endl;
+		}
+	}
+
+	watcher = thread(WatcherLoop);
+}
+
+void ShaderManager::Shutdown()
+{
+	if (!running) return;
+
+	{
+		lock_guard<mutex> watchLock(watchMutex);
+		lock_guard<mutex> compileLock(compileMutex);
+		running = false;
+	}
+	watchCondition.notify_all();
+	compileCondition.notify_all();
+
+	watcher.join();
+	if (compiler.joinable()) {
+		compiler.join();
+	}
+
+	if (compilerContext) {
+		glfwDestroyWindow(compilerContext);
+		compilerContext = nullptr;
+	}
+
+	// Drop the programs that were never swapped in
+	for (auto &build : parallelBuilds) {
+		FinishBuild(build);
+		glDeleteProgram(build.program);
+	}
+	for (auto &build : finishedBuilds) {
+		glDeleteProgram(build.program);
+	}
+
+	parallelBuilds.clear();
+	finishedBuilds.clear();
+	compileJobs = queue<function<void()>>();
+	building.clear();
+	requested.clear();
+}
+
+void ShaderManager::Watch(Shader *shader)
+{
+	lock_guard<mutex> lock(watchMutex);
+
+	for (auto &S : shader->GetShaderFiles()) {
+		WatchedFile watched;
+		watched.file = S.file;
+		watched.shader = shader;
+		watched.size = 0;
+		watched.time = 0;
+		FileSystem::GetFileInfo(S.file, watched.size, watched.time);
+		watchedFiles.push_back(watched);
+	}
+}
+
+void ShaderManager::RequestReload(Shader *shader)
+{
+	lock_guard<mutex> lock(requestedMutex);
+	requested.insert(shader);
+}
+
+void ShaderManager::WatcherLoop()
+{
+	unique_lock<mutex> lock(watchMutex);
+
+	while (running) {
+		watchCondition.wait_for(lock, chrono::milliseconds(SHADER_WATCH_INTERVAL), [] { return !running; });
+		if (!running) return;
+
+		for (auto &watched : watchedFiles) {
+			uint64_t size;
+			int64_t time;
+
+			// The file can be missing for a moment while an editor saves it
+			if (!FileSystem::GetFileInfo(watched.file, size, time))
+				continue;
+
+			if (size != watched.size || time != watched.time) {
+				watched.size = size;
+				watched.time = time;
+				RequestReload(watched.shader);
+			}
+		}
+	}
+}
+
+void ShaderManager::CompilerLoop()
+{
+	glfwMakeContextCurrent(compilerContext);
+
+	while (true) {
+		function<void()> job;
+
+		{
+			unique_lock<mutex> lock(compileMutex);
+			compileCondition.wait(lock, [] { return !running || !compileJobs.empty(); });
+
+			if (!running) break;
+
+			job = move(compileJobs.front());
+			compileJobs.pop();
+		}
+
+		job();
+	}
+
+	glfwMakeContextCurrent(NULL);
+}
+
+void ShaderManager::Update()
+{
+	if (!running) return;
+
+	// Programs built by the worker
+	vector<Build> finished;
+	{
+		lock_guard<mutex> lock(finishedMutex);
+		finished.swap(finishedBuilds);
+	}
+	for (auto &build : finished) {
+		CompleteBuild(build);
+	}
+
+	// Programs built by the driver threads
+	for (auto it = parallelBuilds.begin(); it != parallelBuilds.end();) {
+		if (IsBuildDone(*it)) {
+			FinishBuild(*it);
+			CompleteBuild(*it);
+			it = parallelBuilds.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+
+	// Start the new requests, the shaders still being built wait for their current build to end
+	vector<Shader*> starting;
+	{
+		lock_guard<mutex> lock(requestedMutex);
+		for (auto it = requested.begin(); it != requested.end();) {
+			if (building.count(*it) == 0) {
+				starting.push_back(*it);
+				it = requested.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+	}
+
+	for (auto shader : starting) {
+		cout << "Reloading shader: " << shader->GetName() << endl;
+
+		vector<string> sources;
+		uint64_t sourceHash;
+		if (!shader->ReadSources(sources, sourceHash)) {
+			cout << "\t ..... FAILED, the previous program is kept" << endl;
+			continue;
+		}
+
+		GLuint cached = ShaderCache::Load(shader->GetName(), sourceHash);
+		if (cached) {
+			shader->SwapProgram(cached);
+			cout << "\t ..... LOADED FROM CACHE" << endl;
+			continue;
+		}
+
+		Build build;
+		build.shader = shader;
+		build.sourceHash = sourceHash;
+		build.program = 0;
+		build.linked = false;
+		building.insert(shader);
+
+		if (parallelCompile) {
+			StartBuild(build, sources);
+			parallelBuilds.push_back(build);
+		}
+		else if (compilerContext) {
+			{
+				lock_guard<mutex> lock(compileMutex);
+				compileJobs.push([build, sources]() mutable {
+					StartBuild(build, sources);
+					FinishBuild(build);
+
+					// Make sure the program is complete before the main context uses it
+					glFinish();
+
+					lock_guard<mutex> lock(finishedMutex);
+					finishedBuilds.push_back(build);
+				});
+			}
+			compileCondition.notify_one();
+		}
+		else {
+			StartBuild(build, sources);
+			FinishBuild(build);
+			CompleteBuild(build);
+		}
+	}
+}
+
+void ShaderManager::StartBuild(Build &build, const vector<string> &sources)
+{
+	auto &files = build.shader->GetShaderFiles();
+
+	for (unsigned int i = 0; i < files.size(); i++) {
+		GLuint stage = glCreateShader(files[i].type);
+		const char *code = sources[i].c_str();
+		const int size = (int)sources[i].size();
+		glShaderSource(stage, 1, &code, &size);
+		glCompileShader(stage);
+		build.stages.push_back(stage);
+	}
+
+	build.program = glCreateProgram();
+	for (auto stage : build.stages) {
+		glAttachShader(build.program, stage);
+	}
+
+	build.shader->PrepareLink(build.program);
+
+	// Doesn't wait for the compilation, the status queries do
+	glLinkProgram(build.program);
+}
+
+bool ShaderManager::IsBuildDone(const Build &build)
+{
+	GLint done = GL_FALSE;
+	glGetProgramiv(build.program, GL_COMPLETION_STATUS_ARB, &done);
+	return done == GL_TRUE;
+}
+
+void ShaderManager::FinishBuild(Build &build)
+{
+	auto &files = build.shader->GetShaderFiles();
+
+	// Report the compile errors of each stage
+	for (unsigned int i = 0; i < build.stages.size(); i++) {
+		GLint compileResult = GL_FALSE;
+		glGetShaderiv(build.stages[i], GL_COMPILE_STATUS, &compileResult);
+
+		if (compileResult == GL_FALSE) {
+			GLint infoLogLength = 0;
+			glGetShaderiv(build.stages[i], GL_INFO_LOG_LENGTH, &infoLogLength);
+			vector<char> shader_log(infoLogLength + 1);
+			glGetShaderInfoLog(build.stages[i], infoLogLength, NULL, &shader_log[0]);
+
+			cout << "\n-----------------------------------------------------\n";
+			cout << "\n[ERROR]: [" << files[i].file << "]\n\n";
+			cout << &shader_log[0] << "\n";
+			cout << "-----------------------------------------------------" << endl;
+		}
+	}
+
+	GLint linkResult = GL_FALSE;
+	glGetProgramiv(build.program, GL_LINK_STATUS, &linkResult);
+	build.linked = (linkResult == GL_TRUE);
+
+	if (!build.linked) {
+		GLint infoLogLength = 0;
+		glGetProgramiv(build.program, GL_INFO_LOG_LENGTH, &infoLogLength);
+		vector<char> program_log(infoLogLength + 1);
+		glGetProgramInfoLog(build.program, infoLogLength, NULL, &program_log[0]);
+
+		cout << "Shader Loader : LINK ERROR" << endl;
+		cout << &program_log[0] << endl;
+
+		glDeleteProgram(build.program);
+		build.program = 0;
+	}
+
+	for (auto stage : build.stages) {
+		glDeleteShader(stage);
+	}
+	build.stages.clear();
+}
+
+void ShaderManager::CompleteBuild(Build &build)
+{
+	building.erase(build.shader);
+
+	if (!build.linked) {
+		cout << "Reloading shader: " << build.shader->GetName() << "\t ..... FAILED, the previous program is kept" << endl;
+		return;
+	}
+
+	ShaderCache::Save(build.shader->GetName(), build.sourceHash, build.program);
+	build.shader->SwapProgram(build.program);
+	cout << "Reloading shader: " << build.shader->GetName() << "\t ..... RELOADED" << endl;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <queue>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <unordered_set>
+#include <condition_variable>
+
+#include <include/gl.h>
+
+class Shader;
+
+// How often the watched shader files are checked for changes, in milliseconds
+#define SHADER_WATCH_INTERVAL	250
+
+// Rebuilds shaders in the background
+// A watcher thread polls the files of the registered shaders and flags the ones that changed.
+// The new programs are compiled and linked off the frame path: with GL_ARB_parallel_shader_compile
+// the driver does it on its own threads and the completion is polled every frame, otherwise a
+// worker thread with its own (shared) OpenGL context does the work. A new program replaces the
+// running one only if it linked, the errors are printed and the old program is kept.
+class ShaderManager
+{
+	public:
+		// Must be called after OpenGL was initialized, on the thread that owns the context
+		static void Init();
+		static void Shutdown();
+
+		// Rebuilds the shader whenever one of its files changes
+		static void Watch(Shader *shader);
+
+		// Rebuilds the shader in the background, even if its files didn't change
+		static void RequestReload(Shader *shader);
+
+		// Starts the requested rebuilds and swaps in the programs that are done
+		// Must be called every frame, from the thread that owns the OpenGL context
+		static void Update();
+
+	protected:
+		ShaderManager() = delete;
+		~ShaderManager() = delete;
+
+	private:
+		struct WatchedFile
+		{
+			std::string file;
+			uint64_t size;
+			int64_t time;
+			Shader *shader;
+		};
+
+		struct Build
+		{
+			Shader *shader;
+			uint64_t sourceHash;
+			GLuint program;
+			std::vector<GLuint> stages;
+			bool linked;
+		};
+
+		static void WatcherLoop();
+		static void CompilerLoop();
+
+		static void StartBuild(Build &build, const std::vector<std::string> &sources);
+		static bool IsBuildDone(const Build &build);
+		static void FinishBuild(Build &build);
+		static void CompleteBuild(Build &build);
+
+	private:
+		static std::atomic<bool> running;
+		static bool parallelCompile;
+
+		// Files checked by the watcher thread
+		static std::thread watcher;
+		static std::vector<WatchedFile> watchedFiles;
+		static std::mutex watchMutex;
+		static std::condition_variable watchCondition;
+
+		// Shaders waiting to be rebuilt (written by the watcher and RequestReload)
+		static std::unordered_set<Shader*> requested;
+		static std::mutex requestedMutex;
+
+		// Shaders being rebuilt, a shader is never built twice at the same time
+		static std::unordered_set<Shader*> building;
+
+		// Builds in progress with GL_ARB_parallel_shader_compile
+		static std::vector<Build> parallelBuilds;
+
+		// Shared context worker, used when the driver can't compile in parallel
+		static std::thread compiler;
+		static GLFWwindow *compilerContext;
+		static std::queue<std::function<void()>> compileJobs;
+		static std::mutex compileMutex;
+		static std::condition_variable compileCondition;
+		static std::vector<Build> finishedBuilds;
+		static std::mutex finishedMutex;
+};
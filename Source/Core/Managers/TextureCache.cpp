@@ -0,0 +1,388 @@
+#include "TextureCache.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#include <include/math.h>
+#include <Core/Managers/ResourcePath.h>
+
+using namespace std;
+
+bool TextureCache::useCompression = false;
+
+namespace
+{
+	const char CACHE_MAGIC[4] = { 'S', 'T', 'E', 'X' };
+	const uint32_t CACHE_VERSION = 1;
+
+	// Layout of a cache file: header, level table, level data
+	struct CacheHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t sourceSize;
+		int64_t sourceTime;
+		uint32_t width;
+		uint32_t height;
+		uint32_t channels;
+		uint32_t compressedFormat;
+		uint32_t levelCount;
+		uint32_t reserved;
+	};
+
+	struct CacheLevel
+	{
+		uint32_t width;
+		uint32_t height;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	uint16_t PackRGB565(const unsigned char *color)
+	{
+		return ((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3);
+	}
+
+	void UnpackRGB565(uint16_t value, int *color)
+	{
+		int r = (value >> 11) & 31;
+		int g = (value >> 5) & 63;
+		int b = value & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+}
+
+size_t CookedTexture::GetSize() const
+{
+	size_t size = 0;
+	for (auto &level : levels) {
+		size += level.size;
+	}
+	return size;
+}
+
+void TextureCache::Init(bool allowCompression)
+{
+	useCompression = allowCompression && GLEW_EXT_texture_compression_s3tc;
+	FileSystem::CreateDirectories(RESOURCE_PATH::CACHE + "Textures");
+}
+
+string TextureCache::GetCacheFile(const string &sourceFile)
+{
+	// Flatten the source path into a file name
+	string name;
+	for (char c : sourceFile) {
+		bool separator = (c == '/' || c == '\\' || c == ':' || c == '.');
+		if (!separator) {
+			name += c;
+		}
+		else if (!name.empty() && name.back() != '_') {
+			name += '_';
+		}
+	}
+
+	return RESOURCE_PATH::CACHE + "Textures/" + name + (useCompression ? ".bc" : "") + ".tex";
+}
+
+bool TextureCache::Load(const string &sourceFile, CookedTexture &texture)
+{
+	uint64_t sourceSize;
+	int64_t sourceTime;
+	if (!FileSystem::GetFileInfo(sourceFile, sourceSize, sourceTime))
+		return false;
+
+	if (!texture.file.Open(GetCacheFile(sourceFile)))
+		return false;
+
+	const unsigned char *data = texture.file.GetData();
+	size_t size = texture.file.GetSize();
+
+	// Check that the cache file is valid and up to date
+	const CacheHeader *header = reinterpret_cast<const CacheHeader*>(data);
+	bool valid = size >= sizeof(CacheHeader) &&
+		memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 &&
+		header->version == CACHE_VERSION &&
+		header->sourceSize == sourceSize &&
+		header->sourceTime == sourceTime &&
+		header->channels >= 1 && header->channels <= 4 &&
+		header->levelCount > 0 &&
+		size >= sizeof(CacheHeader) + header->levelCount * sizeof(CacheLevel);
+
+	if (!valid) {
+		texture.file.Close();
+		return false;
+	}
+
+	const CacheLevel *table = reinterpret_cast<const CacheLevel*>(data + sizeof(CacheHeader));
+	texture.levels.clear();
+	for (unsigned int i = 0; i < header->levelCount; i++) {
+		if (table[i].offset + table[i].size > size) {
+			texture.levels.clear();
+			texture.file.Close();
+			return false;
+		}
+
+		Texture2D::MipLevel level;
+		level.width = table[i].width;
+		level.height = table[i].height;
+		level.size = static_cast<unsigned int>(table[i].size);
+		level.data = data + table[i].offset;
+		texture.levels.push_back(level);
+	}
+
+	texture.width = header->width;
+	texture.height = header->height;
+	texture.channels = header->channels;
+	texture.compressedFormat = header->compressedFormat;
+	return true;
+}
+
+bool TextureCache::Cook(const string &sourceFile, const unsigned char *img, int width, int height, int chn, CookedTexture &texture)
+{
+	bool compress = useCompression && (chn == 3 || chn == 4);
+
+	texture.width = width;
+	texture.height = height;
+	texture.channels = chn;
+	texture.compressedFormat = compress ? (chn == 3 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) : 0;
+
+	// Compute the layout of the mip chain
+	vector<CacheLevel> table;
+	size_t offset = sizeof(CacheHeader);
+	for (unsigned int w = width, h = height; ; w = MAX(w / 2, 1u), h = MAX(h / 2, 1u)) {
+		CacheLevel level;
+		level.width = w;
+		level.height = h;
+		level.size = compress ? UPPER_BOUND(w, 4) * UPPER_BOUND(h, 4) * (chn == 3 ? 8 : 16) : w * h * chn;
+		table.push_back(level);
+
+		if (w == 1 && h == 1) break;
+	}
+
+	offset += table.size() * sizeof(CacheLevel);
+	for (auto &level : table) {
+		level.offset = offset;
+		offset += level.size;
+	}
+
+	uint64_t sourceSize = 0;
+	int64_t sourceTime = 0;
+	FileSystem::GetFileInfo(sourceFile, sourceSize, sourceTime);
+
+	CacheHeader header;
+	memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.version = CACHE_VERSION;
+	header.sourceSize = sourceSize;
+	header.sourceTime = sourceTime;
+	header.width = width;
+	header.height = height;
+	header.channels = chn;
+	header.compressedFormat = texture.compressedFormat;
+	header.levelCount = (uint32_t)table.size();
+	header.reserved = 0;
+
+	texture.storage.resize(offset);
+	unsigned char *storage = texture.storage.data();
+	memcpy(storage, &header, sizeof(header));
+	memcpy(storage + sizeof(header), table.data(), table.size() * sizeof(CacheLevel));
+
+	// Generate the levels, each one from the previous
+	vector<unsigned char> current(img, img + (size_t)width * height * chn);
+	vector<unsigned char> next;
+	texture.levels.clear();
+
+	for (unsigned int i = 0; i < table.size(); i++) {
+		const CacheLevel &level = table[i];
+		unsigned char *dst = storage + level.offset;
+
+		if (compress) {
+			CompressBlocks(current.data(), level.width, level.height, chn, dst);
+		}
+		else {
+			memcpy(dst, current.data(), level.size);
+		}
+
+		Texture2D::MipLevel mip;
+		mip.width = level.width;
+		mip.height = level.height;
+		mip.size = static_cast<unsigned int>(level.size);
+		mip.data = dst;
+		texture.levels.push_back(mip);
+
+		if (i + 1 < table.size()) {
+			next.resize((size_t)table[i + 1].width * table[i + 1].height * chn);
+			Downsample(current.data(), level.width, level.height, chn, next.data());
+			current.swap(next);
+		}
+	}
+
+	if (!FileSystem::WriteFile(GetCacheFile(sourceFile), texture.storage.data(), texture.storage.size())) {
+		cout << "Could not write the texture cache for " << sourceFile << endl;
+	}
+
+	return true;
+}
+
+void TextureCache::Downsample(const unsigned char *src, unsigned int width, unsigned int height, unsigned int chn, unsigned char *dst)
+{
+	unsigned int newWidth = MAX(width / 2, 1u);
+	unsigned int newHeight = MAX(height / 2, 1u);
+
+	// 2x2 box filter, the last row/column is repeated for odd sizes
+	for (unsigned int y = 0; y < newHeight; y++) {
+		unsigned int y0 = MIN(2 * y, height - 1);
+		unsigned int y1 = MIN(2 * y + 1, height - 1);
+
+		for (unsigned int x = 0; x < newWidth; x++) {
+			unsigned int x0 = MIN(2 * x, width - 1);
+			unsigned int x1 = MIN(2 * x + 1, width - 1);
+
+			for (unsigned int c = 0; c < chn; c++) {
+				unsigned int sum = src[(y0 * width + x0) * chn + c] + src[(y0 * width + x1) * chn + c] +
+					src[(y1 * width + x0) * chn + c] + src[(y1 * width + x1) * chn + c];
+				dst[(y * newWidth + x) * chn + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+void TextureCache::CompressBlocks(const unsigned char *src, unsigned int width, unsigned int height, unsigned int chn, unsigned char *dst)
+{
+	unsigned char block[16 * 4];
+
+	for (unsigned int by = 0; by < height; by += 4) {
+		for (unsigned int bx = 0; bx < width; bx += 4) {
+			// Gather a 4x4 RGBA block, repeating the edge pixels for partial blocks
+			for (unsigned int i = 0; i < 16; i++) {
+				unsigned int x = MIN(bx + i % 4, width - 1);
+				unsigned int y = MIN(by + i / 4, height - 1);
+				const unsigned char *pixel = src + (y * width + x) * chn;
+
+				block[i * 4 + 0] = pixel[0];
+				block[i * 4 + 1] = pixel[1];
+				block[i * 4 + 2] = pixel[2];
+				block[i * 4 + 3] = chn == 4 ? pixel[3] : 255;
+			}
+
+			if (chn == 4) {
+				CompressAlphaBlock(block, dst);
+				dst += 8;
+			}
+			CompressColorBlock(block, dst);
+			dst += 8;
+		}
+	}
+}
+
+void TextureCache::CompressColorBlock(const unsigned char *block, unsigned char *dst)
+{
+	// The end points are the corners of the (slightly inset) bounding box of the colors
+	unsigned char minColor[3] = { 255, 255, 255 };
+	unsigned char maxColor[3] = { 0, 0, 0 };
+	for (unsigned int i = 0; i < 16; i++) {
+		for (unsigned int c = 0; c < 3; c++) {
+			minColor[c] = MIN(minColor[c], block[i * 4 + c]);
+			maxColor[c] = MAX(maxColor[c], block[i * 4 + c]);
+		}
+	}
+
+	for (unsigned int c = 0; c < 3; c++) {
+		unsigned char inset = (maxColor[c] - minColor[c]) / 16;
+		minColor[c] += inset;
+		maxColor[c] -= inset;
+	}
+
+	uint16_t color0 = PackRGB565(maxColor);
+	uint16_t color1 = PackRGB565(minColor);
+	uint32_t indices = 0;
+
+	// color0 > color1 selects the 4 color mode
+	if (color0 < color1) {
+		swap(color0, color1);
+	}
+
+	if (color0 != color1) {
+		int palette[4][3];
+		UnpackRGB565(color0, palette[0]);
+		UnpackRGB565(color1, palette[1]);
+		for (unsigned int c = 0; c < 3; c++) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		for (unsigned int i = 0; i < 16; i++) {
+			int bestDistance = INT32_MAX;
+			uint32_t bestIndex = 0;
+
+			for (uint32_t p = 0; p < 4; p++) {
+				int distance = 0;
+				for (unsigned int c = 0; c < 3; c++) {
+					int delta = block[i * 4 + c] - palette[p][c];
+					distance += delta * delta;
+				}
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					bestIndex = p;
+				}
+			}
+
+			indices |= bestIndex << (2 * i);
+		}
+	}
+
+	dst[0] = color0 & 0xFF;
+	dst[1] = color0 >> 8;
+	dst[2] = color1 & 0xFF;
+	dst[3] = color1 >> 8;
+	dst[4] = indices & 0xFF;
+	dst[5] = (indices >> 8) & 0xFF;
+	dst[6] = (indices >> 16) & 0xFF;
+	dst[7] = (indices >> 24) & 0xFF;
+}
+
+void TextureCache::CompressAlphaBlock(const unsigned char *block, unsigned char *dst)
+{
+	unsigned char alpha0 = 0;
+	unsigned char alpha1 = 255;
+	for (unsigned int i = 0; i < 16; i++) {
+		alpha0 = MAX(alpha0, block[i * 4 + 3]);
+		alpha1 = MIN(alpha1, block[i * 4 + 3]);
+	}
+
+	uint64_t indices = 0;
+
+	// alpha0 > alpha1 selects the 8 value mode
+	if (alpha0 != alpha1) {
+		int palette[8];
+		palette[0] = alpha0;
+		palette[1] = alpha1;
+		for (int p = 1; p < 7; p++) {
+			palette[p + 1] = ((7 - p) * alpha0 + p * alpha1) / 7;
+		}
+
+		for (unsigned int i = 0; i < 16; i++) {
+			int bestDistance = INT32_MAX;
+			uint64_t bestIndex = 0;
+
+			for (uint64_t p = 0; p < 8; p++) {
+				int distance = abs(block[i * 4 + 3] - palette[p]);
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					bestIndex = p;
+				}
+			}
+
+			indices |= bestIndex << (3 * i);
+		}
+	}
+
+	dst[0] = alpha0;
+	dst[1] = alpha1;
+	for (unsigned int i = 0; i < 6; i++) {
+		dst[2 + i] = (indices >> (8 * i)) & 0xFF;
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <include/gl.h>
+#include <Core/GPU/Texture2D.h>
+#include <Core/Managers/FileSystem.h>
+
+// A texture with its complete mip chain, ready to be uploaded
+// The levels point either inside the memory mapped cache file or inside "storage"
+struct CookedTexture
+{
+	CookedTexture()
+	{
+		width = 0;
+		height = 0;
+		channels = 0;
+		compressedFormat = 0;
+	}
+
+	// Total size of the mip chain, in bytes
+	size_t GetSize() const;
+
+	unsigned int width;
+	unsigned int height;
+	unsigned int channels;
+	GLenum compressedFormat;
+	std::vector<Texture2D::MipLevel> levels;
+
+	MappedFile file;
+	std::vector<unsigned char> storage;
+};
+
+// Disk cache for "cooked" textures
+// The first time a texture is loaded its mip chain is generated on the CPU, optionally
+// block compressed (BC1 for RGB, BC3 for RGBA) and written in RESOURCE_PATH::CACHE. On the
+// next launches the cache file is memory mapped and uploaded directly, skipping the image
+// decoding and glGenerateMipmap. A cache file is rebuilt when its source file changes.
+// Load and Cook don't use OpenGL, so they can run on the asset loader threads.
+class TextureCache
+{
+	public:
+		// Must be called after OpenGL was initialized (it checks for S3TC support)
+		static void Init(bool allowCompression = true);
+
+		// Maps the cache file of "sourceFile", if there is an up to date one
+		static bool Load(const std::string &sourceFile, CookedTexture &texture);
+
+		// Generates the mip chain for a decoded image and saves it in the cache
+		static bool Cook(const std::string &sourceFile, const unsigned char *img, int width, int height, int chn, CookedTexture &texture);
+
+	protected:
+		TextureCache() = delete;
+		~TextureCache() = delete;
+
+	private:
+		static std::string GetCacheFile(const std::string &sourceFile);
+
+		static void Downsample(const unsigned char *src, unsigned int width, unsigned int height, unsigned int chn, unsigned char *dst);
+		static void CompressBlocks(const unsigned char *src, unsigned int width, unsigned int height, unsigned int chn, unsigned char *dst);
+		static void CompressColorBlock(const unsigned char *block, unsigned char *dst);
+		static void CompressAlphaBlock(const unsigned char *block, unsigned char *dst);
+
+	private:
+		static bool useCompression;
+};
@@ -1,16 +1,23 @@
 #include "TextureManager.h"
 
 #include <include/utils.h>
+#include <Core/GPU/Shader.h>
 #include <Core/GPU/Texture2D.h>
+#include <Core/GPU/TextureArray.h>
 #include <Core/Managers/ResourcePath.h>
+#include <Core/Managers/AssetLoader.h>
 
 using namespace std;
 
 std::unordered_map<std::string, Texture2D*> TextureManager::mapTextures;
 std::vector<Texture2D*> TextureManager::vTextures;
+TextureArray* TextureManager::textureArray = nullptr;
 
 void TextureManager::Init()
 {
+	textureArray = new TextureArray();
+	textureArray->Create(TEXTURE_ARRAY_LAYER_SIZE, TEXTURE_ARRAY_MAX_LAYERS);
+
 	LoadTexture(RESOURCE_PATH::TEXTURES, "default.png");
 	LoadTexture(RESOURCE_PATH::TEXTURES, "white.png");
 	LoadTexture(RESOURCE_PATH::TEXTURES, "black.jpg");
@@ -35,13 +42,10 @@ Texture2D* TextureManager::LoadTexture(const string &path, const char *fileName)
 		return mapTextures[fileName];
 	}
 
+	// The texture is returned right away, and it is filled in the background
+	// Until then it has no GPU texture, so the default one is bound instead
 	texture = new Texture2D();
-	bool status = texture->Load2D((path + '/' + fileName).c_str());
-
-	if (status == false) {
-		delete texture;
-		return vTextures[0];
-	}
+	AssetLoader::LoadTexture(texture, path + '/' + fileName, GL_REPEAT, textureArray);
 
 	vTextures.push_back(texture);
 	mapTextures[fileName] = texture;
@@ -66,3 +70,16 @@ Texture2D* TextureManager::GetTexture(unsigned int textureID)
 		return vTextures[textureID];
 	return NULL;
 }
+
+TextureArray* TextureManager::GetTextureArray()
+{
+	return textureArray;
+}
+
+void TextureManager::BindTextureArray()
+{
+	if (!textureArray) return;
+
+	textureArray->Update();
+	textureArray->BindToTextureUnit(GL_TEXTURE0 + TEXTURE_ARRAY_UNIT);
+}
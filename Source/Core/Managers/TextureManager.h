@@ -5,6 +5,11 @@
 #include <vector>
 
 class Texture2D;
+class TextureArray;
+
+// Textures up to this size are also packed in the shared texture array
+#define TEXTURE_ARRAY_LAYER_SIZE	256
+#define TEXTURE_ARRAY_MAX_LAYERS	16
 
 class TextureManager
 {
@@ -15,6 +20,13 @@ class TextureManager
 		static Texture2D* GetTexture(const char* name);
 		static Texture2D* GetTexture(unsigned int textureID);
 
+		// The array holding the small textures (see Texture2D::GetArrayLayer)
+		static TextureArray* GetTextureArray();
+
+		// Binds the texture array on TEXTURE_ARRAY_UNIT, should be called once per frame
+		// before rendering. Finishes the mip levels of the layers added since the last call.
+		static void BindTextureArray();
+
 	protected:
 		TextureManager() = delete;
 		~TextureManager() = delete;
@@ -23,4 +35,5 @@ class TextureManager
 
 		static std::unordered_map<std::string, Texture2D*> mapTextures;
 		static std::vector<Texture2D*> vTextures;
+		static TextureArray *textureArray;
 };
\ No newline at end of file
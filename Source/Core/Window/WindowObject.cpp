@@ -33,8 +33,7 @@ WindowObject::WindowObject(WindowProperties properties)
 	window = nullptr;
 
 	resizeEvent = false;
-	scrollEvent = false;
-	mouseMoveEvent = false;
+	inputTime = -1;
 
 	frameID = 0;
 	deltaFrameTime = 0;
@@ -55,9 +54,8 @@ WindowObject::WindowObject(WindowProperties properties)
 	CheckOpenGLError();
 
 	// Set default state
-	mouseButtonAction = 0;
+	keyMods = 0;
 	mouseButtonStates = 0;
-	registeredKeyEvents = 0;
 	memset(keyStates, 0, 384);
 	memset(keyScanCode, 0, 512);
 
@@ -242,44 +240,39 @@ glm::ivec2 WindowObject::GetCursorPosition() const
 	return props.cursorPos;
 }
 
+void WindowObject::QueueInput(InputEvent::Type type, int code, int action, int mods, double x, double y)
+{
+	// A full queue drops the event, it only happens if the frames stop for a long time
+	InputEvent event = { type, code, action, mods, x, y, Engine::GetElapsedTime() };
+	inputEvents.Push(event);
+}
+
 void WindowObject::KeyCallback(int key, int scanCode, int action, int mods)
 {
-	keyMods = mods;
-	if (keyStates[key] == (action ? true : false))
+	// The unknown keys (GLFW_KEY_UNKNOWN) have no state
+	if (key < 0 || key >= (int)SIZEOF_ARRAY(keyStates))
 		return;
-	keyStates[key] = action ? true : false;
-	keyEvents[registeredKeyEvents] = key;
-	registeredKeyEvents++;
+	QueueInput(InputEvent::Type::KEY, key, action, mods, 0, 0);
 }
 
 void WindowObject::MouseButtonCallback(int button, int action, int mods)
 {
-	// Only button events and mods are kept
-	// Mouse position is the current frame position
-	keyMods = mods;
-	SET_BIT(mouseButtonAction, button);
-	action ? SET_BIT(mouseButtonStates, button) : CLEAR_BIT(mouseButtonStates, button);
+	QueueInput(InputEvent::Type::MOUSE_BUTTON, button, action, mods, 0, 0);
 }
 
 void WindowObject::MouseMove(int posX, int posY)
 {
-	// Save information for processing later on the Update thread
-	if (mouseMoveEvent) {
-		mouseDeltaX += posX - props.cursorPos.x;
-		mouseDeltaY += posY - props.cursorPos.y;
-	}
-	else {
-		mouseMoveEvent = true;
-		mouseDeltaX = posX - props.cursorPos.x;
-		mouseDeltaY = posY - props.cursorPos.y;
-	}
-	props.cursorPos = glm::ivec2(posX, posY);
+	QueueInput(InputEvent::Type::MOUSE_MOVE, 0, 0, 0, posX, posY);
 }
 
 void WindowObject::MouseScroll(double offsetX, double offsetY)
 {
-	mouseScrollDeltaX = (int)offsetX;
-	mouseScrollDeltaY = (int)offsetY;
+	QueueInput(InputEvent::Type::MOUSE_SCROLL, 0, 0, 0, offsetX, offsetY);
+}
+
+double WindowObject::GetInputTime() const
+{
+	return inputTime;
 }
 
 void WindowObject::UpdateObservers()
@@ -295,58 +288,89 @@ void WindowObject::UpdateObservers()
 		}
 	}
 
-	// Signal mouse move event
-	if (mouseMoveEvent)
-	{
+	// The consecutive mouse moves are signaled once, with the sum of their offsets
+	bool mouseMoveEvent = false;
+	int mouseDeltaX = 0;
+	int mouseDeltaY = 0;
+	auto signalMouseMove = [&]() {
+		if (!mouseMoveEvent) return;
 		mouseMoveEvent = false;
 		for (auto obs : observers) {
 			obs->OnMouseMove(props.cursorPos.x, props.cursorPos.y, mouseDeltaX, mouseDeltaY);
 		}
-	}
-
-	// Signal mouse button press event
-	auto pressEvent = mouseButtonAction & mouseButtonStates;
-	if (pressEvent)
-	{
-		auto pressEvent = mouseButtonAction & mouseButtonStates;
-		for (auto obs : observers) {
-			obs->OnMouseBtnPress(props.cursorPos.x, props.cursorPos.y, pressEvent, keyMods);
-		}
-	}
-
-	// Signal mouse button release event
-	auto releaseEvent = mouseButtonAction & (~mouseButtonStates);
-	if (releaseEvent)
-	{
-		for (auto obs : observers) {
-			obs->OnMouseBtnRelease(props.cursorPos.x, props.cursorPos.y, releaseEvent, keyMods);
-		}
-	}
-
-	// Signal mouse scroll event
-	if (scrollEvent) {
-		scrollEvent = false;
-		for (auto obs : observers) {
-			obs->OnMouseScroll(props.cursorPos.x, props.cursorPos.y, mouseScrollDeltaX, mouseScrollDeltaY);
-		}
-	}
+	};
 
-	// Signal key events
-	if (registeredKeyEvents)
+	// Signal the input events in the order they were received, the states (KeyHold, MouseHold)
+	// change with them. A key pressed and released between two frames gets both events.
+	inputTime = -1;
+	InputEvent event;
+	while (inputEvents.Pop(event))
 	{
-		for (int i = 0; i < registeredKeyEvents; i++) {
-			for (auto obs : observers)
-				keyStates[keyEvents[i]] ? obs->OnKeyPress(keyEvents[i], keyMods) : obs->OnKeyRelease(keyEvents[i], keyMods);
+		if (inputTime < 0)
+			inputTime = event.time;
+
+		if (event.type != InputEvent::Type::MOUSE_MOVE)
+			signalMouseMove();
+
+		switch (event.type)
+		{
+			case InputEvent::Type::KEY:
+			{
+				keyMods = event.mods;
+
+				// The repeats of a held key are ignored
+				bool pressed = event.action != GLFW_RELEASE;
+				if (keyStates[event.code] == pressed)
+					break;
+				keyStates[event.code] = pressed;
+				for (auto obs : observers) {
+					pressed ? obs->OnKeyPress(event.code, keyMods) : obs->OnKeyRelease(event.code, keyMods);
+				}
+			} break;
+
+			case InputEvent::Type::MOUSE_BUTTON:
+			{
+				keyMods = event.mods;
+
+				int button = 0;
+				SET_BIT(button, event.code);
+				if (event.action) {
+					SET_BIT(mouseButtonStates, event.code);
+					for (auto obs : observers) {
+						obs->OnMouseBtnPress(props.cursorPos.x, props.cursorPos.y, button, keyMods);
+					}
+				}
+				else {
+					CLEAR_BIT(mouseButtonStates, event.code);
+					for (auto obs : observers) {
+						obs->OnMouseBtnRelease(props.cursorPos.x, props.cursorPos.y, button, keyMods);
+					}
+				}
+			} break;
+
+			case InputEvent::Type::MOUSE_MOVE:
+			{
+				glm::ivec2 position((int)event.x, (int)event.y);
+				mouseDeltaX += position.x - props.cursorPos.x;
+				mouseDeltaY += position.y - props.cursorPos.y;
+				mouseMoveEvent = true;
+				props.cursorPos = position;
+			} break;
+
+			case InputEvent::Type::MOUSE_SCROLL:
+			{
+				for (auto obs : observers) {
+					obs->OnMouseScroll(props.cursorPos.x, props.cursorPos.y, (int)event.x, (int)event.y);
+				}
+			} break;
 		}
-		registeredKeyEvents = 0;
 	}
+	signalMouseMove();
 
 	// Continuous events
 	for (auto obs : observers) {
 			obs->OnInputUpdate(static_cast<float>(deltaFrameTime), keyMods);
 	}
-
-	mouseButtonAction = 0;
 }
 
 void WindowObject::MakeCurrentContext() const
@@ -355,6 +379,12 @@ void WindowObject::MakeCurrentContext() const
 	CheckOpenGLError();
 }
 
+void WindowObject::ReleaseContext() const
+{
+	// The context can only be made current on another thread once it is released here
+	glfwMakeContextCurrent(NULL);
+}
+
 void WindowObject::SetSize(int width, int height)
 {
 	glfwSetWindowSize(window, width, height);
@@ -4,6 +4,10 @@
 
 #include <include/gl.h>
 #include <include/glm.h>
+#include <include/spsc_queue.h>
+
+// Capacity of the queue of input events between two frames (a power of 2)
+#define INPUT_QUEUE_SIZE	1024
 
 class WindowProperties
 {
@@ -24,6 +28,27 @@ class WindowProperties
 		bool vSync;
 };
 
+// An input event, queued by the GLFW callbacks and handled in order by UpdateObservers
+struct InputEvent
+{
+	enum class Type : unsigned char { KEY, MOUSE_BUTTON, MOUSE_MOVE, MOUSE_SCROLL };
+
+	Type type;
+
+	// The key or the mouse button, GLFW_PRESS / GLFW_RELEASE / GLFW_REPEAT and the modifiers
+	// (the mouse moves and scrolls keep the modifiers of the last key or button)
+	int code;
+	int action;
+	int mods;
+
+	// The cursor position, or the scroll offsets
+	double x;
+	double y;
+
+	// When the callback received it (Engine::GetElapsedTime)
+	double time;
+};
+
 /*
  * Class WindowObject
  */
@@ -56,6 +81,7 @@ class WindowObject
 		bool ToggleVSync();
 
 		void MakeCurrentContext() const;
+		void ReleaseContext() const;
 
 		// Window Information
 		void SetSize(int width, int height);
@@ -74,8 +100,12 @@ class WindowObject
 		glm::ivec2 GetCursorPosition() const;
 
 		// Update event listeners (key press / mouse move / window events)
+		// The input events queued since the last call are handled in the order they happened
 		void UpdateObservers();
 
+		// The time of the oldest input event handled by the last UpdateObservers (negative if there was none)
+		double GetInputTime() const;
+
 	protected:
 		// Frame time
 		void ComputeFrameTime();
@@ -84,11 +114,12 @@ class WindowObject
 		void FullScreen();
 		void WindowMode();
 
-		// Input Processing
+		// Input Processing, the events are queued with the time they are received
 		void KeyCallback(int key, int scanCode, int action, int mods);
 		void MouseButtonCallback(int button, int action, int mods);
 		void MouseMove(int posX, int posY);
 		void MouseScroll(double offsetX, double offsetY);
+		void QueueInput(InputEvent::Type type, int code, int action, int mods, double x, double y);
 
 		// Subscribe to receive input events
 		void SubscribeToEvents(InputController * IC);
@@ -115,24 +146,14 @@ class WindowObject
 		bool hiddenPointer;
 		bool resizeEvent;
 
-		// Mouse button callback
-		int mouseButtonCallback;			// Bit field for button callback
-		int mouseButtonAction;				// Bit field for button state
-		int mouseButtonStates;				// Bit field for mouse button state
-
-		// Mouse move event
-		bool mouseMoveEvent;
-		int mouseDeltaX;
-		int mouseDeltaY;
+		// The input events received since the last UpdateObservers, and the time of the oldest one it handled
+		SPSCQueue<InputEvent, INPUT_QUEUE_SIZE> inputEvents;
+		double inputTime;
 
-		// Mouse scroll event
-		bool scrollEvent;
-		int mouseScrollDeltaX;
-		int mouseScrollDeltaY;
+		// Mouse button state
+		int mouseButtonStates;				// Bit field for mouse button state
 
 		// States for keyboard buttons - PRESSED(true) / RELEASED(false)
-		int registeredKeyEvents;
-		int keyEvents[128];
 		bool keyStates[384];
 
 		// Platform specific key codes - PRESSED(true) / RELEASED(false)
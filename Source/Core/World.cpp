@@ -1,5 +1,8 @@
 #include "World.h"
 
+#include <iostream>
+#include <algorithm>
+
 #include <Core/Engine.h>
 #include <Component/CameraInput.h>
 #include <Component/Transform/Transform.h>
@@ -12,6 +15,12 @@ World::World()
 	paused = false;
 	shouldClose = false;
 
+	renderThreadEnabled = false;
+	renderThreadRunning = false;
+	simulatedFrames = 0;
+	acquiredFrames = 0;
+	simulatedInputTime = -1;
+
 	window = Engine::GetWindow();
 }
 
@@ -20,10 +29,15 @@ void World::Run()
 	if (!window)
 		return;
 
+	if (renderThreadEnabled)
+		StartRenderThread();
+
 	while (!window->ShouldClose())
 	{
 		LoopUpdate();
 	}
+
+	StopRenderThread();
 }
 
 void World::Pause()
@@ -42,6 +56,101 @@ double World::GetLastFrameTime()
 	return deltaTime;
 }
 
+void World::SetRenderThread(bool enabled)
+{
+	renderThreadEnabled = enabled;
+}
+
+void World::SetFrameRate(double framesPerSecond)
+{
+	pacer.SetTargetRate(framesPerSecond);
+}
+
+void World::SetFramesInFlight(unsigned int frames)
+{
+	pacer.SetMaxFramesInFlight(frames);
+}
+
+void World::StartRenderThread()
+{
+	{
+		std::lock_guard<std::mutex> lock(frameMutex);
+		renderThreadRunning = true;
+		simulatedFrames = 0;
+		acquiredFrames = 0;
+	}
+
+	window->ReleaseContext();
+	renderThread = std::thread(&World::RenderLoop, this);
+}
+
+void World::StopRenderThread()
+{
+	if (!renderThread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(frameMutex);
+		renderThreadRunning = false;
+	}
+	frameCondition.notify_all();
+
+	renderThread.join();
+	window->MakeCurrentContext();
+}
+
+void World::RenderLoop()
+{
+	window->MakeCurrentContext();
+	JobSystem::AttachThread();
+
+	double previousFrameTime = Engine::GetElapsedTime();
+
+	while (true)
+	{
+		// Wait for the simulation of the next frame
+		{
+			std::unique_lock<std::mutex> lock(frameMutex);
+			frameCondition.wait(lock, [this] { return !renderThreadRunning || acquiredFrames < simulatedFrames; });
+			if (!renderThreadRunning)
+				break;
+		}
+
+		// Once it is taken, the main thread can go on with the simulation of the frame after it
+		bool acquired = AcquireFrame();
+		double inputTime;
+		{
+			std::lock_guard<std::mutex> lock(frameMutex);
+			acquiredFrames++;
+			inputTime = simulatedInputTime;
+		}
+		frameCondition.notify_all();
+
+		AssetLoader::Update();
+		ShaderManager::Update();
+
+		double frameTime = Engine::GetElapsedTime();
+		if (acquired)
+		{
+			pacer.WaitForGPU();
+			FrameStart();
+			Update(static_cast<float>(frameTime - previousFrameTime));
+			FrameEnd();
+		}
+		previousFrameTime = frameTime;
+
+		window->SwapBuffers();
+		if (acquired)
+		{
+			pacer.FenceFrame();
+			RecordInputLatency(inputTime);
+		}
+	}
+
+	JobSystem::DetachThread();
+	window->ReleaseContext();
+}
+
 void World::ComputeFrameDeltaTime()
 {
 	elapsedTime = Engine::GetElapsedTime();
@@ -51,6 +160,41 @@ void World::ComputeFrameDeltaTime()
 
 void World::LoopUpdate()
 {
+	if (renderThreadRunning)
+	{
+		// The render thread draws the frames (and swaps the buffers), the simulation stays at most
+		// one frame ahead of it: it waits for the last simulated frame to be taken
+		{
+			std::unique_lock<std::mutex> lock(frameMutex);
+			frameCondition.wait(lock, [this] { return !renderThreadRunning || acquiredFrames == simulatedFrames; });
+		}
+
+		// Then for the start of the frame, the input is polled after every wait so it is as recent as possible
+		pacer.WaitForFrame();
+		window->PollEvents();
+		ComputeFrameDeltaTime();
+		window->UpdateObservers();
+
+		Simulate(static_cast<float>(deltaTime));
+
+		{
+			std::lock_guard<std::mutex> lock(frameMutex);
+			simulatedFrames++;
+			simulatedInputTime = window->GetInputTime();
+		}
+		frameCondition.notify_all();
+		return;
+	}
+
+	// Upload the assets that finished loading in the background
+	AssetLoader::Update();
+
+	// Swap in the shaders rebuilt in the background
+	ShaderManager::Update();
+
+	// Waits for the start of the frame, the input is polled after it
+	pacer.WaitForFrame();
+
 	// Polls and buffers the events
 	window->PollEvents();
 
@@ -63,10 +207,55 @@ void World::LoopUpdate()
 	window->UpdateObservers();
 
 	// Frame processing
-	FrameStart();
-	Update(static_cast<float>(deltaTime));
-	FrameEnd();
+	Simulate(static_cast<float>(deltaTime));
+	bool acquired = AcquireFrame();
+	if (acquired)
+	{
+		pacer.WaitForGPU();
+		FrameStart();
+		Update(static_cast<float>(deltaTime));
+		FrameEnd();
+	}
 
 	// Swap front and back buffers - image will be displayed to the screen
 	window->SwapBuffers();
+	if (acquired)
+	{
+		pacer.FenceFrame();
+		RecordInputLatency(window->GetInputTime());
+	}
+}
+
+void World::RecordInputLatency(double inputTime)
+{
+	if (inputTime < 0)
+		return;
+
+	double latency = Engine::GetElapsedTime() - inputTime;
+	inputLatency.last = latency;
+	inputLatency.average = inputLatency.frames ? inputLatency.average * 0.9 + latency * 0.1 : latency;
+	inputLatency.worst = std::max(inputLatency.worst, latency);
+	inputLatency.frames++;
+}
+
+const InputLatency& World::GetInputLatency() const
+{
+	return inputLatency;
+}
+
+void World::PrintInputLatency()
+{
+	if (!inputLatency.frames) {
+		std::cout << "Input latency: no input yet" << std::endl;
+		return;
+	}
+
+	std::cout << "Input latency: " << inputLatency.average * 1000 << " ms (average), " << inputLatency.last * 1000 << " ms (last), "
+		<< inputLatency.worst * 1000 << " ms (worst)" << std::endl;
+	inputLatency.worst = 0;
+}
+
+void World::PrintFramePacing()
+{
+	pacer.PrintStatistics();
 }
\ No newline at end of file
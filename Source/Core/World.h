@@ -1,11 +1,25 @@
 #pragma once
 
 #include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 class Mesh;
 class Shader;
 
 #include "Window/InputController.h"
+#include "FramePacer.h"
+
+// The time from the input callbacks to the swap of the first frame simulated with them, in seconds
+// The oldest event handled by each frame is measured, the display adds its scan-out on top
+struct InputLatency
+{
+	double last = 0;
+	double average = 0;
+	double worst = 0;
+	unsigned int frames = 0;
+};
 
 class World : public InputController
 {
@@ -23,14 +37,67 @@ class World : public InputController
 
 		virtual double GetLastFrameTime() final;
 
+		// Draws the frames on a render thread owning the OpenGL context, while the main thread
+		// polls the input and simulates the next frame. Set before Run
+		virtual void SetRenderThread(bool enabled) final;
+
+		// Joins the render thread and makes the context current on the calling thread again
+		virtual void StopRenderThread() final;
+
+		// Starts the frames at a fixed rate (0 leaves the pacing to vSync), the input is sampled
+		// right after the wait, just before the simulation
+		virtual void SetFrameRate(double framesPerSecond) final;
+
+		// Keeps the OpenGL thread at most "frames" frames ahead of the GPU (0 doesn't limit it). Set before Run
+		virtual void SetFramesInFlight(unsigned int frames) final;
+
+	protected:
+		// Updates the state of the world on the main thread, before the frame is drawn
+		// With the render thread, the simulation of a frame overlaps the drawing of the previous one
+		virtual void Simulate(float deltaTimeSeconds) {};
+
+		// Takes the newest frame published by Simulate, on the thread that draws it (before FrameStart)
+		// Nothing is drawn if it returns false
+		virtual bool AcquireFrame() { return true; };
+
+		// The input latency of the frames drawn, read on the thread that draws them
+		const InputLatency& GetInputLatency() const;
+
+		// Prints the input latency, the worst one is measured again from there
+		void PrintInputLatency();
+
+		// Prints the frame period, jitter and waits since the last print
+		void PrintFramePacing();
+
 	private:
 		void ComputeFrameDeltaTime();
 		void LoopUpdate();
 
+		void StartRenderThread();
+		void RenderLoop();
+
+		// Measures the latency of a frame once it is swapped, "inputTime" is negative if it had no input
+		void RecordInputLatency(double inputTime);
+
 	private:
 		double previousTime;
 		double elapsedTime;
 		double deltaTime;
 		bool paused;
 		bool shouldClose;
+
+		// The render thread draws the frames simulated on the main thread, at most one frame behind
+		bool renderThreadEnabled;
+		bool renderThreadRunning;
+		std::thread renderThread;
+		std::mutex frameMutex;
+		std::condition_variable frameCondition;
+		unsigned long long simulatedFrames;
+		unsigned long long acquiredFrames;
+
+		// The time of the input of the last simulated frame, handed to the render thread with it
+		double simulatedInputTime;
+		InputLatency inputLatency;
+
+		FramePacer pacer;
 };
\ No newline at end of file
@@ -1,29 +1,113 @@
 #include <ctime>
+#include <string>
 #include <iostream>
 
 using namespace std;
 
 #include <Core/Engine.h>
 #include <src/GameManager.hpp>
+#include <src/SkyroadsEnv.hpp>
 
 int main(int argc, char **argv)
 {
 	srand((unsigned int)time(NULL));
 
+	bool benchmarkNoise = false;
+	bool offscreen = false;
+	bool renderThread = true;
+	string capturePath;
+	FrameCapture::Format captureFormat = FrameCapture::Format::PNG_SEQUENCE;
+	unsigned int frameLimit = 0;
+	unsigned int envGames = 0;
+	double frameRate = 0;
+	unsigned int framesInFlight = 0;
+	bool checkAllocations = false;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--bench-noise")
+			benchmarkNoise = true;
+		else if (arg == "--offscreen")
+			offscreen = true;
+		else if (arg == "--capture" && i + 1 < argc)
+			capturePath = argv[++i];
+		else if (arg == "--capture-raw")
+			captureFormat = FrameCapture::Format::RAW_VIDEO;
+		else if (arg == "--frames" && i + 1 < argc)
+			frameLimit = (unsigned int)stoul(argv[++i]);
+		else if (arg == "--no-render-thread")
+			renderThread = false;
+		else if (arg == "--bench-env" && i + 1 < argc)
+			envGames = (unsigned int)stoul(argv[++i]);
+		else if (arg == "--fps" && i + 1 < argc)
+			frameRate = stod(argv[++i]);
+		else if (arg == "--frames-in-flight" && i + 1 < argc)
+			framesInFlight = (unsigned int)stoul(argv[++i]);
+		else if (arg == "--check-allocations")
+			checkAllocations = true;
+	}
+
+#ifndef COUNT_ALLOCATIONS
+	// The allocations are only counted in the Debug builds
+	if (checkAllocations) {
+		cerr << "--check-allocations needs a build with COUNT_ALLOCATIONS (the Debug configurations)" << endl;
+		return 1;
+	}
+#endif
+
+	// Step a batch of headless games, without a window
+	if (envGames > 0) {
+		JobSystem::Init();
+		Skyroads::SkyroadsEnv env(envGames);
+		env.Benchmark(Skyroads::EnvConstants::benchmarkSteps);
+		JobSystem::Shutdown();
+		return 0;
+	}
+
 	// Create a window property structure
 	WindowProperties wp;
 	wp.resolution = glm::ivec2(1280, 720);
 
+	// The off-screen runs (recordings, golden images) don't need a visible window
+	wp.visible = !offscreen;
+
 	// Init the Engine and create a new window with the defined properties
 	WindowObject* window = Engine::Init(wp);
 
 	// Create a new 3D world and start running it
-	World *world = new Skyroads::GameManager();
+	Skyroads::GameManager *world = new Skyroads::GameManager();
 	world->Init();
-	world->Run();
+
+	if (offscreen)
+		world->EnableOffscreen();
+	if (!capturePath.empty())
+		world->StartCapture(capturePath, captureFormat);
+	world->SetFrameLimit(frameLimit);
+
+	// Draw the frames on their own thread, while the next one is simulated
+	world->SetRenderThread(renderThread);
+
+	// Pace the frames without vSync (set while the main thread owns the context), and limit the frames queued on the GPU
+	if (frameRate > 0) {
+		window->SetVSync(false);
+		world->SetFrameRate(frameRate);
+	}
+	world->SetFramesInFlight(framesInFlight);
+
+	// Fail if a steady frame allocates
+	if (checkAllocations)
+		world->EnableAllocationCheck();
+
+	// Compare the analytic and the baked noise, instead of playing
+	if (benchmarkNoise)
+		world->BenchmarkNoise();
+	else
+		world->Run();
+
+	bool allocated = world->AllocationCheckFailed();
 
 	// Signals to the Engine to release the OpenGL context
 	Engine::Exit();
 
-	return 0;
+	return allocated ? 1 : 0;
 }
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// A view of contiguous values owned by someone else (an array, a vector or a frame arena), passed
+// by value instead of the container. The values must outlive the view.
+template <class T>
+class Span
+{
+	public:
+		Span() : items(nullptr), count(0) {}
+		Span(T *items, size_t count) : items(items), count(count) {}
+
+		template <class Allocator>
+		Span(std::vector<T, Allocator> &values) : items(values.data()), count(values.size()) {}
+
+		T* data() const { return items; }
+		size_t size() const { return count; }
+		bool empty() const { return count == 0; }
+
+		T& operator[](size_t index) const { return items[index]; }
+
+		T* begin() const { return items; }
+		T* end() const { return items + count; }
+
+		// The first "length" values
+		Span<T> first(size_t length) const { return Span<T>(items, length < count ? length : count); }
+
+	private:
+		T *items;
+		size_t count;
+};
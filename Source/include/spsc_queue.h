@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// A fixed ring of values passed from one thread to another without locks, in order
+// The producer pushes at the tail and the consumer pops at the head: each index is written by a
+// single thread, and released once the value it guards is written (or read). Nothing is allocated
+// after the construction, a value pushed in a full queue is refused.
+// Only one thread may push and only one may pop.
+template <class T, size_t Capacity>
+class SPSCQueue
+{
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "The capacity must be a power of 2");
+
+	public:
+		SPSCQueue() : head(0), tail(0) {}
+
+		// Adds a value at the tail, returns false (and drops it) if the queue is full
+		bool Push(const T &value)
+		{
+			size_t index = tail.load(std::memory_order_relaxed);
+			if (index - head.load(std::memory_order_acquire) == Capacity) return false;
+
+			items[index & (Capacity - 1)] = value;
+			tail.store(index + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Takes the value at the head, returns false if the queue is empty
+		bool Pop(T &value)
+		{
+			size_t index = head.load(std::memory_order_relaxed);
+			if (index == tail.load(std::memory_order_acquire)) return false;
+
+			value = items[index & (Capacity - 1)];
+			head.store(index + 1, std::memory_order_release);
+			return true;
+		}
+
+		bool IsEmpty() const
+		{
+			return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+		}
+
+		// The values queued, exact for the producer and the consumer (the other thread can only
+		// make it smaller, or bigger, meanwhile)
+		size_t Size() const
+		{
+			return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+		}
+
+	private:
+		// On their own cache lines, so the producer and the consumer don't write to the same one
+		alignas(64) std::atomic<size_t> head;
+		alignas(64) std::atomic<size_t> tail;
+		alignas(64) T items[Capacity];
+};
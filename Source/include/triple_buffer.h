@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+
+// Hands the newest version of a value from one thread to another without locks
+// The writer fills its buffer and publishes it, the reader takes the newest published buffer:
+// the third buffer holds the last published one in between, so neither side ever waits for the
+// other. A buffer published while the previous one wasn't taken replaces it.
+// Only one thread may write and only one may read.
+template <class T>
+class TripleBuffer
+{
+	public:
+		TripleBuffer() : writeIndex(0), readIndex(1), middle(2) {}
+
+		// The buffer filled by the writer, its previous content is the one of an older version
+		T& GetWriteBuffer()
+		{
+			return buffers[writeIndex];
+		}
+
+		// Makes the write buffer the newest version, the writer gets another buffer
+		void Publish()
+		{
+			writeIndex = middle.exchange(writeIndex | FRESH, std::memory_order_acq_rel) & INDEX;
+		}
+
+		// Takes the newest version, if one was published since the last call
+		// Returns false (and keeps the current read buffer) if there isn't one
+		bool Acquire()
+		{
+			if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+			readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & INDEX;
+			return true;
+		}
+
+		// The buffer taken by the last Acquire, the reader can use it until the next one
+		T& GetReadBuffer()
+		{
+			return buffers[readIndex];
+		}
+
+	private:
+		// The middle holds the index of a buffer, and whether it was published since the reader took one
+		static const int INDEX = 3;
+		static const int FRESH = 4;
+
+		T buffers[3];
+		int writeIndex;
+		int readIndex;
+		std::atomic<int> middle;
+};
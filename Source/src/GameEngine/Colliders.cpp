@@ -30,21 +30,11 @@ GameEngine::ColliderType GameEngine::Collider::getColliderType() const
     return type;
 }
 
-GameEngine::Collider::Collider(const Collider& other)
-{
-    gameObjectID = other.gameObjectID;
-    type = other.type;
-    _affectsPhysics = other._affectsPhysics;
-    radius = other.radius;
-    position = other.position;
-    dimensions = other.dimensions;
-}
-
 GameEngine::Collider::Collider(const long int id, const glm::vec3& pos, const glm::vec3& dim)
 {
     gameObjectID = id;
     _affectsPhysics = false;
-    position = position;
+    position = pos;
     dimensions = dim;
     radius = 0;
     type = ColliderType::BoxCollider;
@@ -70,6 +60,13 @@ GameEngine::Collider::Collider(const long int id, const glm::vec3& pos, const do
     type = ColliderType::SphereCollider;
 }
 
+void GameEngine::Collider::getBounds(glm::vec3& min, glm::vec3& max) const
+{
+    glm::vec3 halfSize = type == ColliderType::SphereCollider ? glm::vec3((float)radius) : dimensions / 2.f;
+    min = position - halfSize;
+    max = position + halfSize;
+}
+
 double GameEngine::Collider::getRadius() const
 {
     return radius;
@@ -20,8 +20,9 @@ namespace GameEngine {
         glm::vec3 dimensions;
 
     public:
-        // Copy Constructor
-        Collider(const Collider& other);
+        // Copy Constructor and assignment
+        Collider(const Collider& other) = default;
+        Collider& operator=(const Collider& other) = default;
 
         /// <summary>
         /// Create a new box collider, with a specific dimensions, linked to a gameObject with a specific id
@@ -88,6 +89,13 @@ namespace GameEngine {
         /// <param name="dim">The new dimensions</param>
         void setDimensions(const glm::vec3& dim);
 
+        /// <summary>
+        /// Get the axis aligned bounding box of the collider
+        /// </summary>
+        /// <param name="min">The corner with the lowest coordinates</param>
+        /// <param name="max">The corner with the highest coordinates</param>
+        void getBounds(glm::vec3& min, glm::vec3& max) const;
+
         /// <summary>
         /// Get the radius of the sphere
         /// </summary>
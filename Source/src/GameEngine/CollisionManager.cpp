@@ -1,14 +1,26 @@
 #include "CollisionManager.hpp"
 
-std::vector<int> GameEngine::CollisionManager::getCollisions(const Collider& source, std::vector<Collider*> others)
+Span<int> GameEngine::CollisionManager::getCollisions(const Collider& source, Span<const Collider*> others, FrameArena& arena)
 {
-    std::vector<int> collided;
+    Span<int> collided = arena.Allocate<int>(others.size());
+    size_t collisions = 0;
     for (auto& other : others) {
         if (isCollision(source, *other)) {
-            collided.push_back(other->getID());
+            collided[collisions++] = other->getID();
         }
     }
-    return collided;
+    return collided.first(collisions);
+}
+
+size_t GameEngine::CollisionManager::getCollisions(const Collider& source, const Collider* others, size_t count, size_t* collided)
+{
+    size_t collisions = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (isCollision(source, others[i])) {
+            collided[collisions++] = i;
+        }
+    }
+    return collisions;
 }
 
 GameEngine::CollisionManager::CollisionManager(){}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <Core/FrameArena.h>
 #include "Colliders.hpp"
 
 namespace GameEngine {
@@ -9,9 +10,20 @@ namespace GameEngine {
 		/// Check for all collisions between an objects collider and some other colliders
 		/// </summary>
 		/// <param name="source">The collider of the object</param>
-		/// <param name="others">An vector with the colliders of all the other objects</param>
-		/// <returns>An array with the id's of all the objects this one collided with</returns>
-		static std::vector<int> getCollisions(const Collider& source, std::vector<Collider*> others);
+		/// <param name="others">The colliders of all the other objects</param>
+		/// <param name="arena">The arena of the frame, the result is allocated in it</param>
+		/// <returns>The id's of all the objects this one collided with</returns>
+		static Span<int> getCollisions(const Collider& source, Span<const Collider*> others, FrameArena& arena);
+
+		/// <summary>
+		/// Check for all collisions between an objects collider and an array of colliders, without allocating
+		/// </summary>
+		/// <param name="source">The collider of the object</param>
+		/// <param name="others">The array of the other colliders</param>
+		/// <param name="count">The number of colliders in the array</param>
+		/// <param name="collided">Filled with the indices (in the array) of the colliders this one collided with, it must hold "count" of them</param>
+		/// <returns>The number of collisions</returns>
+		static size_t getCollisions(const Collider& source, const Collider* others, size_t count, size_t* collided);
 	private:
 		CollisionManager();
 		static bool isCollision(const Collider& a, const Collider& b);
@@ -0,0 +1,77 @@
+#include "Displacement.hpp"
+
+#include <Core/GPU/GPUBuffers.h>
+
+/// <summary>
+/// The location of the displaced attribute, after the ones used by the meshes
+/// </summary>
+#define DISPLACED_ATTRIBUTE_LOC 4
+
+GameEngine::Displacement::Displacement() : meshVAO(0), captureVAO(0), feedbackBuffer(0), vertexCount(0) {}
+
+GameEngine::Displacement::~Displacement()
+{
+	if (captureVAO) glDeleteVertexArrays(1, &captureVAO);
+	if (feedbackBuffer) glDeleteBuffers(1, &feedbackBuffer);
+}
+
+void GameEngine::Displacement::CreateBuffers(Mesh* mesh)
+{
+	const GPUBuffers* buffers = mesh->GetBuffers();
+	vertexCount = (unsigned int)mesh->positions.size();
+	meshVAO = buffers->VAO;
+
+	if (!feedbackBuffer) glGenBuffers(1, &feedbackBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, feedbackBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(glm::vec4), NULL, GL_DYNAMIC_COPY);
+
+	// The capture reads the positions and normals straight from the mesh buffers
+	// It can't use the mesh VAO, that one also reads the buffer being written
+	if (!captureVAO) glGenVertexArrays(1, &captureVAO);
+	glBindVertexArray(captureVAO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffers->VBO[0]);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffers->VBO[1]);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
+
+	// Every pass drawing the mesh can read the displaced vertices
+	glBindVertexArray(meshVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, feedbackBuffer);
+	glEnableVertexAttribArray(DISPLACED_ATTRIBUTE_LOC);
+	glVertexAttribPointer(DISPLACED_ATTRIBUTE_LOC, 4, GL_FLOAT, GL_FALSE, 0, 0);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+bool GameEngine::Displacement::Update(Mesh* mesh, Shader* shader, float time)
+{
+	if (mesh == nullptr || shader == nullptr || !mesh->GetBuffers()->VAO || !shader->GetProgramID()) return false;
+
+	// First use, or the mesh was uploaded again
+	if (meshVAO != mesh->GetBuffers()->VAO) {
+		CreateBuffers(mesh);
+	}
+
+	shader->Use();
+	glUniform1f(glGetUniformLocation(shader->program, "time"), time);
+
+	// One point per vertex, nothing is rasterized
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBindVertexArray(captureVAO);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, feedbackBuffer);
+
+	glBeginTransformFeedback(GL_POINTS);
+	glDrawArrays(GL_POINTS, 0, vertexCount);
+	glEndTransformFeedback();
+
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	glBindVertexArray(0);
+	glDisable(GL_RASTERIZER_DISCARD);
+
+	return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Core/Engine.h>
+
+namespace GameEngine {
+	/// <summary>
+	/// Displaces the vertices of a mesh once per frame, with transform feedback. The "Displace"
+	/// shader writes vec4(position, noise) for every vertex into a buffer, which is attached to
+	/// the mesh VAO as attribute 4. Every pass that draws the mesh afterwards (with a shader that
+	/// reads that attribute, like "Displaced") reuses the result instead of computing the noise.
+	/// The displacement only depends on the vertex and the time, so all the objects sharing the
+	/// mesh share the buffer as well.
+	/// </summary>
+	class Displacement
+	{
+	public:
+		Displacement();
+		~Displacement();
+
+		/// <summary>
+		/// Compute the displaced vertices for this frame
+		/// </summary>
+		/// <param name="mesh">The mesh, its VAO gets the displaced attribute</param>
+		/// <param name="shader">The shader writing the "displaced" output</param>
+		/// <param name="time">The time used by the animation</param>
+		/// <returns>False if the mesh isn't uploaded yet (nothing was displaced)</returns>
+		bool Update(Mesh* mesh, Shader* shader, float time);
+
+	private:
+		/// <summary>
+		/// (Re)create the buffers, after the mesh was uploaded
+		/// </summary>
+		void CreateBuffers(Mesh* mesh);
+
+		/// <summary>
+		/// The VAO of the mesh that was given the displaced attribute
+		/// </summary>
+		GLuint meshVAO;
+
+		/// <summary>
+		/// The VAO used to read the mesh vertices during the capture
+		/// </summary>
+		GLuint captureVAO;
+
+		/// <summary>
+		/// The buffer with the displaced vertices
+		/// </summary>
+		GLuint feedbackBuffer;
+
+		unsigned int vertexCount;
+	};
+}
@@ -0,0 +1,120 @@
+#include "DynamicResolution.hpp"
+
+#include <cmath>
+
+#include <include/math.h>
+
+using namespace GameEngine::DynamicResolutionConstants;
+
+GameEngine::DynamicResolution::DynamicResolution() : enabled(true), scale(maxScale), frameTime(0), settle(0), timingFrame(0)
+{
+	for (int frame = 0; frame < timingLatency; frame++) {
+		queries[frame][0] = queries[frame][1] = 0;
+		queryIssued[frame] = false;
+	}
+}
+
+GameEngine::DynamicResolution::~DynamicResolution()
+{
+	if (queries[0][0]) glDeleteQueries(timingLatency * 2, &queries[0][0]);
+}
+
+void GameEngine::DynamicResolution::Init()
+{
+	glGenQueries(timingLatency * 2, &queries[0][0]);
+}
+
+void GameEngine::DynamicResolution::BeginFrame()
+{
+	if (!queries[0][0]) return;
+
+	if (CollectTiming()) UpdateScale();
+
+	// Timestamps instead of a GL_TIME_ELAPSED query: the post-processing passes are timed with
+	// those, and they can't be nested
+	glQueryCounter(queries[timingFrame][0], GL_TIMESTAMP);
+}
+
+void GameEngine::DynamicResolution::EndFrame()
+{
+	if (!queries[0][0]) return;
+
+	glQueryCounter(queries[timingFrame][1], GL_TIMESTAMP);
+	queryIssued[timingFrame] = true;
+	timingFrame = (timingFrame + 1) % timingLatency;
+}
+
+bool GameEngine::DynamicResolution::CollectTiming()
+{
+	// The slot about to be reused holds the queries of timingLatency frames ago
+	if (!queryIssued[timingFrame]) return false;
+
+	GLint available = 0;
+	glGetQueryObjectiv(queries[timingFrame][1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) return false;
+
+	GLuint64 start = 0, end = 0;
+	glGetQueryObjectui64v(queries[timingFrame][0], GL_QUERY_RESULT, &start);
+	glGetQueryObjectui64v(queries[timingFrame][1], GL_QUERY_RESULT, &end);
+	queryIssued[timingFrame] = false;
+
+	double time = (end - start) / 1e6;
+	frameTime = frameTime > 0 ? frameTime + (time - frameTime) * timingSmoothing : time;
+	return true;
+}
+
+void GameEngine::DynamicResolution::UpdateScale()
+{
+	// Drop the frames drawn (or still in flight) at the previous scale
+	if (settle > 0) {
+		settle--;
+		frameTime = 0;
+		return;
+	}
+	if (!enabled || frameTime <= 0) return;
+
+	// The frame time is roughly proportional to the pixels, so to the square of the scale
+	float target = scale * (float)std::sqrt(targetFrameTime / frameTime);
+	target = MIN(MAX(target, minScale), maxScale);
+
+	// Whole steps, rounded down: over the budget it always drops at least one, under it a
+	// partial step isn't worth reallocating the target
+	float next = (std::round(scale / scaleStep) + std::floor((target - scale) / scaleStep)) * scaleStep;
+	next = MIN(MAX(next, minScale), maxScale);
+
+	if (next > scale && frameTime > targetFrameTime * upscaleHeadroom) return;
+	if (std::abs(next - scale) < scaleStep / 2) return;
+
+	scale = next;
+	settle = settleFrames;
+}
+
+glm::ivec2 GameEngine::DynamicResolution::GetResolution(const glm::ivec2& resolution) const
+{
+	if (!enabled) return resolution;
+	return glm::max(glm::ivec2(glm::vec2(resolution) * scale + 0.5f), glm::ivec2(1));
+}
+
+void GameEngine::DynamicResolution::SetEnabled(bool enabled)
+{
+	this->enabled = enabled;
+	if (!enabled) {
+		scale = maxScale;
+		frameTime = 0;
+	}
+}
+
+bool GameEngine::DynamicResolution::IsEnabled() const
+{
+	return enabled;
+}
+
+float GameEngine::DynamicResolution::GetScale() const
+{
+	return enabled ? scale : maxScale;
+}
+
+double GameEngine::DynamicResolution::GetFrameTime() const
+{
+	return frameTime;
+}
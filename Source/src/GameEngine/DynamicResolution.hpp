@@ -0,0 +1,113 @@
+#pragma once
+
+#include <Core/Engine.h>
+
+namespace GameEngine {
+	namespace DynamicResolutionConstants {
+		/// <summary>
+		/// The GPU time a frame should take (in milliseconds), leaving some room under 60 FPS
+		/// </summary>
+		const double targetFrameTime = 14.;
+
+		/// <summary>
+		/// The resolution only grows back while the frames take less than this part of the target
+		/// (otherwise it would go up and down every few frames)
+		/// </summary>
+		const double upscaleHeadroom = 0.8;
+
+		/// <summary>
+		/// The range of the scale of the scene (on each axis), and the steps it changes by. The
+		/// scene target is reallocated when the scale changes, so it only takes a few values.
+		/// </summary>
+		const float minScale = 0.5f;
+		const float maxScale = 1.f;
+		const float scaleStep = 0.05f;
+
+		/// <summary>
+		/// The frames a timer query is given before its result is read (it doesn't stall then)
+		/// </summary>
+		const int timingLatency = 3;
+
+		/// <summary>
+		/// The frames to wait after a change of the scale, until the timings measure the new one
+		/// </summary>
+		const int settleFrames = 10;
+
+		/// <summary>
+		/// The weight of a new frame time in the average
+		/// </summary>
+		const double timingSmoothing = 0.2;
+	}
+
+	/// <summary>
+	/// Scales the resolution the scene is drawn at to keep the GPU time of a frame under a
+	/// budget. The time of the scene passes is measured with timestamp queries (read a few
+	/// frames later), and since the cost of a fill-rate bound frame follows the number of
+	/// pixels, the scale is corrected by the square root of the budget over the measured time.
+	/// The scene is then upscaled to the output by the post-processing.
+	/// </summary>
+	class DynamicResolution
+	{
+	public:
+		DynamicResolution();
+		~DynamicResolution();
+
+		/// <summary>
+		/// Create the timer queries
+		/// </summary>
+		void Init();
+
+		/// <summary>
+		/// Start measuring a frame, and update the scale with the frames measured so far
+		/// </summary>
+		void BeginFrame();
+
+		/// <summary>
+		/// Stop measuring the frame (after the last pass drawn at the scaled resolution)
+		/// </summary>
+		void EndFrame();
+
+		/// <summary>
+		/// Get the resolution the scene is drawn at
+		/// </summary>
+		/// <param name="resolution">The resolution of the output</param>
+		/// <returns>The scaled resolution</returns>
+		glm::ivec2 GetResolution(const glm::ivec2& resolution) const;
+
+		/// <summary>
+		/// Turn the scaling on or off (the scene is drawn at full resolution when it is off)
+		/// </summary>
+		/// <param name="enabled">Whether the scaling is on</param>
+		void SetEnabled(bool enabled);
+		bool IsEnabled() const;
+
+		float GetScale() const;
+
+		/// <summary>
+		/// Get the GPU time of the scene passes, averaged over the last frames
+		/// </summary>
+		/// <returns>The time in milliseconds</returns>
+		double GetFrameTime() const;
+
+	private:
+		/// <summary>
+		/// Read the queries of the oldest frame, if they are done
+		/// </summary>
+		/// <returns>Whether a new frame time was read</returns>
+		bool CollectTiming();
+
+		/// <summary>
+		/// Choose the scale of the next frames from the frame time
+		/// </summary>
+		void UpdateScale();
+
+		bool enabled;
+		float scale;
+		double frameTime;
+		int settle;
+
+		GLuint queries[DynamicResolutionConstants::timingLatency][2];
+		bool queryIssued[DynamicResolutionConstants::timingLatency];
+		int timingFrame;
+	};
+}
@@ -2,40 +2,55 @@
 
 #include <iostream>
 
-long int GameEngine::GameObject::currentMaxID = 0;
+std::atomic<long int> GameEngine::GameObject::currentMaxID(0);
 std::unordered_map<std::string, Mesh*>* GameEngine::GameObject::meshes = nullptr;
-std::unordered_map<std::string, Shader*>* GameEngine::GameObject::shaders = nullptr;
+ShaderVariants* GameEngine::GameObject::shaderVariants = nullptr;
+GameEngine::ClusteredLighting* GameEngine::GameObject::lighting = nullptr;
+GameEngine::ShadowMaps* GameEngine::GameObject::shadows = nullptr;
+
+namespace {
+	/// <summary>
+	/// The mesh of an object, looked up without inserting it (the UI objects are created on the
+	/// render thread while the platforms spawn on the main thread)
+	/// </summary>
+	Mesh* findMesh(const char* name) {
+		auto mesh = GameEngine::GameObject::meshes->find(name);
+		return mesh != GameEngine::GameObject::meshes->end() ? mesh->second : nullptr;
+	}
+}
 
-GameEngine::GameObject::GameObject() : id(-1), type(""), isInJump(false), distortedTime(0) , _isRendered(true), position(glm::vec3(0)), mesh(nullptr), shader(nullptr), collider(nullptr) {};
+GameEngine::GameObject::GameObject() : id(-1), type(""), isInJump(false), distortedTime(0) , _isRendered(true), position(glm::vec3(0)), mesh(nullptr), shaderFeatures(0), collider(-1, glm::vec3(0), 0.0), hasCollider(false) {};
 
-GameEngine::GameObject::GameObject(const std::string& type, const glm::vec3& position) : type(type), position(position), distortedTime(0), mesh(nullptr), shader(nullptr), collider(nullptr) {
-	id = currentMaxID++;
+GameEngine::GameObject::GameObject(const std::string& type, const glm::vec3& position, const long int objectID) : type(type), position(position), distortedTime(0), mesh(nullptr), shaderFeatures(0), collider(-1, position, 0.0), hasCollider(false) {
+	id = objectID < 0 ? currentMaxID++ : objectID;
 	_isRendered = true;
 	isInJump = false;
 
 	if (type == "player") {
 		scale = glm::vec3(ObjectConstants::playerHeight);
-		mesh = (*meshes)["sphere"];
-		shader = (*shaders)["Distorted"];
+		mesh = findMesh("sphere");
+		shaderFeatures = ShaderFeatures::LIT | ShaderFeatures::NOISE | ShaderFeatures::NOISE_TEXTURE;
 		lightingInfo = { 5.f, 0.5f, .25f };
 
 		color = glm::vec3(1, 0, 0);
-		collider = new Collider(id, position, ObjectConstants::playerHeight / 2);
+		collider = Collider(id, position, ObjectConstants::playerHeight / 2);
+		hasCollider = true;
 
 		rigidbody.state.x = position;
-		rigidbody.state.gravity_coef = .15f;
+		rigidbody.state.gravity_coef = ObjectConstants::playerGravity;
 	}
 	else if (type.rfind("platform_", 0) == 0) {
-		scale = glm::vec3(1, 0.25f, ObjectConstants::platformLength);
-		mesh = (*meshes)["box"];
-		shader = (*shaders)["Base"];
+		scale = ObjectConstants::platformScale;
+		mesh = findMesh("box");
+		shaderFeatures = ShaderFeatures::LIT;
 		lightingInfo = { 0.1f, 0.99f, .001f };
 
 		// Compute the Y component of the position
 		this->position.y = ObjectConstants::platformTopHeight - scale.y / 2;
 
-		collider = new Collider(id, this->position, scale);
-		collider->affectsPhysics(true);
+		collider = Collider(id, this->position, scale);
+		collider.affectsPhysics(true);
+		hasCollider = true;
 
 		rigidbody.state.x = this->position;
 		rigidbody.physics_enabled = false;
@@ -44,12 +59,13 @@ GameEngine::GameObject::GameObject(const std::string& type, const glm::vec3& pos
 	}
 	else if (type == "sphere") {
 		scale = glm::vec3(0.1);
-		mesh = (*meshes)["sphere"];
-		shader = (*shaders)["Base"];
+		mesh = findMesh("sphere");
+		shaderFeatures = ShaderFeatures::LIT;
 		lightingInfo = { 5.f, 0.5f, .25f };
 
 		color = glm::vec3(1, 0, 0);
-		collider = new Collider(id, position, 0.1);
+		collider = Collider(id, position, 0.1);
+		hasCollider = true;
 
 		rigidbody.state.x = this->position;
 		rigidbody.physics_enabled = false;
@@ -57,24 +73,24 @@ GameEngine::GameObject::GameObject(const std::string& type, const glm::vec3& pos
 	else if (type == "fuelbar") {
 		scale = glm::vec3(1, 1, 1);
 
-		mesh = (*meshes)["box"];
-		shader = (*shaders)["UI"];
+		mesh = findMesh("box");
+		shaderFeatures = ShaderFeatures::UI;
 
 		color = glm::vec3(0.9, 0.6, 0.2);
 	}
 	else if (type == "ufuelbar") {
 		scale = glm::vec3(1, 1, 0.5);
 
-		mesh = (*meshes)["box"];
-		shader = (*shaders)["UI"];
+		mesh = findMesh("box");
+		shaderFeatures = ShaderFeatures::UI;
 
 		color = glm::vec3(0.5);
 	}
 	else if (type == "life") {
 		scale = glm::vec3(0.125);
 
-		mesh = (*meshes)["box"];
-		shader = (*shaders)["UI"];
+		mesh = findMesh("box");
+		shaderFeatures = ShaderFeatures::UI;
 
 		color = glm::vec3(0.7, 0.1, 0.2);
 	}
@@ -86,6 +102,11 @@ void GameEngine::GameObject::UpdatePlatformData()
 	if (type.rfind("platform_", 0) != 0) return;
 
 	std::string color_string = type.substr(type.find("_") + 1);
+
+	// The power-up platforms glow
+	bool emissive = color_string == "orange" || color_string == "green" || color_string == "white";
+	lightingInfo.materialEmission = emissive ? ObjectConstants::platformEmission : 0.f;
+
 	if (color_string == "red") {
 		color = glm::vec3(1, 0, 0);
 	}
@@ -109,22 +130,7 @@ void GameEngine::GameObject::UpdatePlatformData()
 	}
 }
 
-GameEngine::GameObject::GameObject(const GameObject& other)
-{
-	id = other.id;
-	_isRendered = other._isRendered;
-	position = other.position;
-	type = other.type;
-	scale = other.scale;
-	mesh = other.mesh;
-	shader = other.shader;
-	color = other.color;
-	collider = other.collider;
-	lightingInfo = other.lightingInfo;
-	rigidbody = other.rigidbody;
-}
-
-void GameEngine::GameObject::Render(GameEngine::Camera *camera, const glm::vec3& lightLocation)
+void GameEngine::GameObject::Render(GameEngine::Camera *camera, const glm::vec3& lightLocation, const unsigned int extraFeatures)
 {
 	glm::mat4 matrix = glm::mat4(1);
 	matrix = Translate(matrix, position);
@@ -132,30 +138,75 @@ void GameEngine::GameObject::Render(GameEngine::Camera *camera, const glm::vec3&
 
 	UpdatePlatformData();
 
-	if (mesh == nullptr || shader == nullptr || !_isRendered) return;
+	Shader* shader = GetShader(extraFeatures);
+	if (shader == nullptr) return;
 
 	// Render the object
 	shader->Use();
+	SetFrameUniforms(shader, camera, lightLocation);
+
+	// Bind Model
+	glUniformMatrix4fv(shader->loc_model_matrix, 1, GL_FALSE, glm::value_ptr(matrix));
+
+	// Bind Material Data
+	glUniform1f(shader->loc_material_shininess, (GLfloat)lightingInfo.materialShine);
+	glUniform1f(shader->loc_material_kd, (GLfloat)lightingInfo.materialKd);
+	glUniform1f(shader->loc_material_ks, (GLfloat)lightingInfo.materialKs);
+	glUniform1f(shader->loc_material_emission, (GLfloat)lightingInfo.materialEmission);
+	glUniform3fv(shader->loc_object_color, 1, glm::value_ptr(color));
+
+	mesh->Render(shader->loc_texture_layer);
+}
+
+Shader* GameEngine::GameObject::GetShader(const unsigned int extraFeatures) const
+{
+	if (mesh == nullptr || shaderVariants == nullptr || !_isRendered) return nullptr;
 
-	// Bind MVP
+	// Pick the shader variant, the displaced vertices are only valid while the object is distorted
+	unsigned int features = shaderFeatures | extraFeatures;
+	if (distortedTime > 0) features |= ShaderFeatures::DISTORTED;
+	else features &= ~ShaderFeatures::DISPLACED;
+
+	return shaderVariants->Get(features);
+}
+
+void GameEngine::GameObject::SetFrameUniforms(Shader* shader, GameEngine::Camera* camera, const glm::vec3& lightLocation)
+{
+	// Bind View and Projection
 	glUniformMatrix4fv(shader->loc_view_matrix, 1, GL_FALSE, glm::value_ptr(camera->GetViewMatrix()));
 	glUniformMatrix4fv(shader->loc_projection_matrix, 1, GL_FALSE, glm::value_ptr(camera->projectionMatrix));
-	glUniformMatrix4fv(shader->loc_model_matrix, 1, GL_FALSE, glm::value_ptr(matrix));
-	
+
 	// Bind Light-Data
 	glm::vec3 cameraPos = camera->position;
 	glUniform3f(shader->loc_eye_pos, cameraPos.x, cameraPos.y, cameraPos.z);
-	glUniform3f(glGetUniformLocation(shader->program, "light_position"), lightLocation.x, lightLocation.y, lightLocation.z);
+	glUniform3f(shader->loc_light_pos, lightLocation.x, lightLocation.y, lightLocation.z);
+	glUniform1f(shader->loc_time, (GLfloat)Engine::GetElapsedTime());
 
-	// Bind Material Data
-	glUniform1f(glGetUniformLocation(shader->program, "material_shininess"), (GLfloat)lightingInfo.materialShine);
-	glUniform1f(glGetUniformLocation(shader->program, "material_kd"), (GLfloat)lightingInfo.materialKd);
-	glUniform1f(glGetUniformLocation(shader->program, "material_ks"), (GLfloat)lightingInfo.materialKs);
-	glUniform1f(glGetUniformLocation(shader->program, "time"), (GLfloat)Engine::GetElapsedTime());
-	glUniform3fv(glGetUniformLocation(shader->program, "object_color"), 1, glm::value_ptr(color));
-	glUniform1i(glGetUniformLocation(shader->program, "is_distorted"), (distortedTime > 0));
+	// Bind the clusters of the point lights and the shadow maps
+	if (lighting) lighting->SetUniforms(shader);
+	if (shadows) shadows->SetUniforms(shader);
+}
+
+void GameEngine::GameObject::Record(CommandBuffer& commands, Shader* shader)
+{
+	if (mesh == nullptr || shader == nullptr || !_isRendered) return;
+
+	glm::mat4 matrix = glm::mat4(1);
+	matrix = Translate(matrix, position);
+	matrix = Scale(matrix, scale);
+
+	UpdatePlatformData();
 
-	mesh->Render();
+	// The same program and material for most of the objects, the replay only sends the changes
+	commands.UseProgram(shader->program);
+	commands.SetUniform(shader->loc_model_matrix, matrix);
+	commands.SetUniform(shader->loc_material_shininess, lightingInfo.materialShine);
+	commands.SetUniform(shader->loc_material_kd, lightingInfo.materialKd);
+	commands.SetUniform(shader->loc_material_ks, lightingInfo.materialKs);
+	commands.SetUniform(shader->loc_material_emission, lightingInfo.materialEmission);
+	commands.SetUniform(shader->loc_object_color, color);
+
+	mesh->Record(commands, shader->loc_texture_layer);
 }
 
 void GameEngine::GameObject::Render2D()
@@ -164,34 +215,60 @@ void GameEngine::GameObject::Render2D()
 	matrix = glm::translate(matrix, position);
 	matrix = glm::scale(matrix, scale);
 
-	if (mesh == nullptr || shader == nullptr || !_isRendered) return;
+	if (mesh == nullptr || shaderVariants == nullptr || !_isRendered) return;
+
+	Shader* shader = shaderVariants->Get(shaderFeatures);
 
 	// Render the object
 	shader->Use();
 
-	// Bind MVP
-	glUniformMatrix4fv(shader->loc_view_matrix, 1, GL_FALSE, glm::value_ptr(glm::mat4(1)));
-	glUniformMatrix4fv(shader->loc_projection_matrix, 1, GL_FALSE, glm::value_ptr(glm::mat4(1)));
+	// Bind MVP (the UI variants don't use the View and Projection matrices)
 	glUniformMatrix4fv(shader->loc_model_matrix, 1, GL_FALSE, glm::value_ptr(matrix));
 
-	glUniform3fv(glGetUniformLocation(shader->program, "object_color"), 1, glm::value_ptr(color));
+	glUniform3fv(shader->loc_object_color, 1, glm::value_ptr(color));
 
-	mesh->Render();
+	mesh->Render(shader->loc_texture_layer);
 }
 
-std::vector<int> GameEngine::GameObject::ManageCollisions(std::vector<GameObject*> collCheck, std::unordered_map<long int, GameEngine::GameObject>* allObjects) {
+void GameEngine::GameObject::RenderDepth(const glm::mat4& view, const glm::mat4& projection)
+{
+	glm::mat4 matrix = glm::mat4(1);
+	matrix = Translate(matrix, position);
+	matrix = Scale(matrix, scale);
+
+	if (mesh == nullptr || shaderVariants == nullptr || !_isRendered) return;
+
+	// Keep the features that move the vertices
+	unsigned int features = ShaderFeatures::DEPTH_ONLY;
+	if (distortedTime > 0) {
+		features |= ShaderFeatures::DISTORTED | (shaderFeatures & (ShaderFeatures::NOISE | ShaderFeatures::NOISE_TEXTURE | ShaderFeatures::DISPLACED));
+	}
+
+	Shader* shader = shaderVariants->Get(features);
+	shader->Use();
+
+	glUniformMatrix4fv(shader->loc_view_matrix, 1, GL_FALSE, glm::value_ptr(view));
+	glUniformMatrix4fv(shader->loc_projection_matrix, 1, GL_FALSE, glm::value_ptr(projection));
+	glUniformMatrix4fv(shader->loc_model_matrix, 1, GL_FALSE, glm::value_ptr(matrix));
+	glUniform1f(shader->loc_time, (GLfloat)Engine::GetElapsedTime());
+
+	mesh->Render(shader->loc_texture_layer);
+}
+
+Span<int> GameEngine::GameObject::ManageCollisions(Span<GameObject*> collCheck, FrameArena& arena) {
 	// Only player collisions matter
-	if (type != "player") return std::vector<int>(0);
+	if (type != "player") return Span<int>();
 
-	std::vector<GameObject*> platforms;
+	Span<GameObject*> platforms = arena.Allocate<GameObject*>(collCheck.size());
+	size_t platformCount = 0;
 	for (auto& obj : collCheck) {
 		if (obj->type.rfind("platform_", 0) == 0) {
-			platforms.push_back(obj);
+			platforms[platformCount++] = obj;
 		}
 	}
 
 	// Get all the id's of the platforms this object collided with
-	std::vector<int> collided = CollisionCheck(platforms);
+	Span<int> collided = CollisionCheck(platforms.first(platformCount), arena);
 
 	if (type == "player") {
 		// Update the physics of the player if he collided with a platform
@@ -204,7 +281,7 @@ std::vector<int> GameEngine::GameObject::ManageCollisions(std::vector<GameObject
 		return collided;
 	}
 	
-	return std::vector<int>(0);
+	return Span<int>();
 }
 
 void GameEngine::GameObject::isRendered(const bool isRendered)
@@ -227,11 +304,36 @@ glm::vec3 GameEngine::GameObject::getPosition() const
 	return position;
 }
 
+glm::vec3 GameEngine::GameObject::getColor() const
+{
+	return color;
+}
+
+bool GameEngine::GameObject::isEmissive() const
+{
+	return lightingInfo.materialEmission > 0;
+}
+
 void GameEngine::GameObject::setDistorted(const double time)
 {
 	distortedTime = time;
 }
 
+double GameEngine::GameObject::getDistortedTime() const
+{
+	return distortedTime;
+}
+
+unsigned int GameEngine::GameObject::getShaderFeatures() const
+{
+	return shaderFeatures;
+}
+
+void GameEngine::GameObject::setShaderFeatures(const unsigned int features)
+{
+	shaderFeatures = features;
+}
+
 void GameEngine::GameObject::setPosition(const glm::vec3 newPosition)
 { 
 	position = newPosition;
@@ -250,21 +352,23 @@ long int GameEngine::GameObject::getID() const
 void GameEngine::GameObject::setType(const std::string newType)
 {
 	type = newType;
+	UpdatePlatformData();
 }
 
 
-std::vector<int> GameEngine::GameObject::CollisionCheck(std::vector<GameObject*> gameObjects)
+Span<int> GameEngine::GameObject::CollisionCheck(Span<GameObject*> gameObjects, FrameArena& arena)
 {
-	std::vector<Collider*> colArray;
+	Span<const Collider*> colArray = arena.Allocate<const Collider*>(gameObjects.size());
+	size_t colliderCount = 0;
 
 	for (auto& obj : gameObjects) {
 		// Do not include this object in the search
 		if (obj->id != id) {
-			colArray.push_back(obj->collider);
+			colArray[colliderCount++] = &obj->collider;
 		}
 	}
 
-	return CollisionManager::getCollisions(*this->collider, colArray);
+	return CollisionManager::getCollisions(this->collider, colArray.first(colliderCount), arena);
 }
 
 void GameEngine::GameObject::UpdatePhysics(const double deltaTime)
@@ -275,7 +379,7 @@ void GameEngine::GameObject::UpdatePhysics(const double deltaTime)
 
 	// Update the position from the physics engine
 	position = rigidbody.state.x;
-	collider->setPosition(position);
+	collider.setPosition(position);
 }
 
 void GameEngine::GameObject::EnablePhysics()
@@ -298,7 +402,19 @@ void GameEngine::GameObject::MovementFunction(void(*f)(GameEngine::State& state,
 	rigidbody.m_func = f;
 }
 
+const GameEngine::Collider* GameEngine::GameObject::getCollider() const
+{
+	return hasCollider ? &collider : nullptr;
+}
+
 GameEngine::RigidBody& GameEngine::GameObject::getRigidBody()
 {
 	return rigidbody;
 }
+
+void GameEngine::GameObject::setState(const State& state)
+{
+	rigidbody.state = state;
+	position = state.x;
+	collider.setPosition(position);
+}
@@ -1,10 +1,17 @@
 #pragma once
 
+#include <atomic>
+
 #include <Core/Engine.h>
+#include <Core/GPU/ShaderVariants.h>
+#include <Core/GPU/CommandBuffer.h>
+#include <Core/FrameArena.h>
 #include "Physics.hpp"
 #include "CollisionManager.hpp"
 #include "Camera.hpp"
 #include "Transform.hpp"
+#include "Lighting.hpp"
+#include "Shadows.hpp"
 
 namespace GameEngine {
 	namespace Data {
@@ -12,6 +19,7 @@ namespace GameEngine {
 			float materialShine = 5.f;
 			float materialKd = 0.5f;
 			float materialKs = 0.5f;
+			float materialEmission = 0.f;
 		} lightingData;
 	}
 
@@ -30,12 +38,53 @@ namespace GameEngine {
 		/// The Z size of the platform
 		/// </summary>
 		const float platformLength = 33.3f;
+
+		/// <summary>
+		/// The scale of the platforms (and of their colliders)
+		/// </summary>
+		const glm::vec3 platformScale = glm::vec3(1, 0.25f, platformLength);
+
+		/// <summary>
+		/// How much the gravity pulls the player
+		/// </summary>
+		const float playerGravity = .15f;
+
+		/// <summary>
+		/// How much the power-up platforms (orange, green, white) glow
+		/// </summary>
+		const float platformEmission = 0.35f;
+	}
+
+	/// <summary>
+	/// The features of the "Object" shader (see Object.VS.glsl), combined in a mask to pick a variant
+	/// </summary>
+	namespace ShaderFeatures {
+		enum : unsigned int {
+			LIT = 1 << 0,
+			UI = 1 << 1,
+			NOISE = 1 << 2,
+			NOISE_TEXTURE = 1 << 3,
+			DISTORTED = 1 << 4,
+			DISPLACED = 1 << 5,
+			INSTANCED = 1 << 6,
+			TEXTURED = 1 << 7,
+			DEPTH_ONLY = 1 << 8,
+			OVERDRAW = 1 << 9,
+		};
+
+		/// <summary>
+		/// The #define's of the features, in the order of their bits
+		/// </summary>
+		const std::vector<std::string> names{ "LIT", "UI", "NOISE", "NOISE_TEXTURE", "DISTORTED", "DISPLACED", "INSTANCED", "TEXTURED", "DEPTH_ONLY", "OVERDRAW" };
 	}
 
 	class GameObject
 	{
 	private:
-		static long int currentMaxID;
+		/// <summary>
+		/// The next id, the UI objects are created on the render thread while the platforms spawn
+		/// </summary>
+		static std::atomic<long int> currentMaxID;
 
 		long int id;
 		bool _isRendered;
@@ -45,9 +94,18 @@ namespace GameEngine {
 		glm::vec3 scale;
 
 		Mesh *mesh;
-		Shader *shader;
+
+		/// <summary>
+		/// The features of the shader variant used by the object (DISTORTED is added while the object is distorted)
+		/// </summary>
+		unsigned int shaderFeatures;
 		RigidBody rigidbody;
-		Collider *collider;
+
+		/// <summary>
+		/// Kept in the object, so a copy of the object has its own (the UI objects don't collide)
+		/// </summary>
+		Collider collider;
+		bool hasCollider;
 		glm::vec3 color;
 		Data::lightingData lightingInfo;
 
@@ -64,8 +122,9 @@ namespace GameEngine {
 		/// <summary>
 		/// Find all existing collisions between this object and the specified objects
 		/// <param name="gameObjects">All the objects to be checked (this object is automatically ignored)</param>
+		/// <param name="arena">The arena of the frame, the result is allocated in it</param>
 		/// <returns>An array with the id's of all the objects this object is colliding with</returns>
-		std::vector<int> CollisionCheck(std::vector<GameObject*> gameObjects);
+		Span<int> CollisionCheck(Span<GameObject*> gameObjects, FrameArena& arena);
 	public:
 		/// <summary>
 		/// Variable used by the player game object
@@ -73,7 +132,9 @@ namespace GameEngine {
 		bool isInJump;
 
 		static std::unordered_map<std::string, Mesh*>* meshes;
-		static std::unordered_map<std::string, Shader*>* shaders;
+		static ShaderVariants* shaderVariants;
+		static ClusteredLighting* lighting;
+		static ShadowMaps* shadows;
 
 		/// <summary>
 		/// A simple constructor
@@ -87,30 +148,65 @@ namespace GameEngine {
 		/// </summary>
 		/// <param name="type">The type of the object</param>
 		/// <param name="position">The position of the object</param>
-		GameObject(const std::string& type, const glm::vec3& position);
+		/// <param name="objectID">The id of the object, a new one if negative (the id of an object restored from a snapshot)</param>
+		GameObject(const std::string& type, const glm::vec3& position, const long int objectID = -1);
 
-		// Copy-Constructor
-		GameObject(const GameObject& other);
+		// Copy-Constructor and assignment (the ring of platforms reuses its slots by assigning them)
+		GameObject(const GameObject& other) = default;
+		GameObject& operator=(const GameObject& other) = default;
 
 		/// <summary>
 		/// Renders the GameObject on the scene.
 		/// </summary>
 		/// <param name="camera">The camera used in the scene</param>
 		/// <param name="lightLocation">The location of the light</param>
-		void Render(GameEngine::Camera* camera, const glm::vec3& lightLocation);
+		/// <param name="extraFeatures">Features added to the ones of the object (the overdraw view)</param>
+		void Render(GameEngine::Camera* camera, const glm::vec3& lightLocation, const unsigned int extraFeatures = 0);
+
+		/// <summary>
+		/// Get the shader variant the object is rendered with (on the OpenGL thread, the variant
+		/// may be compiled)
+		/// </summary>
+		/// <param name="extraFeatures">Features added to the ones of the object (the overdraw view)</param>
+		/// <returns>The variant, nullptr if the object isn't rendered</returns>
+		Shader* GetShader(const unsigned int extraFeatures = 0) const;
+
+		/// <summary>
+		/// Set the uniforms that are the same for all the objects of a frame (the camera, the
+		/// light, the clusters and the shadow maps) on the current program
+		/// </summary>
+		/// <param name="shader">The shader in use</param>
+		/// <param name="camera">The camera used in the scene</param>
+		/// <param name="lightLocation">The location of the light</param>
+		static void SetFrameUniforms(Shader* shader, GameEngine::Camera* camera, const glm::vec3& lightLocation);
+
+		/// <summary>
+		/// Record the draw of the GameObject in a command buffer, without any OpenGL call (it can
+		/// run on a worker). The frame uniforms must be set on the program before the replay.
+		/// </summary>
+		/// <param name="commands">The command buffer</param>
+		/// <param name="shader">The variant given by GetShader</param>
+		void Record(CommandBuffer& commands, Shader* shader);
 
 		/// <summary>
 		/// Renders the GameObject on the scene.
 		/// </summary>
 		void Render2D();
 
+		/// <summary>
+		/// Renders only the depth of the GameObject (in a shadow map, or in the depth pre-pass)
+		/// </summary>
+		/// <param name="view">The view matrix (a shadow map gives its whole clip matrix here)</param>
+		/// <param name="projection">The projection matrix</param>
+		void RenderDepth(const glm::mat4& view, const glm::mat4& projection);
+
 		/// <summary>
 		/// Manage the collisions between this object and all the other game objects
 		/// </summary>
 		/// <param name="coll_check">All the objects to be checked (this object is automatically ignored)</param>
-		/// <param name="allObjects">All the objects in the scene (pointer to the map)</param>
-		/// <returns>A vector with the id's of all the objects this object is colliding with</returns>
-		std::vector<int> ManageCollisions(std::vector<GameObject*> collCheck, std::unordered_map<long int, GameEngine::GameObject>* allObjects);
+		/// <param name="arena">The arena of the frame, the result is allocated in it</param>
+		/// <returns>The id's of all the objects this object is colliding with</returns>
+		Span<int> ManageCollisions(Span<GameObject*> collCheck, FrameArena& arena);
 
 		/// <summary>
 		/// Set if this object will be rendered
@@ -142,6 +238,36 @@ namespace GameEngine {
 		/// <param name="time">The time</param>
 		void setDistorted(const double time);
 
+		/// <summary>
+		/// Get the color of the game object
+		/// </summary>
+		/// <returns>The color</returns>
+		glm::vec3 getColor() const;
+
+		/// <summary>
+		/// Check if the object glows (and lights the objects around it)
+		/// </summary>
+		/// <returns>True for the power-up platforms</returns>
+		bool isEmissive() const;
+
+		/// <summary>
+		/// Get the time this object will still be in a distorted state
+		/// </summary>
+		/// <returns>The time (0 or less if the object is not distorted)</returns>
+		double getDistortedTime() const;
+
+		/// <summary>
+		/// Get the features of the shader variant used by the object
+		/// </summary>
+		/// <returns>The feature mask (ShaderFeatures)</returns>
+		unsigned int getShaderFeatures() const;
+
+		/// <summary>
+		/// Set the features of the shader variant used by the object
+		/// </summary>
+		/// <param name="features">The feature mask (ShaderFeatures)</param>
+		void setShaderFeatures(const unsigned int features);
+
 		/// <summary>
 		/// Set the position of the game object
 		/// </summary>
@@ -196,11 +322,23 @@ namespace GameEngine {
 		/// <param name="f">The function that will be used. It will have a state, the total time and deltaTime as parameters</param>
 		void MovementFunction(void (*f)(State& state, double time, double dt));
 
+		/// <summary>
+		/// Get the collider of the object
+		/// </summary>
+		/// <returns>The collider (nullptr for the objects that don't collide, like the UI)</returns>
+		const Collider* getCollider() const;
+
 		/// <summary>
 		/// Returns a reference to the rigidbody of the object
 		/// </summary>
 		/// <returns></returns>
 		RigidBody& getRigidBody();
+
+		/// <summary>
+		/// Set the physics state of the object, and move it (and its collider) there
+		/// </summary>
+		/// <param name="state">The new state</param>
+		void setState(const State& state);
 	};
 }
 
@@ -0,0 +1,216 @@
+#include "Lighting.hpp"
+
+#include <cmath>
+
+#include <include/math.h>
+#include <Core/Managers/JobSystem.h>
+
+using namespace GameEngine::LightingConstants;
+
+namespace {
+	const int clusterCount = clustersX * clustersY * clustersZ;
+
+	/// <summary>
+	/// The distance (on the view axis) where a depth slice starts
+	/// </summary>
+	float sliceDepth(int slice) {
+		if (slice <= 0) return 0.f;
+		return clusterNear * pow(clusterFar / clusterNear, (float)slice / clustersZ);
+	}
+}
+
+GameEngine::ClusteredLighting::ClusteredLighting() : frustumScale(1), depthScale(0), depthBias(0), resolution(1)
+{
+	buffers[0] = buffers[1] = buffers[2] = 0;
+	textures[0] = textures[1] = textures[2] = 0;
+}
+
+GameEngine::ClusteredLighting::~ClusteredLighting()
+{
+	if (textures[0]) glDeleteTextures(3, textures);
+	if (buffers[0]) glDeleteBuffers(3, buffers);
+}
+
+void GameEngine::ClusteredLighting::Init()
+{
+	// At their largest, so binning a frame never grows them
+	lights.reserve(maxLights);
+	viewLights.reserve(maxLights);
+	lightData.reserve(maxLights * 2);
+	indices.reserve(clusterCount * maxLightsPerCluster);
+	clusterLights.resize(clusterCount * maxLightsPerCluster);
+	clusterCounts.resize(clusterCount);
+	grid.resize(clusterCount);
+
+	glGenBuffers(3, buffers);
+	glGenTextures(3, textures);
+
+	// 2 texels per light: (position, radius) and (color * intensity, 0)
+	const GLenum formats[3] = { GL_RGBA32F, GL_R32UI, GL_R8UI };
+	for (int i = 0; i < 3; i++) {
+		glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+		glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+		glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+	}
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void GameEngine::ClusteredLighting::Clear()
+{
+	lights.clear();
+}
+
+bool GameEngine::ClusteredLighting::AddLight(const PointLight& light)
+{
+	if (lights.size() >= maxLights) return false;
+
+	lights.push_back(light);
+	return true;
+}
+
+size_t GameEngine::ClusteredLighting::GetLightCount() const
+{
+	return lights.size();
+}
+
+void GameEngine::ClusteredLighting::Update(Camera* camera, const glm::ivec2& resolution)
+{
+	Bin(camera, resolution);
+	Upload();
+}
+
+void GameEngine::ClusteredLighting::Bin(Camera* camera, const glm::ivec2& resolution)
+{
+	if (grid.empty()) return;
+
+	this->resolution = glm::max(resolution, glm::ivec2(1));
+
+	// Symmetric perspective projection: P[0][0] = 1 / (aspect * tan(fov / 2)), P[1][1] = 1 / tan(fov / 2)
+	frustumScale = glm::vec2(1.f / camera->projectionMatrix[0][0], 1.f / camera->projectionMatrix[1][1]);
+	depthScale = clustersZ / log(clusterFar / clusterNear);
+	depthBias = -clustersZ * log(clusterNear) / log(clusterFar / clusterNear);
+
+	glm::mat4 view = camera->GetViewMatrix();
+	viewLights.resize(lights.size());
+	for (size_t i = 0; i < lights.size(); i++) {
+		viewLights[i] = glm::vec4(glm::vec3(view * glm::vec4(lights[i].position, 1)), lights[i].radius);
+	}
+
+	// The slices are independent, split them between the cores when there are many lights
+	if ((int)lights.size() >= parallelBinningLights) {
+		JobSystem::ParallelFor(clustersZ, 1, [this](size_t first, size_t last) {
+			BinSlices((int)first, (int)last);
+		});
+	}
+	else {
+		BinSlices(0, clustersZ);
+	}
+
+	// Pack the light lists
+	indices.clear();
+	for (int cluster = 0; cluster < clusterCount; cluster++) {
+		unsigned char count = clusterCounts[cluster];
+		grid[cluster] = (GLuint)indices.size() << 8 | count;
+
+		const unsigned char* list = &clusterLights[cluster * maxLightsPerCluster];
+		indices.insert(indices.end(), list, list + count);
+	}
+
+	lightData.assign(MAX(lights.size(), (size_t)1) * 2, glm::vec4(0));
+	for (size_t i = 0; i < lights.size(); i++) {
+		lightData[i * 2] = glm::vec4(lights[i].position, lights[i].radius);
+		lightData[i * 2 + 1] = glm::vec4(lights[i].color * lights[i].intensity, 0);
+	}
+	if (indices.empty()) indices.push_back(0);
+}
+
+void GameEngine::ClusteredLighting::Upload()
+{
+	if (!buffers[0] || lightData.empty()) return;
+
+	// Orphan the buffers, the previous frame can still be reading them
+	glBindBuffer(GL_TEXTURE_BUFFER, buffers[0]);
+	glBufferData(GL_TEXTURE_BUFFER, lightData.size() * sizeof(glm::vec4), lightData.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, buffers[1]);
+	glBufferData(GL_TEXTURE_BUFFER, grid.size() * sizeof(GLuint), grid.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, buffers[2]);
+	glBufferData(GL_TEXTURE_BUFFER, indices.size(), indices.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void GameEngine::ClusteredLighting::BinSlices(int firstSlice, int lastSlice)
+{
+	// On the stack, the slices are binned by several jobs at once
+	int sliceLights[maxLights];
+	int sliceLightCount = 0;
+
+	for (int z = firstSlice; z < lastSlice; z++) {
+		float nearDepth = sliceDepth(z);
+		float farDepth = z == clustersZ - 1 ? INFINITY : sliceDepth(z + 1);
+
+		// The lights reaching the slice (the camera looks down -Z)
+		sliceLightCount = 0;
+		for (int i = 0; i < (int)viewLights.size(); i++) {
+			float depth = -viewLights[i].z;
+			if (depth + viewLights[i].w >= nearDepth && depth - viewLights[i].w <= farDepth) {
+				sliceLights[sliceLightCount++] = i;
+			}
+		}
+
+		// The cluster bounds are taken at the far depth of the slice (the last one uses the far plane)
+		float boundDepth = MIN(farDepth, clusterFar);
+
+		for (int y = 0; y < clustersY; y++) {
+			float y0 = (-1.f + 2.f * y / clustersY) * frustumScale.y;
+			float y1 = (-1.f + 2.f * (y + 1) / clustersY) * frustumScale.y;
+
+			for (int x = 0; x < clustersX; x++) {
+				float x0 = (-1.f + 2.f * x / clustersX) * frustumScale.x;
+				float x1 = (-1.f + 2.f * (x + 1) / clustersX) * frustumScale.x;
+
+				// The view space box holding the cluster
+				glm::vec3 boxMin = glm::vec3(MIN(x0 * nearDepth, x0 * boundDepth), MIN(y0 * nearDepth, y0 * boundDepth), -farDepth);
+				glm::vec3 boxMax = glm::vec3(MAX(x1 * nearDepth, x1 * boundDepth), MAX(y1 * nearDepth, y1 * boundDepth), -nearDepth);
+
+				int cluster = (z * clustersY + y) * clustersX + x;
+				unsigned char* list = &clusterLights[cluster * maxLightsPerCluster];
+				unsigned char count = 0;
+
+				for (int l = 0; l < sliceLightCount; l++) {
+					int i = sliceLights[l];
+					glm::vec3 center = glm::vec3(viewLights[i]);
+					glm::vec3 closest = glm::clamp(center, boxMin, boxMax);
+					glm::vec3 delta = center - closest;
+
+					if (glm::dot(delta, delta) <= viewLights[i].w * viewLights[i].w) {
+						list[count++] = (unsigned char)i;
+						if (count == maxLightsPerCluster) break;
+					}
+				}
+
+				clusterCounts[cluster] = count;
+			}
+		}
+	}
+}
+
+void GameEngine::ClusteredLighting::Bind() const
+{
+	const GLenum units[3] = { GL_TEXTURE0 + LIGHTS_UNIT, GL_TEXTURE0 + LIGHT_GRID_UNIT, GL_TEXTURE0 + LIGHT_INDICES_UNIT };
+	for (int i = 0; i < 3; i++) {
+		glActiveTexture(units[i]);
+		glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void GameEngine::ClusteredLighting::SetUniforms(Shader* shader) const
+{
+	GLint location = shader->GetUniformLocation("light_grid");
+	if (location < 0) return;
+
+	glUniform4f(location, (float)clustersX / resolution.x, (float)clustersY / resolution.y, depthScale, depthBias);
+	glUniform3i(shader->GetUniformLocation("light_clusters"), clustersX, clustersY, clustersZ);
+}
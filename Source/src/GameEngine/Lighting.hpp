@@ -0,0 +1,162 @@
+#pragma once
+
+#include <vector>
+
+#include <Core/Engine.h>
+#include "Camera.hpp"
+
+namespace GameEngine {
+	namespace LightingConstants {
+		/// <summary>
+		/// The number of clusters on each axis of the view frustum (the screen tiles and the depth slices)
+		/// </summary>
+		const int clustersX = 16;
+		const int clustersY = 9;
+		const int clustersZ = 24;
+
+		/// <summary>
+		/// The maximum number of point lights in a frame, the lights added after it are ignored
+		/// </summary>
+		const int maxLights = 256;
+
+		/// <summary>
+		/// The maximum number of lights that can affect a cluster
+		/// </summary>
+		const int maxLightsPerCluster = 32;
+
+		/// <summary>
+		/// The depth range split (exponentially) in slices. The first slice also holds everything
+		/// closer, the last one everything further.
+		/// </summary>
+		const float clusterNear = 0.5f;
+		const float clusterFar = 200.f;
+
+		/// <summary>
+		/// Below this number of lights the binning is done on the calling thread (instead of jobs)
+		/// </summary>
+		const int parallelBinningLights = 32;
+	}
+
+	/// <summary>
+	/// A point light, its contribution fades to 0 at the radius
+	/// </summary>
+	struct PointLight {
+		glm::vec3 position;
+		float radius;
+		glm::vec3 color;
+		float intensity;
+	};
+
+	/// <summary>
+	/// Clustered forward lighting. The view frustum is split in a grid of clusters (screen tiles
+	/// by exponential depth slices), and every frame the point lights are binned on the CPU into
+	/// the clusters they touch. The lights, the grid and the light lists are uploaded in buffer
+	/// textures, and the fragment shader only loops over the lights of its own cluster, so the
+	/// cost of a fragment depends on the lights around it instead of all the lights in the scene.
+	/// </summary>
+	class ClusteredLighting
+	{
+	public:
+		ClusteredLighting();
+		~ClusteredLighting();
+
+		/// <summary>
+		/// Create the buffers, must be called after OpenGL was initialized
+		/// </summary>
+		void Init();
+
+		/// <summary>
+		/// Remove all the lights, they are added again every frame
+		/// </summary>
+		void Clear();
+
+		/// <summary>
+		/// Add a light for this frame
+		/// </summary>
+		/// <param name="light">The light</param>
+		/// <returns>False if there are already LightingConstants::maxLights lights</returns>
+		bool AddLight(const PointLight& light);
+
+		/// <summary>
+		/// Bin the lights in the clusters of the camera, and upload the result
+		/// </summary>
+		/// <param name="camera">The camera (its view and perspective projection matrix)</param>
+		/// <param name="resolution">The size of the viewport, in pixels</param>
+		void Update(Camera* camera, const glm::ivec2& resolution);
+
+		/// <summary>
+		/// Bin the lights in the clusters of the camera, without uploading the result (it doesn't
+		/// use OpenGL, so it can run in a job)
+		/// </summary>
+		/// <param name="camera">The camera (its view and perspective projection matrix)</param>
+		/// <param name="resolution">The size of the viewport, in pixels</param>
+		void Bin(Camera* camera, const glm::ivec2& resolution);
+
+		/// <summary>
+		/// Upload the result of the last Bin
+		/// </summary>
+		void Upload();
+
+		/// <summary>
+		/// Bind the buffer textures on LIGHTS_UNIT, LIGHT_GRID_UNIT and LIGHT_INDICES_UNIT
+		/// </summary>
+		void Bind() const;
+
+		/// <summary>
+		/// Set the uniforms used to find the cluster of a fragment
+		/// </summary>
+		/// <param name="shader">The shader, already in use</param>
+		void SetUniforms(Shader* shader) const;
+
+		/// <summary>
+		/// Get the number of lights added this frame
+		/// </summary>
+		/// <returns>The number of lights</returns>
+		size_t GetLightCount() const;
+
+	private:
+		/// <summary>
+		/// Bin the lights in the clusters of the slices [firstSlice, lastSlice)
+		/// </summary>
+		void BinSlices(int firstSlice, int lastSlice);
+
+		std::vector<PointLight> lights;
+
+		/// <summary>
+		/// The lights in view space (xyz - position, w - radius)
+		/// </summary>
+		std::vector<glm::vec4> viewLights;
+
+		/// <summary>
+		/// The size of the frustum at a distance of 1, on X and Y
+		/// </summary>
+		glm::vec2 frustumScale;
+
+		/// <summary>
+		/// Maps log(depth) to the depth slice (slice = log(depth) * scale + bias)
+		/// </summary>
+		float depthScale;
+		float depthBias;
+
+		glm::ivec2 resolution;
+
+		/// <summary>
+		/// The light lists of the clusters, LightingConstants::maxLightsPerCluster entries per cluster
+		/// </summary>
+		std::vector<unsigned char> clusterLights;
+		std::vector<unsigned char> clusterCounts;
+
+		/// <summary>
+		/// The uploaded data: offset << 8 | count for each cluster, and the packed light lists
+		/// </summary>
+		std::vector<GLuint> grid;
+		std::vector<unsigned char> indices;
+		std::vector<glm::vec4> lightData;
+
+		/// <summary>
+		/// The buffers (and their buffer textures) with the lights, the grid and the light lists
+		/// </summary>
+		GLuint buffers[3];
+		GLuint textures[3];
+	};
+}
@@ -0,0 +1,195 @@
+#include "Noise.hpp"
+
+#include <vector>
+#include <cstring>
+#include <iostream>
+
+#include <include/math.h>
+#include <Core/Managers/FileSystem.h>
+#include <Core/Managers/JobSystem.h>
+#include <Core/Managers/ResourcePath.h>
+
+GLuint GameEngine::Noise::texture = 0;
+
+namespace {
+	const char CACHE_MAGIC[4] = { 'N', 'O', 'I', 'S' };
+
+	struct CacheHeader {
+		char magic[4];
+		int size;
+		float period;
+	};
+
+	glm::vec4 mod289(const glm::vec4& x) {
+		return x - glm::floor(x * (1.f / 289.f)) * 289.f;
+	}
+
+	glm::vec3 mod289(const glm::vec3& x) {
+		return x - glm::floor(x * (1.f / 289.f)) * 289.f;
+	}
+
+	glm::vec4 permute(const glm::vec4& x) {
+		return mod289(((x * 34.f) + 1.f) * x);
+	}
+
+	glm::vec4 taylorInvSqrt(const glm::vec4& r) {
+		return 1.79284291400159f - 0.85373472095314f * r;
+	}
+
+	glm::vec3 fade(const glm::vec3& t) {
+		return t * t * t * (t * (t * 6.f - 15.f) + 10.f);
+	}
+}
+
+float GameEngine::Noise::PerlinNoise(const glm::vec3& P, const glm::vec3& rep)
+{
+	glm::vec3 Pi0 = glm::mod(glm::floor(P), rep);
+	glm::vec3 Pi1 = glm::mod(Pi0 + glm::vec3(1.f), rep);
+	Pi0 = mod289(Pi0);
+	Pi1 = mod289(Pi1);
+	glm::vec3 Pf0 = glm::fract(P);
+	glm::vec3 Pf1 = Pf0 - glm::vec3(1.f);
+	glm::vec4 ix = glm::vec4(Pi0.x, Pi1.x, Pi0.x, Pi1.x);
+	glm::vec4 iy = glm::vec4(Pi0.y, Pi0.y, Pi1.y, Pi1.y);
+	glm::vec4 iz0 = glm::vec4(Pi0.z);
+	glm::vec4 iz1 = glm::vec4(Pi1.z);
+
+	glm::vec4 ixy = permute(permute(ix) + iy);
+	glm::vec4 ixy0 = permute(ixy + iz0);
+	glm::vec4 ixy1 = permute(ixy + iz1);
+
+	glm::vec4 gx0 = ixy0 * (1.f / 7.f);
+	glm::vec4 gy0 = glm::fract(glm::floor(gx0) * (1.f / 7.f)) - 0.5f;
+	gx0 = glm::fract(gx0);
+	glm::vec4 gz0 = glm::vec4(0.5f) - glm::abs(gx0) - glm::abs(gy0);
+	glm::vec4 sz0 = glm::step(gz0, glm::vec4(0.f));
+	gx0 -= sz0 * (glm::step(glm::vec4(0.f), gx0) - 0.5f);
+	gy0 -= sz0 * (glm::step(glm::vec4(0.f), gy0) - 0.5f);
+
+	glm::vec4 gx1 = ixy1 * (1.f / 7.f);
+	glm::vec4 gy1 = glm::fract(glm::floor(gx1) * (1.f / 7.f)) - 0.5f;
+	gx1 = glm::fract(gx1);
+	glm::vec4 gz1 = glm::vec4(0.5f) - glm::abs(gx1) - glm::abs(gy1);
+	glm::vec4 sz1 = glm::step(gz1, glm::vec4(0.f));
+	gx1 -= sz1 * (glm::step(glm::vec4(0.f), gx1) - 0.5f);
+	gy1 -= sz1 * (glm::step(glm::vec4(0.f), gy1) - 0.5f);
+
+	glm::vec3 g000 = glm::vec3(gx0.x, gy0.x, gz0.x);
+	glm::vec3 g100 = glm::vec3(gx0.y, gy0.y, gz0.y);
+	glm::vec3 g010 = glm::vec3(gx0.z, gy0.z, gz0.z);
+	glm::vec3 g110 = glm::vec3(gx0.w, gy0.w, gz0.w);
+	glm::vec3 g001 = glm::vec3(gx1.x, gy1.x, gz1.x);
+	glm::vec3 g101 = glm::vec3(gx1.y, gy1.y, gz1.y);
+	glm::vec3 g011 = glm::vec3(gx1.z, gy1.z, gz1.z);
+	glm::vec3 g111 = glm::vec3(gx1.w, gy1.w, gz1.w);
+
+	glm::vec4 norm0 = taylorInvSqrt(glm::vec4(glm::dot(g000, g000), glm::dot(g010, g010), glm::dot(g100, g100), glm::dot(g110, g110)));
+	g000 *= norm0.x;
+	g010 *= norm0.y;
+	g100 *= norm0.z;
+	g110 *= norm0.w;
+	glm::vec4 norm1 = taylorInvSqrt(glm::vec4(glm::dot(g001, g001), glm::dot(g011, g011), glm::dot(g101, g101), glm::dot(g111, g111)));
+	g001 *= norm1.x;
+	g011 *= norm1.y;
+	g101 *= norm1.z;
+	g111 *= norm1.w;
+
+	float n000 = glm::dot(g000, Pf0);
+	float n100 = glm::dot(g100, glm::vec3(Pf1.x, Pf0.y, Pf0.z));
+	float n010 = glm::dot(g010, glm::vec3(Pf0.x, Pf1.y, Pf0.z));
+	float n110 = glm::dot(g110, glm::vec3(Pf1.x, Pf1.y, Pf0.z));
+	float n001 = glm::dot(g001, glm::vec3(Pf0.x, Pf0.y, Pf1.z));
+	float n101 = glm::dot(g101, glm::vec3(Pf1.x, Pf0.y, Pf1.z));
+	float n011 = glm::dot(g011, glm::vec3(Pf0.x, Pf1.y, Pf1.z));
+	float n111 = glm::dot(g111, Pf1);
+
+	glm::vec3 fade_xyz = fade(Pf0);
+	glm::vec4 n_z = glm::mix(glm::vec4(n000, n100, n010, n110), glm::vec4(n001, n101, n011, n111), fade_xyz.z);
+	glm::vec2 n_yz = glm::mix(glm::vec2(n_z.x, n_z.y), glm::vec2(n_z.z, n_z.w), fade_xyz.y);
+	float n_xyz = glm::mix(n_yz.x, n_yz.y, fade_xyz.x);
+	return 2.2f * n_xyz;
+}
+
+void GameEngine::Noise::BakeSlices(short* data, int firstSlice, int lastSlice)
+{
+	const int size = NoiseConstants::textureSize;
+	const float texelSize = NoiseConstants::period / size;
+	const glm::vec3 rep = glm::vec3(NoiseConstants::period);
+
+	for (int z = firstSlice; z < lastSlice; z++) {
+		for (int y = 0; y < size; y++) {
+			for (int x = 0; x < size; x++) {
+				// Sample at the texel centers, like the GPU does
+				glm::vec3 P = (glm::vec3(x, y, z) + 0.5f) * texelSize;
+
+				// Stored in a signed normalized texture, the shader scales it back by 2.2
+				float value = glm::clamp(PerlinNoise(P, rep) / 2.2f, -1.f, 1.f);
+				data[(z * size + y) * size + x] = (short)(value * 32767.f);
+			}
+		}
+	}
+}
+
+void GameEngine::Noise::Init()
+{
+	const int size = NoiseConstants::textureSize;
+	const size_t dataSize = (size_t)size * size * size * sizeof(short);
+	std::string cacheFile = RESOURCE_PATH::CACHE + "Noise/pnoise_" + std::to_string(size) + ".bin";
+
+	std::vector<short> data((size_t)size * size * size);
+
+	// Use the cached bake if it matches the current constants
+	std::string cached;
+	bool loaded = false;
+	if (FileSystem::ReadFile(cacheFile, cached) && cached.size() == sizeof(CacheHeader) + dataSize) {
+		const CacheHeader* header = reinterpret_cast<const CacheHeader*>(cached.data());
+		if (memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 && header->size == size && header->period == NoiseConstants::period) {
+			memcpy(data.data(), cached.data() + sizeof(CacheHeader), dataSize);
+			loaded = true;
+		}
+	}
+
+	if (!loaded) {
+		// Split the slices between the cores
+		short* texels = data.data();
+		JobSystem::ParallelFor(size, 1, [texels](size_t first, size_t last) {
+			BakeSlices(texels, (int)first, (int)last);
+		});
+
+		CacheHeader header;
+		memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+		header.size = size;
+		header.period = NoiseConstants::period;
+
+		std::string file(sizeof(CacheHeader) + dataSize, '\0');
+		memcpy(&file[0], &header, sizeof(header));
+		memcpy(&file[sizeof(header)], data.data(), dataSize);
+
+		FileSystem::CreateDirectories(RESOURCE_PATH::CACHE + "Noise");
+		if (!FileSystem::WriteFile(cacheFile, file.data(), file.size())) {
+			std::cout << "Could not write the noise cache " << cacheFile << std::endl;
+		}
+	}
+
+	if (!texture) {
+		glGenTextures(1, &texture);
+	}
+
+	glBindTexture(GL_TEXTURE_3D, texture);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+	glTexImage3D(GL_TEXTURE_3D, 0, GL_R16_SNORM, size, size, size, 0, GL_RED, GL_SHORT, data.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+void GameEngine::Noise::Bind(GLenum textureUnit)
+{
+	glActiveTexture(textureUnit);
+	glBindTexture(GL_TEXTURE_3D, texture);
+	glActiveTexture(GL_TEXTURE0);
+}
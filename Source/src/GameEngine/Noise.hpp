@@ -0,0 +1,55 @@
+#pragma once
+
+#include <include/gl.h>
+#include <include/glm.h>
+
+namespace GameEngine {
+	namespace NoiseConstants {
+		/// <summary>
+		/// The size (on each axis) of the baked noise texture
+		/// </summary>
+		const int textureSize = 128;
+
+		/// <summary>
+		/// The period of the baked noise, it must match NOISE_PERIOD in Object.VS.glsl
+		/// </summary>
+		const float period = 10.f;
+	}
+
+	/// <summary>
+	/// Periodic Perlin noise, baked in a 3D texture so the shaders can sample it instead of
+	/// evaluating it. The texture covers a whole period (it tiles with GL_REPEAT), and it is
+	/// stored in RESOURCE_PATH::CACHE after the first bake.
+	/// </summary>
+	class Noise
+	{
+	public:
+		/// <summary>
+		/// Load the noise texture from the cache, or bake it (on all the cores) if it's missing
+		/// </summary>
+		static void Init();
+
+		/// <summary>
+		/// Bind the noise texture to a texture unit
+		/// </summary>
+		/// <param name="textureUnit">The texture unit (GL_TEXTURE0 + i)</param>
+		static void Bind(GLenum textureUnit);
+
+		/// <summary>
+		/// Classic Perlin noise, periodic variant. A port of the pnoise function used by the
+		/// shaders (https://github.com/ashima/webgl-noise/blob/master/src/classicnoise3D.glsl)
+		/// </summary>
+		/// <param name="P">The point</param>
+		/// <param name="rep">The period on each axis</param>
+		/// <returns>The noise value, roughly in [-1, 1]</returns>
+		static float PerlinNoise(const glm::vec3& P, const glm::vec3& rep);
+
+	private:
+		static GLuint texture;
+
+		/// <summary>
+		/// Compute the noise for the slices [firstSlice, lastSlice) of the texture
+		/// </summary>
+		static void BakeSlices(short* data, int firstSlice, int lastSlice);
+	};
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "GameObject.hpp"
+
+namespace GameEngine {
+	/// <summary>
+	/// A fixed ring of game objects, for the objects that are removed in the order they were added
+	/// (the platforms: spawned along the track, removed once the player passed them, so the ring is
+	/// ordered by Z). Adding an object copies it in the slot after the newest one and removing the
+	/// oldest one only moves an index: the slots, and the colliders in them, are reused, nothing is
+	/// allocated once the ring is created.
+	/// </summary>
+	template <int Capacity>
+	class ObjectRing
+	{
+		static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "The capacity must be a power of 2");
+
+	public:
+		ObjectRing() : first(0), count(0) {}
+
+		/// <summary>
+		/// Get the number of objects in the ring
+		/// </summary>
+		int Size() const { return count; }
+
+		/// <summary>
+		/// Check if the ring is full
+		/// </summary>
+		bool IsFull() const { return count == Capacity; }
+
+		/// <summary>
+		/// Get an object, from the oldest one (0) to the newest one (Size() - 1)
+		/// </summary>
+		GameObject& operator[](int index) { return objects[(first + index) & (Capacity - 1)]; }
+		const GameObject& operator[](int index) const { return objects[(first + index) & (Capacity - 1)]; }
+
+		/// <summary>
+		/// Find an object by its id
+		/// </summary>
+		/// <param name="id">The id of the object</param>
+		/// <returns>The object, nullptr if it isn't in the ring</returns>
+		GameObject* Find(long int id)
+		{
+			for (int i = 0; i < count; i++) {
+				GameObject& object = (*this)[i];
+				if (object.getID() == id) return &object;
+			}
+			return nullptr;
+		}
+
+		/// <summary>
+		/// Add an object after the newest one
+		/// </summary>
+		/// <param name="object">The object, copied in its slot</param>
+		/// <returns>False if the ring is full (the object isn't added)</returns>
+		bool Push(const GameObject& object)
+		{
+			if (IsFull()) return false;
+
+			objects[(first + count) & (Capacity - 1)] = object;
+			count++;
+			return true;
+		}
+
+		/// <summary>
+		/// Remove the oldest object
+		/// </summary>
+		void Pop()
+		{
+			if (count == 0) return;
+
+			first = (first + 1) & (Capacity - 1);
+			count--;
+		}
+
+		/// <summary>
+		/// Remove all the objects
+		/// </summary>
+		void Clear()
+		{
+			first = 0;
+			count = 0;
+		}
+
+	private:
+		GameObject objects[Capacity];
+		int first;
+		int count;
+	};
+}
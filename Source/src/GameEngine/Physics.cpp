@@ -82,6 +82,14 @@ void PhysixEngine::UpdateTime(const double deltaTime) {
 	current_time += deltaTime;
 }
 
+double PhysixEngine::GetTime() {
+	return current_time;
+}
+
+void PhysixEngine::SetTime(const double time) {
+	current_time = time;
+}
+
 void RigidBody::checkVelLimits()
 {
 	if (velocity_limit == -1) return;
@@ -130,5 +130,11 @@ namespace GameEngine
 		/// Update the total physics time. Must be called only once per frame
 		/// </summary>
 		static void PhysixEngine::UpdateTime(const double deltaTime);
+
+		/// <summary>
+		/// Get/Set the total physics time (a restored snapshot sets it back)
+		/// </summary>
+		static double GetTime();
+		static void SetTime(const double time);
 	};
 } // namespace Physics
\ No newline at end of file
@@ -0,0 +1,233 @@
+#include "PostProcess.hpp"
+
+#include <iostream>
+#include <iomanip>
+
+#include <include/math.h>
+
+using namespace GameEngine::PostProcessConstants;
+
+namespace {
+	/// <summary>
+	/// The weight of a new timing in the average
+	/// </summary>
+	const double timingSmoothing = 0.1;
+}
+
+GameEngine::PostProcess::PostProcess() : quad(nullptr), motionBlurShader(nullptr), bloomExtractShader(nullptr), blurShader(nullptr),
+	compositeShader(nullptr), enabled(PostProcessPasses::ALL), previousViewProjection(1), hasPreviousFrame(false), timingFrame(0)
+{
+	for (int frame = 0; frame < timingLatency; frame++) {
+		for (int pass = 0; pass < PostProcessPasses::count; pass++) {
+			queries[frame][pass] = 0;
+			queryIssued[frame][pass] = false;
+		}
+	}
+	for (int pass = 0; pass < PostProcessPasses::count; pass++) {
+		timings[pass] = 0;
+	}
+}
+
+GameEngine::PostProcess::~PostProcess()
+{
+	if (queries[0][0]) glDeleteQueries(timingLatency * PostProcessPasses::count, &queries[0][0]);
+}
+
+void GameEngine::PostProcess::Init(Mesh* quad, const std::string& shaderPath)
+{
+	this->quad = quad;
+
+	motionBlurShader = LoadShader("MotionBlur", shaderPath);
+	bloomExtractShader = LoadShader("BloomExtract", shaderPath);
+	blurShader = LoadShader("Blur", shaderPath);
+	compositeShader = LoadShader("Composite", shaderPath);
+
+	glGenQueries(timingLatency * PostProcessPasses::count, &queries[0][0]);
+}
+
+Shader* GameEngine::PostProcess::LoadShader(const std::string& name, const std::string& shaderPath)
+{
+	// All the passes draw the same full-screen quad
+	Shader* shader = new Shader(name.c_str());
+	shader->AddShader(RESOURCE_PATH::SHADERS + "Screen.VS.glsl", GL_VERTEX_SHADER);
+	shader->AddShader(shaderPath + name + ".FS.glsl", GL_FRAGMENT_SHADER);
+	shader->CreateAndLink();
+	shaders.push_back(shader);
+	return shader;
+}
+
+const std::vector<Shader*>& GameEngine::PostProcess::GetShaders() const
+{
+	return shaders;
+}
+
+void GameEngine::PostProcess::Begin(const glm::ivec2& resolution)
+{
+	glm::ivec2 size = glm::max(resolution, glm::ivec2(1));
+
+	if (!scene.GetFrameBufferID()) {
+		scene.Create(size.x, size.y, { GL_RGBA16F });
+		motionBlur.Create(MAX(size.x / motionBlurDownscale, 1), MAX(size.y / motionBlurDownscale, 1), { GL_RGBA16F }, 0);
+		bloom[0].Create(MAX(size.x / bloomDownscale, 1), MAX(size.y / bloomDownscale, 1), { GL_RGBA16F }, 0);
+		bloom[1].Create(MAX(size.x / bloomDownscale, 1), MAX(size.y / bloomDownscale, 1), { GL_RGBA16F }, 0);
+	}
+	else if (scene.GetResolution() != size) {
+		scene.Resize(size.x, size.y);
+		motionBlur.Resize(MAX(size.x / motionBlurDownscale, 1), MAX(size.y / motionBlurDownscale, 1));
+		bloom[0].Resize(MAX(size.x / bloomDownscale, 1), MAX(size.y / bloomDownscale, 1));
+		bloom[1].Resize(MAX(size.x / bloomDownscale, 1), MAX(size.y / bloomDownscale, 1));
+	}
+
+	scene.Bind();
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+glm::ivec2 GameEngine::PostProcess::GetResolution() const
+{
+	return scene.GetResolution();
+}
+
+void GameEngine::PostProcess::End(GLuint output, const glm::ivec2& outputResolution, const glm::mat4& view, const glm::mat4& projection, float motionStrength)
+{
+	CollectTimings();
+
+	glm::mat4 viewProjection = projection * view;
+	glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
+	glm::mat4 inverseProjection = glm::inverse(projection);
+	if (!hasPreviousFrame) {
+		previousViewProjection = viewProjection;
+		hasPreviousFrame = true;
+	}
+
+	bool motion = (enabled & PostProcessPasses::MOTION_BLUR) && motionStrength > 0;
+	glm::vec2 sceneTexel = 1.f / glm::vec2(scene.GetResolution());
+
+	glDisable(GL_DEPTH_TEST);
+
+	if (motion) {
+		BeginTiming(0);
+		motionBlur.Bind();
+		motionBlurShader->Use();
+		glUniformMatrix4fv(motionBlurShader->GetUniformLocation("inverse_view_projection"), 1, GL_FALSE, glm::value_ptr(inverseViewProjection));
+		glUniformMatrix4fv(motionBlurShader->GetUniformLocation("previous_view_projection"), 1, GL_FALSE, glm::value_ptr(previousViewProjection));
+		glUniformMatrix4fv(motionBlurShader->GetUniformLocation("inverse_projection"), 1, GL_FALSE, glm::value_ptr(inverseProjection));
+		glUniform1f(motionBlurShader->GetUniformLocation("motion_strength"), motionStrength);
+		glUniform1f(motionBlurShader->GetUniformLocation("max_motion"), maxMotion);
+		scene.BindTexture(0, GL_TEXTURE0);
+		scene.BindDepthTexture(GL_TEXTURE1);
+		quad->Render(motionBlurShader->loc_texture_layer);
+		EndTiming();
+	}
+
+	if (enabled & PostProcessPasses::BLOOM) {
+		BeginTiming(1);
+		glm::vec2 bloomTexel = 1.f / glm::vec2(bloom[0].GetResolution());
+
+		// Bright parts, downsampled
+		bloom[0].Bind();
+		bloomExtractShader->Use();
+		glUniform2fv(bloomExtractShader->GetUniformLocation("source_texel"), 1, glm::value_ptr(sceneTexel));
+		glUniform1f(bloomExtractShader->GetUniformLocation("bloom_threshold"), bloomThreshold);
+		scene.BindTexture(0, GL_TEXTURE0);
+		quad->Render(bloomExtractShader->loc_texture_layer);
+
+		// Blurred horizontally, then vertically
+		blurShader->Use();
+		bloom[1].Bind();
+		glUniform2f(blurShader->GetUniformLocation("direction"), bloomTexel.x, 0);
+		bloom[0].BindTexture(0, GL_TEXTURE0);
+		quad->Render(blurShader->loc_texture_layer);
+
+		bloom[0].Bind();
+		glUniform2f(blurShader->GetUniformLocation("direction"), 0, bloomTexel.y);
+		bloom[1].BindTexture(0, GL_TEXTURE0);
+		quad->Render(blurShader->loc_texture_layer);
+		EndTiming();
+	}
+
+	// Composite and tonemap in the output
+	BeginTiming(2);
+	glBindFramebuffer(GL_FRAMEBUFFER, output);
+	glViewport(0, 0, outputResolution.x, outputResolution.y);
+
+	compositeShader->Use();
+	glUniform1i(compositeShader->GetUniformLocation("passes"), motion ? enabled : enabled & ~PostProcessPasses::MOTION_BLUR);
+	glUniformMatrix4fv(compositeShader->GetUniformLocation("inverse_view_projection"), 1, GL_FALSE, glm::value_ptr(inverseViewProjection));
+	glUniformMatrix4fv(compositeShader->GetUniformLocation("previous_view_projection"), 1, GL_FALSE, glm::value_ptr(previousViewProjection));
+	glUniformMatrix4fv(compositeShader->GetUniformLocation("inverse_projection"), 1, GL_FALSE, glm::value_ptr(inverseProjection));
+	glUniform1f(compositeShader->GetUniformLocation("motion_strength"), motionStrength);
+	glUniform2fv(compositeShader->GetUniformLocation("motion_texel"), 1, glm::value_ptr(1.f / glm::vec2(motionBlur.GetResolution())));
+	glUniform1f(compositeShader->GetUniformLocation("motion_blend"), motionBlend);
+	glUniform1f(compositeShader->GetUniformLocation("bloom_intensity"), bloomIntensity);
+	glUniform1f(compositeShader->GetUniformLocation("exposure"), exposure);
+	scene.BindTexture(0, GL_TEXTURE0);
+	scene.BindDepthTexture(GL_TEXTURE1);
+	motionBlur.BindTexture(0, GL_TEXTURE2);
+	bloom[0].BindTexture(0, GL_TEXTURE3);
+	quad->Render(compositeShader->loc_texture_layer);
+	EndTiming();
+
+	glEnable(GL_DEPTH_TEST);
+
+	// What is drawn after the passes (the UI) needs a clean depth buffer
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	previousViewProjection = viewProjection;
+	timingFrame = (timingFrame + 1) % timingLatency;
+}
+
+void GameEngine::PostProcess::SetEnabled(unsigned int mask)
+{
+	enabled = mask & PostProcessPasses::ALL;
+}
+
+unsigned int GameEngine::PostProcess::GetEnabled() const
+{
+	return enabled;
+}
+
+void GameEngine::PostProcess::BeginTiming(int pass)
+{
+	glBeginQuery(GL_TIME_ELAPSED, queries[timingFrame][pass]);
+	queryIssued[timingFrame][pass] = true;
+}
+
+void GameEngine::PostProcess::EndTiming()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+}
+
+void GameEngine::PostProcess::CollectTimings()
+{
+	// The slot about to be reused holds the queries of timingLatency frames ago
+	for (int pass = 0; pass < PostProcessPasses::count; pass++) {
+		if (!queryIssued[timingFrame][pass]) {
+			// The pass didn't run then
+			timings[pass] *= 1 - timingSmoothing;
+			continue;
+		}
+
+		GLint available = 0;
+		glGetQueryObjectiv(queries[timingFrame][pass], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) continue;
+
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(queries[timingFrame][pass], GL_QUERY_RESULT, &elapsed);
+		timings[pass] += (elapsed / 1e6 - timings[pass]) * timingSmoothing;
+		queryIssued[timingFrame][pass] = false;
+	}
+}
+
+double GameEngine::PostProcess::GetTiming(int pass) const
+{
+	return timings[pass];
+}
+
+void GameEngine::PostProcess::PrintTimings() const
+{
+	std::cout << "Post-processing (GPU):";
+	for (int pass = 0; pass < PostProcessPasses::count; pass++) {
+		std::cout << " " << PostProcessPasses::names[pass] << " " << std::fixed << std::setprecision(3) << timings[pass] << " ms";
+	}
+	std::cout << std::defaultfloat << std::endl;
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <Core/Engine.h>
+#include <Core/GPU/FrameBuffer.h>
+
+namespace GameEngine {
+	/// <summary>
+	/// The passes of the post-processing chain, combined in the enable mask
+	/// </summary>
+	namespace PostProcessPasses {
+		enum : unsigned int {
+			MOTION_BLUR = 1 << 0,
+			BLOOM = 1 << 1,
+			TONEMAP = 1 << 2,
+			ALL = MOTION_BLUR | BLOOM | TONEMAP,
+		};
+
+		/// <summary>
+		/// The number of timed passes, and their names (the composite pass always runs)
+		/// </summary>
+		const int count = 3;
+		const std::vector<std::string> names{ "motion blur", "bloom", "composite" };
+	}
+
+	namespace PostProcessConstants {
+		/// <summary>
+		/// How much smaller the targets of the expensive passes are than the scene (on each axis)
+		/// </summary>
+		const int motionBlurDownscale = 2;
+		const int bloomDownscale = 4;
+
+		/// <summary>
+		/// The longest motion blur, and the motion from which the blurred image fully replaces the
+		/// scene (in texture coordinates)
+		/// </summary>
+		const float maxMotion = 0.05f;
+		const float motionBlend = 0.004f;
+
+		/// <summary>
+		/// The luminance above which the scene blooms, and how much of the bloom is added back
+		/// </summary>
+		const float bloomThreshold = 0.9f;
+		const float bloomIntensity = 0.8f;
+
+		const float exposure = 1.f;
+
+		/// <summary>
+		/// The frames a timer query is given before its result is read (it doesn't stall then)
+		/// </summary>
+		const int timingLatency = 3;
+	}
+
+	/// <summary>
+	/// Post-processing of the scene. The scene is drawn in an HDR target, then a chain of
+	/// full-screen passes writes the final image: a camera motion blur (its strength follows the
+	/// player speed), a bloom of the bright parts (the glowing platforms) and a tonemap. The
+	/// motion blur is drawn at half resolution and upsampled with a depth-aware (bilateral)
+	/// filter, the bloom at quarter resolution. Every pass can be turned off, and its GPU time
+	/// is measured with timer queries read a few frames later.
+	/// </summary>
+	class PostProcess
+	{
+	public:
+		PostProcess();
+		~PostProcess();
+
+		/// <summary>
+		/// Load the shaders of the passes
+		/// </summary>
+		/// <param name="quad">The full-screen quad the passes are drawn with</param>
+		/// <param name="shaderPath">The directory of the pass shaders</param>
+		void Init(Mesh* quad, const std::string& shaderPath);
+
+		/// <summary>
+		/// Get the shaders of the passes (to rebuild them when their files change)
+		/// </summary>
+		/// <returns>The shaders</returns>
+		const std::vector<Shader*>& GetShaders() const;
+
+		/// <summary>
+		/// Bind the HDR target of the scene (resized if needed) and clear it
+		/// </summary>
+		/// <param name="resolution">The resolution the scene is drawn at</param>
+		void Begin(const glm::ivec2& resolution);
+
+		/// <summary>
+		/// Get the resolution of the scene target
+		/// </summary>
+		/// <returns>The resolution</returns>
+		glm::ivec2 GetResolution() const;
+
+		/// <summary>
+		/// Run the passes and write the final image
+		/// </summary>
+		/// <param name="output">The frame buffer of the final image (0 for the window)</param>
+		/// <param name="outputResolution">The size of the final image</param>
+		/// <param name="view">The view matrix of the frame</param>
+		/// <param name="projection">The projection matrix of the frame</param>
+		/// <param name="motionStrength">Scales the motion blur (0 turns it off for this frame)</param>
+		void End(GLuint output, const glm::ivec2& outputResolution, const glm::mat4& view, const glm::mat4& projection, float motionStrength);
+
+		/// <summary>
+		/// Set the enabled passes
+		/// </summary>
+		/// <param name="mask">The enabled passes (PostProcessPasses)</param>
+		void SetEnabled(unsigned int mask);
+		unsigned int GetEnabled() const;
+
+		/// <summary>
+		/// Get the GPU time of a pass, averaged over the last frames
+		/// </summary>
+		/// <param name="pass">The index of the pass (see PostProcessPasses::names)</param>
+		/// <returns>The time in milliseconds</returns>
+		double GetTiming(int pass) const;
+
+		/// <summary>
+		/// Print the GPU time of every pass
+		/// </summary>
+		void PrintTimings() const;
+
+	private:
+		Shader* LoadShader(const std::string& name, const std::string& shaderPath);
+
+		/// <summary>
+		/// Start and stop the timer query of a pass
+		/// </summary>
+		void BeginTiming(int pass);
+		void EndTiming();
+
+		/// <summary>
+		/// Read the timer queries of the oldest frame, if they are done
+		/// </summary>
+		void CollectTimings();
+
+		Mesh* quad;
+		std::vector<Shader*> shaders;
+		Shader* motionBlurShader;
+		Shader* bloomExtractShader;
+		Shader* blurShader;
+		Shader* compositeShader;
+
+		FrameBuffer scene;
+		FrameBuffer motionBlur;
+		FrameBuffer bloom[2];
+
+		unsigned int enabled;
+		glm::mat4 previousViewProjection;
+		bool hasPreviousFrame;
+
+		GLuint queries[PostProcessConstants::timingLatency][PostProcessPasses::count];
+		bool queryIssued[PostProcessConstants::timingLatency][PostProcessPasses::count];
+		int timingFrame;
+		double timings[PostProcessPasses::count];
+	};
+}
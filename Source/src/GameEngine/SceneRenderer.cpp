@@ -0,0 +1,430 @@
+#include "SceneRenderer.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#include <include/math.h>
+
+using namespace GameEngine::SceneRendererConstants;
+
+GameEngine::SceneRenderer::SceneRenderer() : depthPrepass(true), sorting(true), overdrawView(false), occlusionCulling(true), commandBuffers(true), frame(0),
+	queryFrame(0), shadedFragments(0)
+{
+	for (int frame = 0; frame < queryLatency; frame++) {
+		queries[frame] = 0;
+		queryIssued[frame] = false;
+	}
+
+	occlusionTests.reserve(reservedOcclusionTests);
+	freeQueries.reserve(reservedOcclusionTests);
+}
+
+GameEngine::SceneRenderer::~SceneRenderer()
+{
+	if (queries[0]) glDeleteQueries(queryLatency, queries);
+
+	for (auto& test : occlusionTests) {
+		freeQueries.push_back(test.query);
+	}
+	if (freeQueries.size()) glDeleteQueries((GLsizei)freeQueries.size(), freeQueries.data());
+}
+
+void GameEngine::SceneRenderer::Init()
+{
+	glGenQueries(queryLatency, queries);
+}
+
+void GameEngine::SceneRenderer::Prepare(Span<GameObject*> objects, Camera* camera, JobCounter* counter)
+{
+	glm::mat4 view = camera->GetViewMatrix();
+	glm::vec3 cameraPosition = camera->position;
+
+	drawList.resize(objects.size());
+	JobSystem::ParallelFor(objects.size(), prepareGrain, [this, objects, view, cameraPosition](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			DrawItem& item = drawList[i];
+			item.object = objects[i];
+			if (item.object->getCollider()) {
+				item.object->getCollider()->getBounds(item.boundsMin, item.boundsMax);
+			}
+			else {
+				item.boundsMin = item.object->getPosition() - item.object->getScale() / 2.f;
+				item.boundsMax = item.object->getPosition() + item.object->getScale() / 2.f;
+			}
+
+			// The view depth of the closest point of the bounds, the platforms are long enough for
+			// the camera to be above one while the center of the next is closer
+			glm::vec3 closest = glm::clamp(cameraPosition, item.boundsMin, item.boundsMax);
+			item.depth = -(view * glm::vec4(closest, 1)).z;
+		}
+	}, &boundsDone);
+
+	// Sorted once all the depths are known. The objects come in the order of the track, so the list
+	// is nearly sorted already: an insertion sort is stable too, without the buffer of std::stable_sort
+	JobSystem::Run([this]() {
+		if (!sorting) return;
+		for (size_t i = 1; i < drawList.size(); i++) {
+			DrawItem item = drawList[i];
+			size_t j = i;
+			for (; j > 0 && item.depth < drawList[j - 1].depth; j--) {
+				drawList[j] = drawList[j - 1];
+			}
+			drawList[j] = item;
+		}
+	}, counter, &boundsDone);
+}
+
+void GameEngine::SceneRenderer::Render(Camera* camera, const glm::vec3& lightPosition)
+{
+	glm::mat4 view = camera->GetViewMatrix();
+	frame++;
+	occlusionStatistics = OcclusionStatistics();
+
+	unsigned int extraFeatures = overdrawView ? (unsigned int)ShaderFeatures::OVERDRAW : 0u;
+
+	// The occlusion tests read queries and the variants may have to be compiled, so they are
+	// picked here (on the GL thread)
+	for (auto& item : drawList) {
+		PrepareOcclusion(item, camera);
+		item.shader = item.object->GetShader(extraFeatures);
+	}
+
+	// The lit pass is recorded while the depth pre-pass is drawn
+	JobCounter recorded;
+	if (commandBuffers) {
+		RecordCommands(camera, lightPosition, &recorded);
+	}
+
+	if (depthPrepass) {
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		for (auto& item : drawList) {
+			if (!BeginDraw(item)) continue;
+			item.object->RenderDepth(view, camera->projectionMatrix);
+			EndDraw(item);
+		}
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+		// The depth is final, only the visible fragments pass now
+		glDepthFunc(GL_LEQUAL);
+		glDepthMask(GL_FALSE);
+	}
+
+	if (overdrawView) {
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_ONE, GL_ONE);
+	}
+
+	CollectCount();
+	if (queries[0]) {
+		glBeginQuery(GL_SAMPLES_PASSED, queries[queryFrame]);
+	}
+
+	if (commandBuffers) {
+		JobSystem::Wait(&recorded);
+		ReplayCommands();
+	}
+	else {
+		for (auto& item : drawList) {
+			if (!BeginDraw(item)) continue;
+			item.object->Render(camera, lightPosition, extraFeatures);
+			EndDraw(item);
+		}
+	}
+
+	if (queries[0]) {
+		glEndQuery(GL_SAMPLES_PASSED);
+		queryIssued[queryFrame] = true;
+		queryFrame = (queryFrame + 1) % queryLatency;
+	}
+
+	if (overdrawView) {
+		glDisable(GL_BLEND);
+	}
+	if (depthPrepass) {
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+	}
+
+	TestOcclusion(camera);
+	ReleaseOcclusionTests();
+}
+
+void GameEngine::SceneRenderer::PrepareOcclusion(DrawItem& item, Camera* camera)
+{
+	item.mode = DrawMode::ALWAYS;
+	item.query = 0;
+	item.test = false;
+
+	// The close objects, and the ones without bounds, are always drawn
+	if (!occlusionCulling || !item.object->getCollider() || item.depth < occlusionNearDistance) {
+		occlusionStatistics.drawn++;
+		return;
+	}
+
+	OcclusionTest& test = GetOcclusionTest(item.object->getID());
+	test.frame = frame;
+	if (!test.query) {
+		if (freeQueries.size()) {
+			test.query = freeQueries.back();
+			freeQueries.pop_back();
+		}
+		else {
+			glGenQueries(1, &test.query);
+		}
+	}
+
+	// Read the last result only if it is already there
+	if (test.pending) {
+		GLint available = 0;
+		glGetQueryObjectiv(test.query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available) {
+			GLuint visible = 0;
+			glGetQueryObjectuiv(test.query, GL_QUERY_RESULT, &visible);
+			test.occluded = !visible;
+			test.hasResult = true;
+			test.pending = false;
+		}
+	}
+
+	item.query = test.query;
+	if (test.pending) {
+		// Let the GPU decide, with the result of the test in flight
+		item.mode = DrawMode::CONDITIONAL;
+		occlusionStatistics.conditional++;
+	}
+	else {
+		item.mode = test.hasResult && test.occluded ? DrawMode::CULLED : DrawMode::ALWAYS;
+		item.test = true;
+		if (item.mode == DrawMode::CULLED) occlusionStatistics.culled++;
+		else occlusionStatistics.drawn++;
+	}
+}
+
+void GameEngine::SceneRenderer::TestOcclusion(Camera* camera)
+{
+	Mesh* box = (*GameObject::meshes)["box"];
+	Shader* shader = GameObject::shaderVariants->Get(ShaderFeatures::DEPTH_ONLY);
+
+	// Nothing is written, the depth test counts the visible samples of the boxes
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthMask(GL_FALSE);
+
+	shader->Use();
+	glUniformMatrix4fv(shader->loc_view_matrix, 1, GL_FALSE, glm::value_ptr(camera->GetViewMatrix()));
+	glUniformMatrix4fv(shader->loc_projection_matrix, 1, GL_FALSE, glm::value_ptr(camera->projectionMatrix));
+
+	for (auto& item : drawList) {
+		if (!item.test) continue;
+
+		glm::vec3 center = (item.boundsMin + item.boundsMax) / 2.f;
+		glm::vec3 size = item.boundsMax - item.boundsMin + 2 * occlusionMargin;
+		glm::mat4 model = glm::scale(glm::translate(glm::mat4(1), center), size);
+		glUniformMatrix4fv(shader->loc_model_matrix, 1, GL_FALSE, glm::value_ptr(model));
+
+		glBeginQuery(GL_ANY_SAMPLES_PASSED, item.query);
+		box->Render(shader->loc_texture_layer);
+		glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+		GetOcclusionTest(item.object->getID()).pending = true;
+		occlusionStatistics.tested++;
+	}
+
+	glDepthMask(GL_TRUE);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+GameEngine::SceneRenderer::OcclusionTest& GameEngine::SceneRenderer::GetOcclusionTest(long int id)
+{
+	for (auto& test : occlusionTests) {
+		if (test.id == id) return test;
+	}
+
+	occlusionTests.push_back(OcclusionTest());
+	occlusionTests.back().id = id;
+	return occlusionTests.back();
+}
+
+void GameEngine::SceneRenderer::ReleaseOcclusionTests()
+{
+	// The last test takes the place of a released one
+	for (size_t i = 0; i < occlusionTests.size();) {
+		if (occlusionTests[i].frame != frame) {
+			freeQueries.push_back(occlusionTests[i].query);
+			occlusionTests[i] = occlusionTests.back();
+			occlusionTests.pop_back();
+		}
+		else {
+			i++;
+		}
+	}
+}
+
+void GameEngine::SceneRenderer::RecordCommands(Camera* camera, const glm::vec3& lightPosition, JobCounter* counter)
+{
+	// Only a few variants are used, their shared uniforms are set once instead of for every object
+	commandShaders.clear();
+	for (auto& item : drawList) {
+		if (!item.shader || item.mode == DrawMode::CULLED) continue;
+		if (std::find(commandShaders.begin(), commandShaders.end(), item.shader) != commandShaders.end()) continue;
+
+		commandShaders.push_back(item.shader);
+		item.shader->Use();
+		GameObject::SetFrameUniforms(item.shader, camera, lightPosition);
+	}
+
+	size_t chunks = UPPER_BOUND(drawList.size(), recordGrain);
+	if (commandChunks.size() < chunks) commandChunks.resize(chunks);
+
+	JobSystem::ParallelFor(drawList.size(), recordGrain, [this](size_t begin, size_t end) {
+		CommandBuffer& commands = commandChunks[begin / recordGrain];
+		commands.Clear();
+
+		for (size_t i = begin; i < end; i++) {
+			DrawItem& item = drawList[i];
+			if (item.mode == DrawMode::CULLED) continue;
+
+			if (item.mode == DrawMode::CONDITIONAL) commands.BeginConditionalRender(item.query);
+			item.object->Record(commands, item.shader);
+			if (item.mode == DrawMode::CONDITIONAL) commands.EndConditionalRender();
+		}
+	}, counter);
+}
+
+void GameEngine::SceneRenderer::ReplayCommands()
+{
+	// The state left by the other passes isn't known
+	commandState.Reset();
+	commandStatistics = CommandStatistics();
+
+	size_t chunks = UPPER_BOUND(drawList.size(), recordGrain);
+	for (size_t chunk = 0; chunk < chunks; chunk++) {
+		commandChunks[chunk].Execute(commandState);
+		commandStatistics.recorded += commandChunks[chunk].GetCommandCount();
+	}
+	commandState.Finish();
+
+	commandStatistics.executed = commandState.executed;
+	commandStatistics.skipped = commandState.skipped;
+}
+
+bool GameEngine::SceneRenderer::BeginDraw(const DrawItem& item)
+{
+	if (item.mode == DrawMode::CULLED) return false;
+
+	// Without waiting: if the result isn't there when the GPU reaches the draw, it is drawn
+	if (item.mode == DrawMode::CONDITIONAL) {
+		glBeginConditionalRender(item.query, GL_QUERY_NO_WAIT);
+	}
+	return true;
+}
+
+void GameEngine::SceneRenderer::EndDraw(const DrawItem& item)
+{
+	if (item.mode == DrawMode::CONDITIONAL) {
+		glEndConditionalRender();
+	}
+}
+
+void GameEngine::SceneRenderer::CollectCount()
+{
+	// The slot about to be reused holds the query of queryLatency frames ago
+	if (!queryIssued[queryFrame]) return;
+
+	GLint available = 0;
+	glGetQueryObjectiv(queries[queryFrame], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) return;
+
+	GLuint64 samples = 0;
+	glGetQueryObjectui64v(queries[queryFrame], GL_QUERY_RESULT, &samples);
+	queryIssued[queryFrame] = false;
+
+	shadedFragments += ((double)samples - shadedFragments) * countSmoothing;
+}
+
+void GameEngine::SceneRenderer::SetDepthPrepass(bool enabled)
+{
+	depthPrepass = enabled;
+}
+
+void GameEngine::SceneRenderer::SetSorting(bool enabled)
+{
+	sorting = enabled;
+}
+
+void GameEngine::SceneRenderer::SetOverdrawView(bool enabled)
+{
+	overdrawView = enabled;
+}
+
+void GameEngine::SceneRenderer::SetOcclusionCulling(bool enabled)
+{
+	occlusionCulling = enabled;
+}
+
+void GameEngine::SceneRenderer::SetCommandBuffers(bool enabled)
+{
+	commandBuffers = enabled;
+}
+
+bool GameEngine::SceneRenderer::HasDepthPrepass() const
+{
+	return depthPrepass;
+}
+
+bool GameEngine::SceneRenderer::HasSorting() const
+{
+	return sorting;
+}
+
+bool GameEngine::SceneRenderer::HasOverdrawView() const
+{
+	return overdrawView;
+}
+
+bool GameEngine::SceneRenderer::HasOcclusionCulling() const
+{
+	return occlusionCulling;
+}
+
+bool GameEngine::SceneRenderer::HasCommandBuffers() const
+{
+	return commandBuffers;
+}
+
+double GameEngine::SceneRenderer::GetShadedFragments() const
+{
+	return shadedFragments;
+}
+
+const GameEngine::OcclusionStatistics& GameEngine::SceneRenderer::GetOcclusionStatistics() const
+{
+	return occlusionStatistics;
+}
+
+const GameEngine::CommandStatistics& GameEngine::SceneRenderer::GetCommandStatistics() const
+{
+	return commandStatistics;
+}
+
+void GameEngine::SceneRenderer::PrintStatistics(const glm::ivec2& resolution) const
+{
+	double pixels = (double)resolution.x * resolution.y;
+	std::cout << "Shaded fragments: " << (long long)shadedFragments << " (" << shadedFragments / pixels << " per pixel)"
+		<< ", depth pre-pass " << (depthPrepass ? "on" : "off") << ", sorting " << (sorting ? "on" : "off") << std::endl;
+
+	if (!occlusionCulling) {
+		std::cout << "Occlusion culling off" << std::endl;
+	}
+	else {
+		std::cout << "Occlusion culling: " << occlusionStatistics.culled << " culled, " << occlusionStatistics.conditional << " conditional, "
+			<< occlusionStatistics.drawn << " drawn, " << occlusionStatistics.tested << " boxes tested" << std::endl;
+	}
+
+	if (!commandBuffers) {
+		std::cout << "Command buffers off" << std::endl;
+	}
+	else {
+		std::cout << "Command buffers: " << commandStatistics.recorded << " commands recorded, " << commandStatistics.executed << " replayed, "
+			<< commandStatistics.skipped << " skipped as redundant" << std::endl;
+	}
+}
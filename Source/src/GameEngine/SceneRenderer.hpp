@@ -0,0 +1,273 @@
+#pragma once
+
+#include <vector>
+
+#include <Core/Engine.h>
+#include "GameObject.hpp"
+#include "Camera.hpp"
+
+namespace GameEngine {
+	namespace SceneRendererConstants {
+		/// <summary>
+		/// The frames a query is given before its result is read (it doesn't stall then)
+		/// </summary>
+		const int queryLatency = 3;
+
+		/// <summary>
+		/// The weight of a new count in the average
+		/// </summary>
+		const double countSmoothing = 0.1;
+
+		/// <summary>
+		/// The objects closer than this to the camera are always drawn, they are the occluders
+		/// (and their box could be cut by the near plane)
+		/// </summary>
+		const float occlusionNearDistance = 10.f;
+
+		/// <summary>
+		/// How much the tested boxes are grown, so they are in front of the surfaces they bound
+		/// </summary>
+		const float occlusionMargin = 0.05f;
+
+		/// <summary>
+		/// The objects given to each job when the draw list is built
+		/// </summary>
+		const size_t prepareGrain = 64;
+
+		/// <summary>
+		/// The objects recorded in each command buffer of the lit pass
+		/// </summary>
+		const size_t recordGrain = 32;
+
+		/// <summary>
+		/// The occlusion tests kept without growing their array (more objects than this are tested
+		/// too, the array grows once)
+		/// </summary>
+		const size_t reservedOcclusionTests = 64;
+	}
+
+	/// <summary>
+	/// What the occlusion culling did with the objects of the last frame
+	/// </summary>
+	struct OcclusionStatistics {
+		// The boxes tested
+		int tested = 0;
+		// The objects skipped on the CPU (their last test came back occluded)
+		int culled = 0;
+		// The objects drawn with a conditional render (their last test wasn't back yet)
+		int conditional = 0;
+		// The objects drawn without condition (close, visible, or not tested yet)
+		int drawn = 0;
+	};
+
+	/// <summary>
+	/// What the command buffers of the lit pass did in the last frame
+	/// </summary>
+	struct CommandStatistics {
+		// The commands recorded by the workers
+		unsigned int recorded = 0;
+		// The commands replayed, and the ones skipped because they didn't change the state
+		unsigned int executed = 0;
+		unsigned int skipped = 0;
+	};
+
+	/// <summary>
+	/// Draws the opaque game objects. They are sorted front to back (by the view depth of the
+	/// closest point of their bounds), so the depth test rejects the fragments hidden behind the
+	/// objects already drawn. With the depth pre-pass, the depth of the whole scene is drawn first
+	/// with the DEPTH_ONLY variants, and the lit pass only shades the visible fragments (GL_LEQUAL,
+	/// without writing the depth again). The fragments shaded by the lit pass are counted with
+	/// GL_SAMPLES_PASSED queries, and the overdraw view shows them as a heat map.
+	///
+	/// The distant objects are occlusion culled: after the scene, the bounding box of each one
+	/// is drawn (without writing anything) inside a GL_ANY_SAMPLES_PASSED query. The next frames
+	/// use the result without waiting for it: an object whose test came back occluded is skipped,
+	/// and while the test is still in flight the object is drawn with a conditional render, so
+	/// the GPU discards it if the test fails. An object that comes out from behind an occluder
+	/// shows up a frame late.
+	///
+	/// With the command buffers, the lit pass is recorded by the workers (a buffer per chunk of
+	/// objects) while the depth pre-pass is drawn, then replayed in order. The uniforms shared by
+	/// the objects are set once per variant, and the replay skips the programs, uniforms and
+	/// vertex arrays that are already set.
+	/// </summary>
+	class SceneRenderer
+	{
+	public:
+		SceneRenderer();
+		~SceneRenderer();
+
+		/// <summary>
+		/// Create the queries
+		/// </summary>
+		void Init();
+
+		/// <summary>
+		/// Build the draw list of the frame with jobs: the bounds and depths of the objects in
+		/// parallel, then the sort once they are all done. The objects must not move until the
+		/// counter reaches 0.
+		/// </summary>
+		/// <param name="objects">The objects to draw</param>
+		/// <param name="camera">The camera of the scene</param>
+		/// <param name="counter">Reaches 0 once the list is ready</param>
+		void Prepare(Span<GameObject*> objects, Camera* camera, JobCounter* counter);
+
+		/// <summary>
+		/// Draw the objects of the prepared list
+		/// </summary>
+		/// <param name="camera">The camera of the scene</param>
+		/// <param name="lightPosition">The position of the key light</param>
+		void Render(Camera* camera, const glm::vec3& lightPosition);
+
+		/// <summary>
+		/// Turn the depth pre-pass, the front to back sorting, the overdraw view and the occlusion
+		/// culling on or off
+		/// </summary>
+		void SetDepthPrepass(bool enabled);
+		void SetSorting(bool enabled);
+		void SetOverdrawView(bool enabled);
+		void SetOcclusionCulling(bool enabled);
+		void SetCommandBuffers(bool enabled);
+		bool HasDepthPrepass() const;
+		bool HasSorting() const;
+		bool HasOverdrawView() const;
+		bool HasOcclusionCulling() const;
+		bool HasCommandBuffers() const;
+
+		/// <summary>
+		/// Get the number of fragments shaded by the lit pass, averaged over the last frames
+		/// </summary>
+		/// <returns>The number of fragments</returns>
+		double GetShadedFragments() const;
+
+		/// <summary>
+		/// Get what the occlusion culling did in the last frame
+		/// </summary>
+		/// <returns>The statistics</returns>
+		const OcclusionStatistics& GetOcclusionStatistics() const;
+
+		/// <summary>
+		/// Get what the command buffers did in the last frame
+		/// </summary>
+		/// <returns>The statistics</returns>
+		const CommandStatistics& GetCommandStatistics() const;
+
+		/// <summary>
+		/// Print the shaded fragments (and how many that is per pixel of the viewport), the
+		/// occlusion and the command buffer statistics
+		/// </summary>
+		/// <param name="resolution">The resolution of the viewport</param>
+		void PrintStatistics(const glm::ivec2& resolution) const;
+
+	private:
+		enum class DrawMode { ALWAYS, CONDITIONAL, CULLED };
+
+		/// <summary>
+		/// An object of the frame
+		/// </summary>
+		struct DrawItem {
+			// The key the objects are sorted by
+			float depth;
+			GameObject* object;
+			DrawMode mode;
+			// The occlusion query of the object (0 when it isn't tested)
+			GLuint query;
+			// Whether the box of the object is tested again at the end of the frame
+			bool test;
+			// The variant of the lit pass
+			Shader* shader;
+			glm::vec3 boundsMin;
+			glm::vec3 boundsMax;
+		};
+
+		/// <summary>
+		/// The occlusion test of an object, kept between the frames
+		/// </summary>
+		struct OcclusionTest {
+			long int id = -1;
+			GLuint query = 0;
+			// Issued, the result isn't read yet
+			bool pending = false;
+			bool hasResult = false;
+			bool occluded = false;
+			// The last frame the object was drawn in, the tests of removed objects are released
+			unsigned int frame = 0;
+		};
+
+		/// <summary>
+		/// Get the occlusion test of an object, a new one if it has none
+		/// </summary>
+		OcclusionTest& GetOcclusionTest(long int id);
+
+		/// <summary>
+		/// Choose how an object is drawn, from the result of its last occlusion test
+		/// </summary>
+		void PrepareOcclusion(DrawItem& item, Camera* camera);
+
+		/// <summary>
+		/// Draw the boxes of the tested objects in their queries
+		/// </summary>
+		void TestOcclusion(Camera* camera);
+
+		/// <summary>
+		/// Release the tests of the objects that weren't drawn this frame
+		/// </summary>
+		void ReleaseOcclusionTests();
+
+		/// <summary>
+		/// Set the frame uniforms of the variants of the lit pass, and start recording it on the workers
+		/// </summary>
+		void RecordCommands(Camera* camera, const glm::vec3& lightPosition, JobCounter* counter);
+
+		/// <summary>
+		/// Replay the recorded lit pass
+		/// </summary>
+		void ReplayCommands();
+
+		/// <summary>
+		/// Start and end the conditional render of an item
+		/// </summary>
+		/// <returns>False if the item is culled</returns>
+		bool BeginDraw(const DrawItem& item);
+		void EndDraw(const DrawItem& item);
+
+		/// <summary>
+		/// Read the query of the oldest frame, if it is done
+		/// </summary>
+		void CollectCount();
+
+		bool depthPrepass;
+		bool sorting;
+		bool overdrawView;
+		bool occlusionCulling;
+		bool commandBuffers;
+
+		/// <summary>
+		/// The objects of the frame (reused between the frames)
+		/// </summary>
+		std::vector<DrawItem> drawList;
+		JobCounter boundsDone;
+
+		/// <summary>
+		/// The lit pass, a buffer per chunk of the draw list
+		/// </summary>
+		std::vector<CommandBuffer> commandChunks;
+		std::vector<Shader*> commandShaders;
+		CommandState commandState;
+		CommandStatistics commandStatistics;
+
+		/// <summary>
+		/// The tests of the objects drawn in the last frames, in a flat array (there are a few dozen
+		/// objects, they are searched by id) so adding and removing one doesn't allocate
+		/// </summary>
+		std::vector<OcclusionTest> occlusionTests;
+		std::vector<GLuint> freeQueries;
+		OcclusionStatistics occlusionStatistics;
+		unsigned int frame;
+
+		GLuint queries[SceneRendererConstants::queryLatency];
+		bool queryIssued[SceneRendererConstants::queryLatency];
+		int queryFrame;
+		double shadedFragments;
+	};
+}
@@ -0,0 +1,193 @@
+#include "Shadows.hpp"
+
+#include <cmath>
+
+#include <include/math.h>
+#include "GameObject.hpp"
+
+using namespace GameEngine::ShadowConstants;
+
+namespace {
+	/// <summary>
+	/// Build a matrix from its rows
+	/// </summary>
+	glm::mat4 fromRows(const glm::vec4& x, const glm::vec4& y, const glm::vec4& z, const glm::vec4& w) {
+		return glm::transpose(glm::mat4(x, y, z, w));
+	}
+
+	/// <summary>
+	/// Maps the clip space [-1, 1] of a map to the texture space [0, 1]
+	/// </summary>
+	const glm::mat4 clipToTexture = glm::translate(glm::mat4(1), glm::vec3(0.5f)) * glm::scale(glm::mat4(1), glm::vec3(0.5f));
+}
+
+GameEngine::ShadowMaps::ShadowMaps() : direction(0, -1, 0), right(1, 0, 0), dirty(false), dirtyMin(0), dirtyMax(0),
+	frontier(INFINITY), staticMatrix(1), dynamicMatrix(1)
+{
+}
+
+void GameEngine::ShadowMaps::Init(const glm::vec3& lightDirection)
+{
+	// Keep the rows of the maps aligned with the world Z
+	direction = glm::normalize(glm::vec3(lightDirection.x, lightDirection.y, 0));
+	right = glm::vec3(-direction.y, direction.x, 0);
+
+	staticMap.Create(staticWidth, staticLength, {}, GL_DEPTH_COMPONENT24, true);
+	dynamicMap.Create(dynamicSize, dynamicSize, {}, GL_DEPTH_COMPONENT24, true);
+
+	// The static map repeats along the track
+	glBindTexture(GL_TEXTURE_2D, staticMap.GetDepthTextureID());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// Nothing casts shadows yet
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	for (auto map : { &staticMap, &dynamicMap }) {
+		map->Bind();
+		glClear(GL_DEPTH_BUFFER_BIT);
+	}
+	FrameBuffer::BindDefault();
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+	// Like the clip matrix of the strips mapped to [0, 1], except that v = z / staticExtentZ for
+	// the whole track (the texture wraps it)
+	float depthRange = depthMax - depthMin;
+	staticMatrix = fromRows(
+		glm::vec4(right / staticExtentX, 0.5f),
+		glm::vec4(0, 0, 1.f / staticExtentZ, 0),
+		glm::vec4(direction / depthRange, -depthMin / depthRange),
+		glm::vec4(0, 0, 0, 1));
+
+	frontier = INFINITY;
+	dirty = false;
+}
+
+glm::mat4 GameEngine::ShadowMaps::ClipMatrix(float centerX, float extentX, float zStart, float zEnd) const
+{
+	float depthRange = depthMax - depthMin;
+	return fromRows(
+		glm::vec4(right * (2.f / extentX), -2.f * centerX / extentX),
+		glm::vec4(0, 0, 2.f / (zEnd - zStart), -2.f * zStart / (zEnd - zStart) - 1.f),
+		glm::vec4(direction * (2.f / depthRange), -2.f * depthMin / depthRange - 1.f),
+		glm::vec4(0, 0, 0, 1));
+}
+
+void GameEngine::ShadowMaps::Invalidate(float zMin, float zMax)
+{
+	if (!dirty) {
+		dirtyMin = zMin;
+		dirtyMax = zMax;
+		dirty = true;
+	}
+	else {
+		dirtyMin = MIN(dirtyMin, zMin);
+		dirtyMax = MAX(dirtyMax, zMax);
+	}
+}
+
+void GameEngine::ShadowMaps::UpdateStatic(Span<GameObject*> objects)
+{
+	if (!dirty || !staticMap.GetFrameBufferID()) return;
+	dirty = false;
+
+	// The rows between the strip and the frontier were never drawn for this part of the track,
+	// they still hold the shadows of a previous lap around the map
+	float zMin = dirtyMin;
+	float zMax = dirtyMax;
+	if (zMin < frontier && frontier != INFINITY) {
+		zMax = MAX(zMax, frontier);
+	}
+	frontier = MIN(frontier, zMin);
+
+	// The map can't hold more than its length
+	zMax = MIN(zMax, zMin + staticExtentZ);
+
+	float rowLength = staticExtentZ / staticLength;
+	DrawStaticRows((long long)floor(zMin / rowLength), (long long)ceil(zMax / rowLength), objects);
+}
+
+void GameEngine::ShadowMaps::DrawStaticRows(long long firstRow, long long lastRow, Span<GameObject*> objects)
+{
+	float rowLength = staticExtentZ / staticLength;
+
+	// Restored afterwards, the frame can be drawn in an off-screen target
+	GLint viewport[4], frameBuffer;
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &frameBuffer);
+
+	staticMap.Bind();
+	glEnable(GL_SCISSOR_TEST);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(2.f, 4.f);
+
+	// Split the strip where it wraps around the map
+	while (firstRow < lastRow) {
+		int start = (int)(((firstRow % staticLength) + staticLength) % staticLength);
+		int count = (int)MIN(lastRow - firstRow, (long long)(staticLength - start));
+
+		float zStart = firstRow * rowLength;
+		float zEnd = (firstRow + count) * rowLength;
+
+		glViewport(0, start, staticWidth, count);
+		glScissor(0, start, staticWidth, count);
+		glClear(GL_DEPTH_BUFFER_BIT);
+
+		glm::mat4 clip = ClipMatrix(0, staticExtentX, zStart, zEnd);
+		for (auto object : objects) {
+			float z = object->getPosition().z;
+			float halfLength = object->getScale().z / 2;
+			if (z + halfLength >= zStart && z - halfLength <= zEnd) {
+				object->RenderDepth(clip, glm::mat4(1));
+			}
+		}
+
+		firstRow += count;
+	}
+
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glDisable(GL_SCISSOR_TEST);
+	glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void GameEngine::ShadowMaps::UpdateDynamic(GameObject& object)
+{
+	if (!dynamicMap.GetFrameBufferID()) return;
+
+	glm::vec3 center = object.getPosition();
+	float centerX = glm::dot(center, right);
+	glm::mat4 clip = ClipMatrix(centerX, dynamicExtent, center.z - dynamicExtent / 2, center.z + dynamicExtent / 2);
+	dynamicMatrix = clipToTexture * clip;
+
+	GLint viewport[4], frameBuffer;
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &frameBuffer);
+
+	dynamicMap.Bind();
+	glClear(GL_DEPTH_BUFFER_BIT);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(2.f, 4.f);
+
+	object.RenderDepth(clip, glm::mat4(1));
+
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void GameEngine::ShadowMaps::Bind() const
+{
+	staticMap.BindDepthTexture(GL_TEXTURE0 + SHADOW_STATIC_UNIT);
+	dynamicMap.BindDepthTexture(GL_TEXTURE0 + SHADOW_DYNAMIC_UNIT);
+}
+
+void GameEngine::ShadowMaps::SetUniforms(Shader* shader) const
+{
+	GLint location = shader->GetUniformLocation("shadow_static_matrix");
+	if (location < 0) return;
+
+	glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(staticMatrix));
+	glUniformMatrix4fv(shader->GetUniformLocation("shadow_dynamic_matrix"), 1, GL_FALSE, glm::value_ptr(dynamicMatrix));
+	glUniform1f(shader->GetUniformLocation("shadow_bias"), bias);
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <vector>
+
+#include <Core/Engine.h>
+#include <Core/GPU/FrameBuffer.h>
+#include <include/span.h>
+
+namespace GameEngine {
+	class GameObject;
+
+	namespace ShadowConstants {
+		/// <summary>
+		/// The size of the static shadow map, in texels (across the track and along it)
+		/// </summary>
+		const int staticWidth = 512;
+		const int staticLength = 4096;
+
+		/// <summary>
+		/// The area covered by the static shadow map, in world units. The map wraps along Z, so
+		/// the track ahead of the player must be shorter than staticExtentZ.
+		/// </summary>
+		const float staticExtentX = 16.f;
+		const float staticExtentZ = 512.f;
+
+		/// <summary>
+		/// The size of the dynamic shadow map (in texels) and the area it covers around the player (in world units)
+		/// </summary>
+		const int dynamicSize = 256;
+		const float dynamicExtent = 4.f;
+
+		/// <summary>
+		/// The depth range of both maps, measured along the light direction
+		/// </summary>
+		const float depthMin = -20.f;
+		const float depthMax = 20.f;
+
+		/// <summary>
+		/// Subtracted from the depth of the receivers, against shadow acne
+		/// </summary>
+		const float bias = 0.002f;
+	}
+
+	/// <summary>
+	/// Shadows of a directional light for a track scrolling along -Z. The light direction has no
+	/// Z component, so a row of a shadow map always covers the same world Z.
+	/// The static objects (the platforms) are drawn in a large map that wraps along Z: when a
+	/// platform is spawned, only the strip of rows it covers is cleared and drawn again, and the
+	/// map is left untouched the rest of the time. The dynamic objects (the player) are drawn
+	/// every frame in a small map that follows them. The shader takes the darkest of the two.
+	/// </summary>
+	class ShadowMaps
+	{
+	public:
+		ShadowMaps();
+
+		/// <summary>
+		/// Create the shadow maps, must be called after OpenGL was initialized
+		/// </summary>
+		/// <param name="lightDirection">The direction of the light, its Z component is ignored</param>
+		void Init(const glm::vec3& lightDirection);
+
+		/// <summary>
+		/// Mark a part of the track as changed (a static object was added there)
+		/// </summary>
+		/// <param name="zMin">The start of the changed part</param>
+		/// <param name="zMax">The end of the changed part</param>
+		void Invalidate(float zMin, float zMax);
+
+		/// <summary>
+		/// Draw the invalidated strip of the static map again (nothing is drawn if nothing changed)
+		/// </summary>
+		/// <param name="objects">The static objects, only the ones overlapping the strip are drawn</param>
+		void UpdateStatic(Span<GameObject*> objects);
+
+		/// <summary>
+		/// Draw the dynamic map, centered on an object
+		/// </summary>
+		/// <param name="object">The object casting the dynamic shadow</param>
+		void UpdateDynamic(GameObject& object);
+
+		/// <summary>
+		/// Bind the shadow maps on SHADOW_STATIC_UNIT and SHADOW_DYNAMIC_UNIT
+		/// </summary>
+		void Bind() const;
+
+		/// <summary>
+		/// Set the uniforms used to sample the shadow maps
+		/// </summary>
+		/// <param name="shader">The shader, already in use</param>
+		void SetUniforms(Shader* shader) const;
+
+	private:
+		/// <summary>
+		/// The matrix mapping the world to the clip space of a shadow map
+		/// </summary>
+		/// <param name="centerX">The world position mapped to the center of the map, across the track</param>
+		/// <param name="extentX">The world size covered across the track</param>
+		/// <param name="zStart">The world Z mapped to the bottom of the map</param>
+		/// <param name="zEnd">The world Z mapped to the top of the map</param>
+		glm::mat4 ClipMatrix(float centerX, float extentX, float zStart, float zEnd) const;
+
+		/// <summary>
+		/// Clear and draw the rows [firstRow, lastRow) of the static map, they can wrap around the map
+		/// </summary>
+		void DrawStaticRows(long long firstRow, long long lastRow, Span<GameObject*> objects);
+
+		FrameBuffer staticMap;
+		FrameBuffer dynamicMap;
+
+		/// <summary>
+		/// The light direction, and the axis of the maps across the track
+		/// </summary>
+		glm::vec3 direction;
+		glm::vec3 right;
+
+		/// <summary>
+		/// The part of the track invalidated since the last update
+		/// </summary>
+		bool dirty;
+		float dirtyMin;
+		float dirtyMax;
+
+		/// <summary>
+		/// The smallest Z drawn in the static map, the rows before it hold old data
+		/// </summary>
+		float frontier;
+
+		glm::mat4 staticMatrix;
+		glm::mat4 dynamicMatrix;
+	};
+}
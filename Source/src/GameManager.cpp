@@ -1,122 +1,294 @@
 #include "GameManager.hpp"
+#include "GameRules.hpp"
+#include "TrackGenerator.hpp"
 
 #include <vector>
 #include <queue>
+#include <algorithm>
+#include <cfloat>
 #include <math.h>
 
-/// <summary>
-/// Map a value that is in a range to another range
-/// </summary>
-/// <param name="sourceNumber">The value</param>
-/// <param name="fromA">Starting value of the first range</param>
-/// <param name="fromB">End value of the first range</param>
-/// <param name="toA">Starting value of the second range</param>
-/// <param name="toB">End value of the second range</param>
-/// <param name="decimalPrecision">The number of decimals to use</param>
-/// <returns>The mapped value</returns>
-double mapBetweenRanges(double sourceNumber, double fromA, double fromB, double toA, double toB, int decimalPrecision) {
-	double deltaA = fromB - fromA;
-	double deltaB = toB - toA;
-	double scale = deltaB / deltaA;
-	double negA = -1 * fromA;
-	double offset = (negA * scale) + toA;
-	double finalNumber = (sourceNumber * scale) + offset;
-	int calcScale = (int)pow(10, decimalPrecision);
-	return (double)round(finalNumber * calcScale) / calcScale;
-}
-
 using namespace Skyroads;
 
-GameManager::GameManager()
+GameManager::GameManager() : gameOver(false), historyStart(0), historyCount(0), nextHistoryTime(0), printStatistics(false), simulationAllocations(0), frameAllocations(0), frameStartAllocations(0), checkAllocations(false), processStartAllocations(0), checkedFrames(0), allocationCheckFailed(false), offscreen(false), frameLimit(0), frameCount(0)
 {
+	// The track is random (rand is seeded when the program starts), and replayed from the snapshots
+	random.seed((unsigned int)rand());
+	track = new TrackGenerator();
+	history.resize(Constants::rewindSnapshots);
+
 	camera = new GameEngine::Camera();
 	camera->Set(glm::vec3(0, 5.f, 30.f), glm::vec3(0, 1, 0), glm::vec3(0, 1, 0));
 	camera->distanceToTarget = 3.5f;
-	camera->projectionMatrix = glm::perspective(RADIANS(gameState.cameraSettings.cameraFOV), window->props.aspectRatio, 0.01f, 200.f);
+	camera->projectionMatrix = glm::perspective(RADIANS(gameState.cameraSettings.cameraFOV), window->props.aspectRatio, 0.01f, Constants::viewDistance);
 }
 
 GameManager::~GameManager()
 {
+	capture.Stop();
+	delete track;
+}
+
+void GameManager::EnableOffscreen()
+{
+	glm::ivec2 resolution = window->GetResolution();
+	offscreen = offscreenTarget.Create(resolution.x, resolution.y, { GL_RGBA8 });
+}
+
+void GameManager::StartCapture(const std::string& path, FrameCapture::Format format)
+{
+	glm::ivec2 resolution = offscreen ? offscreenTarget.GetResolution() : window->GetResolution();
+	capture.Start(path, format, resolution.x, resolution.y);
+
+	// A recording doesn't have to keep up with the display, keep its frames at full resolution
+	renderSettings.dynamicResolution = false;
+	dynamicResolution.SetEnabled(false);
+}
+
+void GameManager::SetFrameLimit(unsigned int frames)
+{
+	frameLimit = frames;
+}
+
+void GameManager::EnableAllocationCheck()
+{
+	checkAllocations = true;
+	checkedFrames = 0;
+}
+
+bool GameManager::AllocationCheckFailed() const
+{
+	return allocationCheckFailed;
 }
 
 void GameManager::Init()
 {
-	// Load meshes
+	// Load meshes (in the background, they are drawn once they are uploaded)
 	for each (auto & name in Constants::meshNames) {
 		LoadMesh(name);
 	}
 
-	// Load shaders
-	for each (auto & name in Constants::shaderNames) {
-		LoadShader(name);
+	// Bake the noise used by the player (or load it from the cache)
+	GameEngine::Noise::Init();
+
+	// Load shaders (while the meshes are loading)
+	// The game objects draw with variants of the "Object" shader, one per feature mask
+	{
+		std::string shaderPath = "Source/src/Shaders/";
+		objectShaders = new ShaderVariants("Object", GameEngine::ShaderFeatures::names);
+		objectShaders->AddShader(shaderPath + "Object.VS.glsl", GL_VERTEX_SHADER);
+		objectShaders->AddShader(shaderPath + "Object.FS.glsl", GL_FRAGMENT_SHADER);
+
+		// Reload the variants with F5 and when their files are edited
+		objectShaders->OnCreate([this](Shader* shader) {
+			shaders[shader->GetName()] = shader;
+			ShaderManager::Watch(shader);
+		});
+
+		// Compile the variants the game uses now, instead of on the frame they are first drawn
+		for (auto features : Constants::shaderVariants) {
+			objectShaders->Get(features);
+		}
 	}
 
+	// The displacement of the distorted player, computed once per frame with transform feedback
+	// and read by the DISPLACED variant in every pass
+	{
+		Shader* shader = new Shader("Displace");
+		shader->AddShader("Source/src/Shaders/Displace.VS.glsl", GL_VERTEX_SHADER);
+		shader->SetTransformFeedbackVaryings({ "displaced" });
+		shader->CreateAndLink();
+		shaders[shader->GetName()] = shader;
+		ShaderManager::Watch(shader);
+	}
+
+	// The post-processing passes draw a full-screen quad
+	{
+		Mesh* quad = new Mesh("screen_quad");
+		AssetLoader::LoadMesh(quad, RESOURCE_PATH::MODELS + "Primitives/", "screen_quad.obj");
+		meshes[quad->GetMeshID()] = quad;
+
+		postProcess.Init(quad, "Source/src/Shaders/");
+		for (auto shader : postProcess.GetShaders()) {
+			shaders[shader->GetName()] = shader;
+			ShaderManager::Watch(shader);
+		}
+	}
+
+	// The GPU time of the scene drives its resolution
+	dynamicResolution.Init();
+	sceneRenderer.Init();
+
 	using namespace GameEngine;
 	// Link the meshes and shaders to the game objects
 	GameObject::meshes = &meshes;
-	GameObject::shaders = &shaders;
+	GameObject::shaderVariants = objectShaders;
+
+	// The point lights are binned in the clusters of the camera every frame
+	lighting.Init();
+	GameObject::lighting = &lighting;
+
+	shadowMaps.Init(Constants::shadowLightDirection);
+	GameObject::shadows = &shadowMaps;
 	
 	// Initialize the player object
-	{
-		GameObject player("player", glm::vec3(Constants::playerStartingPosition));
-		player.getRigidBody().state.drag_coef = 10.f;
-		player.isInJump = true;
-		addGameObject(player);
-	}
-}
+	player = GameObject("player", glm::vec3(Constants::playerStartingPosition));
+	player.getRigidBody().state.drag_coef = Constants::playerDrag;
+	player.isInJump = true;
 
-void GameManager::addGameObject(GameEngine::GameObject object)
-{
-	gameObjects[object.getID()] = object;
+	// The game starts again from here, on another track
+	track->Start(random());
+	SaveSnapshot(startSnapshot);
 }
 
-GameEngine::GameObject* GameManager::getGameObject(const long int id)
+void GameManager::BenchmarkNoise()
 {
-	return &(gameObjects[id]);
-}
+	// Everything must be on the GPU before measuring
+	AssetLoader::WaitAll();
 
-void GameManager::LoadShader(std::string name)
-{
-	std::string shaderPath = "Source/src/Shaders/";
-	Shader* shader = new Shader(name.c_str());
-	shader->AddShader(shaderPath + name + ".VS.glsl", GL_VERTEX_SHADER);
-	shader->AddShader(shaderPath + name + ".FS.glsl", GL_FRAGMENT_SHADER);
-	shader->CreateAndLink();
-	shaders[shader->GetName()] = shader;
+	Mesh* sphere = meshes["sphere"];
+	glm::mat4 model = glm::translate(glm::mat4(1), Constants::playerStartingPosition);
+
+	GameEngine::Noise::Bind(GL_TEXTURE1);
+
+	// Only the vertex stage differs between the two variants
+	glEnable(GL_RASTERIZER_DISCARD);
+
+	GLuint query;
+	glGenQueries(1, &query);
+
+	const int passes = 20;
+	using namespace GameEngine::ShaderFeatures;
+	for (auto features : { LIT | NOISE | DISTORTED, LIT | NOISE | NOISE_TEXTURE | DISTORTED }) {
+		Shader* shader = objectShaders->Get(features);
+		shader->Use();
+		glUniformMatrix4fv(shader->loc_view_matrix, 1, GL_FALSE, glm::value_ptr(camera->GetViewMatrix()));
+		glUniformMatrix4fv(shader->loc_projection_matrix, 1, GL_FALSE, glm::value_ptr(camera->projectionMatrix));
+		glUniformMatrix4fv(shader->loc_model_matrix, 1, GL_FALSE, glm::value_ptr(model));
+
+		// The first pass is a warm up (the driver can finish compiling the program there)
+		GLuint64 total = 0;
+		for (int pass = 0; pass <= passes; pass++) {
+			glUniform1f(shader->GetUniformLocation("time"), (GLfloat)pass);
+
+			glBeginQuery(GL_TIME_ELAPSED, query);
+			for (int i = 0; i < Constants::noiseBenchmarkDraws; i++) {
+				sphere->Render(shader->loc_texture_layer);
+			}
+			glEndQuery(GL_TIME_ELAPSED);
+
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+			if (pass > 0) total += elapsed;
+		}
+
+		double passTime = total / 1e6 / passes;
+		std::cout << shader->GetName() << ": " << passTime << " ms for " << Constants::noiseBenchmarkDraws << " spheres ("
+			<< passTime * 1000 / Constants::noiseBenchmarkDraws << " us per sphere)" << std::endl;
+	}
+
+	glDeleteQueries(1, &query);
+	glDisable(GL_RASTERIZER_DISCARD);
 }
 
 void GameManager::LoadMesh(std::string name)
 {
 	std::string meshPath = "Source/src/Meshes/";
 	Mesh* mesh = new Mesh(name.c_str());
-	mesh->LoadMesh(meshPath, name + ".obj");
+	AssetLoader::LoadMesh(mesh, meshPath, name + ".obj");
 	meshes[mesh->GetMeshID()] = mesh;
 }
 
+bool GameManager::AcquireFrame()
+{
+	return snapshots.Acquire();
+}
+
+void GameManager::ApplyRenderSettings(const FrameSnapshot& frame)
+{
+	const RenderSettings& settings = frame.settings;
+	postProcess.SetEnabled(settings.postProcessPasses);
+	sceneRenderer.SetDepthPrepass(settings.depthPrepass);
+	sceneRenderer.SetSorting(settings.sorting);
+	sceneRenderer.SetOverdrawView(settings.overdrawView);
+	sceneRenderer.SetOcclusionCulling(settings.occlusionCulling);
+	sceneRenderer.SetCommandBuffers(settings.commandBuffers);
+
+	// Turning it on or off resets the scale
+	if (dynamicResolution.IsEnabled() != settings.dynamicResolution) {
+		dynamicResolution.SetEnabled(settings.dynamicResolution);
+	}
+
+	if (frame.printStatistics) {
+		// Print the GPU time of the frame and of the post-processing passes
+		std::cout << "Scene at " << (int)round(dynamicResolution.GetScale() * 100) << "% resolution, "
+			<< dynamicResolution.GetFrameTime() << " ms (GPU)" << std::endl;
+		postProcess.PrintTimings();
+		sceneRenderer.PrintStatistics(postProcess.GetResolution());
+		PrintInputLatency();
+		PrintFramePacing();
+
+		// Steady frames shouldn't allocate (the counts are 0 unless built with COUNT_ALLOCATIONS)
+		std::cout << "Heap allocations: " << frame.simulationAllocations << " in the simulation, "
+			<< frameAllocations << " in the drawing of the last frame; frame arena peak "
+			<< frameArena.GetPeak() / 1024.f << " KB (" << frameArena.GetOverflows() << " overflows)" << std::endl;
+	}
+}
+
 void GameManager::FrameStart()
 {
-	// clears the color buffer (using the previously set color) and depth buffer
+	// The arrays of the last frame are freed, its allocations are counted up to here
+	frameArena.Reset();
+	unsigned long long allocations = GetThreadAllocations();
+	frameAllocations = allocations - frameStartAllocations;
+	frameStartAllocations = allocations;
+
+	// Every thread is counted, the jobs of the frame run on the workers
+	unsigned long long processAllocations = GetAllocations();
+	if (checkAllocations && ++checkedFrames > Constants::allocationCheckWarmup && processAllocations != processStartAllocations && !allocationCheckFailed) {
+		std::cerr << "Allocation check failed: " << processAllocations - processStartAllocations << " heap allocations in frame " << checkedFrames
+			<< " (" << snapshots.GetReadBuffer().simulationAllocations << " in the simulation, " << frameAllocations << " on the render thread)" << std::endl;
+		allocationCheckFailed = true;
+		Exit();
+	}
+	processStartAllocations = processAllocations;
+
+	ApplyRenderSettings(snapshots.GetReadBuffer());
+
 	glClearColor(0, 0, 0, 1);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	glm::ivec2 resolution = window->GetResolution();
-	// sets the screen area where to draw
-	glViewport(0, 0, resolution.x, resolution.y);
+
+	// the off-screen target follows the size of the window (unless it is being recorded)
+	if (offscreen) {
+		if (!capture.IsRunning()) offscreenTarget.Resize(resolution.x, resolution.y);
+		resolution = offscreenTarget.GetResolution();
+	}
+
+	// draw the scene in the HDR target of the post-processing (it is cleared and sets the viewport),
+	// at the resolution that keeps the frame in its GPU budget. The passes upscale it to the
+	// final image in FrameEnd.
+	dynamicResolution.BeginFrame();
+	postProcess.Begin(dynamicResolution.GetResolution(resolution));
+
+	// the small textures are all in one array, bound once for the whole frame
+	TextureManager::BindTextureArray();
+	GameEngine::Noise::Bind(GL_TEXTURE1);
 }
 
 void GameManager::UpdateCamera() {
 	// Update camera mode and position
 	if (gameState.cameraSettings.cameraMode) {
 		// 3rd Person
-		camera->Set(gameObjects[0].getRigidBody().state.x + glm::vec3(0.f, .5f, 3.5f), gameObjects[0].getRigidBody().state.x - glm::vec3(0, 1, 100), glm::vec3(0, 1, 0));
-		gameObjects[0].isRendered(true);
+		camera->Set(player.getRigidBody().state.x + glm::vec3(0.f, .5f, 3.5f), player.getRigidBody().state.x - glm::vec3(0, 1, 100), glm::vec3(0, 1, 0));
+		player.isRendered(true);
 		camera->RotateThirdPerson_OX(gameState.cameraSettings.cameraRotation.x);
 		camera->RotateThirdPerson_OY(gameState.cameraSettings.cameraRotation.y);
 	}
 	else {
 		// 1st Person
-		camera->Set(gameObjects[0].getRigidBody().state.x, gameObjects[0].getRigidBody().state.x - glm::vec3(0, 1, 100), glm::vec3(0, 1, 0));
-		gameObjects[0].isRendered(false);
+		camera->Set(player.getRigidBody().state.x, player.getRigidBody().state.x - glm::vec3(0, 1, 100), glm::vec3(0, 1, 0));
+		player.isRendered(false);
 		camera->RotateFirstPerson_OX(gameState.cameraSettings.cameraRotation.x);
 		camera->RotateFirstPerson_OY(gameState.cameraSettings.cameraRotation.y);
 	}
@@ -125,31 +297,33 @@ void GameManager::UpdateCamera() {
 	gameState.cameraSettings.cameraFOV = (float)mapBetweenRanges(gameState.playerState.playerSpeed, Constants::minSpeed, Constants::maxSpeed, Constants::minFov, Constants::maxFov, 1);
 
 	// Update the projection matrix
-	camera->projectionMatrix = glm::perspective(RADIANS(gameState.cameraSettings.cameraFOV), window->props.aspectRatio, 0.01f, 200.f);
+	camera->projectionMatrix = glm::perspective(RADIANS(gameState.cameraSettings.cameraFOV), window->props.aspectRatio, 0.01f, Constants::viewDistance);
 }
 
 void GameManager::UpdatePlayer()
 {
 	// Move the player forward
-	gameObjects[0].getRigidBody().state.x.z -= gameState.playerState.playerSpeed;
+	player.getRigidBody().state.x.z -= gameState.playerState.playerSpeed;
 
 	if (window->KeyHold(GLFW_KEY_A)) {
 		// Move player left
-		gameObjects[0].getRigidBody().state.v.x = -Constants::lateralSpeed;
+		player.getRigidBody().state.v.x = -Constants::lateralSpeed;
 	}
 	else if (window->KeyHold(GLFW_KEY_D)) {
 		// Move player right
-		gameObjects[0].getRigidBody().state.v.x = Constants::lateralSpeed;
+		player.getRigidBody().state.v.x = Constants::lateralSpeed;
 	}
 
 	// Check if the player has fallen
-	if (gameObjects[0].getPosition().y < Constants::outOfBoundY) {
-		GameOver();
+	if (player.getPosition().y < Constants::outOfBoundY) {
+		gameOver = true;
 	}
 }
 
 void GameManager::UpdateGameState(const float deltaTime)
 {
+	gameState.time += deltaTime;
+
 	// Update Player
 	UpdatePlayer();
 
@@ -162,33 +336,50 @@ void GameManager::UpdateGameState(const float deltaTime)
 	// Update the platforms
 	PlatformManagement();
 
-	// Check fuel state
-	float speedFuelFactor = mapBetweenRanges(gameState.playerState.playerSpeed, Constants::minSpeed, Constants::maxSpeed, 0.5, 1.5, 1);
-	gameState.playerState.fuel -= deltaTime * Constants::fuelFlow * speedFuelFactor;
-	if (gameState.playerState.fuel <= 0) {
-		// If all the fuel was used, a life is lost. If the game can go on
-		// (at least 1 life remaining), reset the fuel to max
-
-		gameState.playerState.lives--;
-		if (gameState.playerState.lives > 0) {
-			gameState.playerState.fuel = Constants::maxFuel;
-		}
+	// Check fuel state, if all lives are lost, game over
+	if (!GameRules::UpdateFuel(gameState, deltaTime)) {
+		gameOver = true;
 	}
 
-	// Check lives
-	if(gameState.playerState.lives <= 0) {
-		// If all lives are lost, game over
-		GameOver();
+	// Check if full speed should still be applied
+	GameRules::UpdateForcedSpeed(gameState);
+}
+
+void Skyroads::GameManager::CollectLights(const FrameSnapshot& frame)
+{
+	lighting.Clear();
+
+	for (auto& object : frame.objects) {
+		if (!object.isEmissive()) continue;
+
+		// Spread the lights along the platform
+		glm::vec3 position = object.getPosition();
+		float length = object.getScale().z;
+		for (int i = 0; i < Constants::platformLights; i++) {
+			float z = position.z - length / 2 + length * (i + 0.5f) / Constants::platformLights;
+
+			GameEngine::PointLight light;
+			light.position = glm::vec3(position.x, GameEngine::ObjectConstants::platformTopHeight + Constants::platformLightHeight, z);
+			light.radius = Constants::platformLightRadius;
+			light.color = object.getColor();
+			light.intensity = Constants::platformLightIntensity;
+			lighting.AddLight(light);
+		}
 	}
 
-	// Check if full speed should still be applied
-	if (gameState.playerState.isFullSpeed && Engine::GetElapsedTime() - gameState.playerState.forcedSpeedStart >= Constants::forcedSpeedTime) {
-		gameState.playerState.isFullSpeed = false;
-		gameState.playerState.playerSpeed = gameState.playerState.oldPlayerSpeed;
+	// The player glows with the color of the last power-up while it is distorted, fading out in the last second
+	const GameEngine::GameObject& player = frame.objects[0];
+	if (player.getDistortedTime() > 0) {
+		GameEngine::PointLight light;
+		light.position = player.getPosition();
+		light.radius = Constants::powerLightRadius;
+		light.color = frame.powerColor;
+		light.intensity = Constants::powerLightIntensity * (float)MIN(player.getDistortedTime(), 1.0);
+		lighting.AddLight(light);
 	}
 }
 
-void Skyroads::GameManager::RenderUI()
+void Skyroads::GameManager::RenderUI(const FrameSnapshot& frame)
 {
 	// Render the fuel bar
 	GameEngine::GameObject fuelbar("fuelbar", glm::vec3(-0.9, 0, 0));
@@ -196,14 +387,14 @@ void Skyroads::GameManager::RenderUI()
 
 	ufuelbar.setScale(Constants::fuelbarScale + Constants::fuelbarsDiff);
 
-	float percent = gameState.playerState.fuel / Constants::maxFuel;
+	float percent = frame.fuel / Constants::maxFuel;
 	fuelbar.setScale(glm::vec3(Constants::fuelbarScale.x, Constants::fuelbarScale.y * percent, Constants::fuelbarScale.z));
 
 	fuelbar.Render2D();
 	ufuelbar.Render2D();
 
 	// Render the number of lifes
-	int lifesToRender = gameState.playerState.lives;
+	int lifesToRender = frame.lives;
 	glm::vec3 pos = glm::vec3(0.9, -0.9, 0);
 	
 	while (lifesToRender > 0) {
@@ -216,175 +407,351 @@ void Skyroads::GameManager::RenderUI()
 	}
 }
 
-void GameManager::Update(float deltaTimeSeconds)
+void GameManager::Simulate(float deltaTimeSeconds)
 {
+	// The arrays of the last simulation are freed
+	simulationArena.Reset();
+	unsigned long long allocations = GetThreadAllocations();
+
 	UpdateGameState(deltaTimeSeconds);
-	RenderUI();
 
-	std::vector<GameEngine::GameObject*> gameObjectsVector;
-	for (auto& object : gameObjects) {
-		gameObjectsVector.push_back(&(object.second));
+	Span<GameEngine::GameObject*> gameObjectsVector = simulationArena.Allocate<GameEngine::GameObject*>(1 + platforms.Size());
+	gameObjectsVector[0] = &player;
+	for (int i = 0; i < platforms.Size(); i++) {
+		gameObjectsVector[1 + i] = &platforms[i];
 	}
 
-	// Update Light
-	glm::vec3 lightPosition = gameObjects[0].getRigidBody().state.x + Constants::lightPositionOffset;
-	// For every gameObject types (type.first = id, type.second = the object)
-	for (auto& object : gameObjects) {
-		// Update position
-		object.second.UpdatePhysics(deltaTimeSeconds);
+	// Update the positions on all the cores, the collisions change the game state so they are
+	// checked on the main thread once every object moved
+	JobSystem::ParallelFor(gameObjectsVector.size(), 0, [gameObjectsVector, deltaTimeSeconds](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			gameObjectsVector[i]->UpdatePhysics(deltaTimeSeconds);
+		}
+	});
+	CheckCollisions(player.ManageCollisions(gameObjectsVector, simulationArena));
 
-		// Check collisions
-		CheckCollisions(object.second.ManageCollisions(gameObjectsVector, &gameObjects));
+	if (gameOver) {
+		GameOver();
+	}
+	RecordHistory();
 
-		// Render objects
-		object.second.Render(camera, lightPosition);
-	};
+	simulationAllocations = GetThreadAllocations() - allocations;
+	PublishFrame();
+}
+
+void GameManager::PublishFrame()
+{
+	FrameSnapshot& frame = snapshots.GetWriteBuffer();
+
+	// The player first
+	frame.objects.resize(1 + platforms.Size());
+	frame.objects[0] = player;
+	for (int i = 0; i < platforms.Size(); i++) {
+		frame.objects[1 + i] = platforms[i];
+	}
+
+	frame.camera = *camera;
+	frame.lightPosition = player.getRigidBody().state.x + Constants::lightPositionOffset;
+	frame.powerColor = gameState.playerState.powerColor;
+
+	// The motion blur grows with the player speed
+	frame.motionStrength = (float)mapBetweenRanges(gameState.playerState.playerSpeed, Constants::minSpeed, Constants::maxSpeed, 0, Constants::motionBlurStrength, 2);
+
+	frame.fuel = gameState.playerState.fuel;
+	frame.lives = (int)gameState.playerState.lives;
+
+	frame.shadowInvalidations = shadowInvalidations;
+	shadowInvalidations.count = 0;
+
+	frame.settings = renderSettings;
+	frame.printStatistics = printStatistics;
+	frame.simulationAllocations = simulationAllocations;
+	printStatistics = false;
+
+	snapshots.Publish();
+}
+
+void GameManager::Update(float deltaTimeSeconds)
+{
+	FrameSnapshot& frame = snapshots.GetReadBuffer();
+	GameEngine::Camera* frameCamera = &frame.camera;
+
+	Span<GameEngine::GameObject*> frameObjects = frameArena.Allocate<GameEngine::GameObject*>(frame.objects.size());
+	for (size_t i = 0; i < frame.objects.size(); i++) {
+		frameObjects[i] = &frame.objects[i];
+	}
+
+	// Displace the player sphere only while it is distorted, the passes drawing it then reuse
+	// the displaced vertices. Otherwise the shader computes the (undisplaced) lighting noise.
+	// The main thread can be reloading the shaders of the scene, they are only looked up here.
+	GameEngine::GameObject& player = frame.objects[0];
+	bool displaced = player.getDistortedTime() > 0 &&
+		playerDisplacement.Update(meshes.at("sphere"), shaders.at("Displace"), (float)Engine::GetElapsedTime());
+	unsigned int playerFeatures = player.getShaderFeatures() & ~GameEngine::ShaderFeatures::DISPLACED;
+	player.setShaderFeatures(displaced ? playerFeatures | GameEngine::ShaderFeatures::DISPLACED : playerFeatures);
+
+	// Bin the point lights in the clusters of the camera, and build the draw list (front to back),
+	// in jobs while the shadow maps are drawn
+	JobCounter lightsBinned, drawListReady;
+	glm::ivec2 sceneResolution = postProcess.GetResolution();
+	JobSystem::Run([this, &frame, frameCamera, sceneResolution]() {
+		CollectLights(frame);
+		lighting.Bin(frameCamera, sceneResolution);
+	}, &lightsBinned);
+	sceneRenderer.Prepare(frameObjects, frameCamera, &drawListReady);
+
+	// Draw the new platforms in the cached shadow map, and the player in its own map
+	for (int i = 0; i < frame.shadowInvalidations.count; i++) {
+		const glm::vec2& range = frame.shadowInvalidations.ranges[i];
+		shadowMaps.Invalidate(range.x, range.y);
+	}
+	Span<GameEngine::GameObject*> platforms = frameArena.Allocate<GameEngine::GameObject*>(frameObjects.size());
+	size_t platformCount = 0;
+	for (auto object : frameObjects) {
+		if (object->getType().rfind("platform_", 0) == 0) platforms[platformCount++] = object;
+	}
+	shadowMaps.UpdateStatic(platforms.first(platformCount));
+	shadowMaps.UpdateDynamic(player);
+	shadowMaps.Bind();
+
+	JobSystem::Wait(&lightsBinned);
+	lighting.Upload();
+	lighting.Bind();
+
+	// Render objects (front to back, after a depth pre-pass)
+	JobSystem::Wait(&drawListReady);
+	sceneRenderer.Render(frameCamera, frame.lightPosition);
 }
 
 void GameManager::FrameEnd()
 {
+	FrameSnapshot& frame = snapshots.GetReadBuffer();
+
+	// Post-process the scene into the final image
+	GLuint output = offscreen ? offscreenTarget.GetFrameBufferID() : 0;
+	glm::ivec2 outputResolution = offscreen ? offscreenTarget.GetResolution() : window->GetResolution();
+	postProcess.End(output, outputResolution, frame.camera.GetViewMatrix(), frame.camera.projectionMatrix, frame.motionStrength);
+	dynamicResolution.EndFrame();
+
+	// The UI is drawn over the final image, it isn't blurred nor tonemapped
+	RenderUI(frame);
+
+	// Queue the read back of the frame, it is encoded a few frames later
+	capture.Capture(offscreen ? offscreenTarget.GetFrameBufferID() : 0);
+
+	if (offscreen) {
+		// Show the frame, in case the window is visible
+		glm::ivec2 size = offscreenTarget.GetResolution();
+		glm::ivec2 resolution = window->GetResolution();
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, offscreenTarget.GetFrameBufferID());
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		glBlitFramebuffer(0, 0, size.x, size.y, 0, 0, resolution.x, resolution.y, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	if (frameLimit && ++frameCount >= frameLimit) {
+		capture.Stop();
+		Exit();
+	}
 }
 
-void Skyroads::GameManager::CheckCollisions(std::vector<int> collided)
+void Skyroads::GameManager::CheckCollisions(Span<int> collided)
 {
 	if (collided.size() == 0) return;
 
 	for (int id : collided) {
-		std::string type = gameObjects[id].getType();
+		GameEngine::GameObject* platform = platforms.Find(id);
+		if (!platform) return;
+
+		std::string type = platform->getType();
 
 		// Make sure this is a platform
-		if (type.rfind("platform_", 0) != 0) return;
+		auto platformType = std::find(Constants::platformTypes.begin(), Constants::platformTypes.end(), type);
+		if (platformType == Constants::platformTypes.end()) return;
 
-		std::string color_string = type.substr(type.find("_") + 1);
-		if (color_string == "red") {
+		PlatformColor color = (PlatformColor)(platformType - Constants::platformTypes.begin());
+		double distortedTime = 0;
+		if (!GameRules::ApplyPlatform(gameState, color, distortedTime)) {
 			// Instant Loss
-			GameOver();
+			gameOver = true;
 		}
-		else if (color_string == "yellow") {
-			// Lose fuel
-			gameState.playerState.fuel -= Constants::fuelLoss;
-			gameObjects[0].setDistorted(Constants::powerAnimationTime);
-		}
-		else if (color_string == "orange") {
-			// Speed up
-			gameState.playerState.isFullSpeed = true;
-			gameState.playerState.forcedSpeedStart = Engine::GetElapsedTime();
-			gameState.playerState.oldPlayerSpeed = gameState.playerState.playerSpeed;
-			gameState.playerState.playerSpeed = Constants::maxSpeed;
-			gameObjects[0].setDistorted(Constants::forcedSpeedTime);
-		}
-		else if (color_string == "green") {
-			// Gain fuel
-			gameState.playerState.fuel += Constants::fuelGain;
-			gameObjects[0].setDistorted(Constants::powerAnimationTime);
-			if (gameState.playerState.fuel > Constants::maxFuel) {
-				gameState.playerState.fuel = Constants::maxFuel;
-			}
-		}
-		else if (color_string == "white") {
-			if (gameState.playerState.lives < Constants::maxLives) {
-				// Gain life
-				gameState.playerState.lives += 1;
-				gameObjects[0].setDistorted(Constants::powerAnimationTime);
-			}
+		if (distortedTime > 0) {
+			player.setDistorted(distortedTime);
 		}
 
-		gameObjects[id].setType("platform_purple");
+		gameState.playerState.powerColor = platform->getColor();
+		platform->setType("platform_purple");
 	}
 }
 
 void Skyroads::GameManager::ComputeScore()
 {
-	gameState.points = abs(gameObjects[0].getRigidBody().state.x.z - Constants::playerStartingPosition.z);
+	GameRules::ComputeScore(gameState, player.getRigidBody().state.x.z);
 }
 
 void Skyroads::GameManager::GameOver()
 {
+	gameOver = false;
+
 	std::cout << " --- Game Over --- " << "\n";
 	std::cout << " Your score was : " << (int)gameState.points << "\n";
-	std::cout << " Press any key to exit ...\n";
-	int aux = _getch();
-	exit(0);
+
+	// Nobody is watching an off-screen run
+	if (!offscreen) {
+		std::cout << " Press R to play again, B to go back a few seconds, any other key to exit ...\n";
+		int key = tolower(_getch());
+		if (key == 'r') {
+			Restart();
+			return;
+		}
+		if (key == 'b' && historyCount > 0) {
+			Rewind();
+			return;
+		}
+	}
+
+	// Write the frames that are still being read back (once the render thread is done with them),
+	// then leave the main loop: the engine joins the loader, job and shader threads when it exits
+	StopRenderThread();
+	capture.Stop();
+	Exit();
 }
 
-void GameManager::PlatformManagement()
+void GameManager::Restart()
 {
-	// This function manages all the platforms, their spawning and removal
-	// The platforms will be randomly spawned, many will be without effects.
+	// A new track, the same one as the snapshot is only kept by the rewinds (it isn't placed again)
+	track->Start(random());
+	RestoreSnapshot(startSnapshot, false);
 
-	if (gameState.platformCount < Constants::maxPlatforms) {
-		// Check the lane that hasn't spawn a platform in the longest time
-		std::vector<float> nps = gameState.nextPlatformSpawn;
-		int minLaneID = std::max_element(nps.begin(), nps.end()) - nps.begin(); // Max because the z is in descending order
+	historyCount = 0;
+	nextHistoryTime = gameState.time;
+}
 
-		int platType = rand() % 100;
-		int platGap = rand() % (Constants::maxPlatformGap - Constants::minPlatformGap) + Constants::minPlatformGap;
+void GameManager::Rewind()
+{
+	// The oldest snapshot is the only one left, dying again soon goes back to the same place
+	history[0] = history[historyStart];
+	historyStart = 0;
+	historyCount = 1;
 
-		if (platType < Constants::simplePlatPercent) {
-			// Simple platform
-			GameEngine::GameObject platform("platform_blue", glm::vec3(Constants::lanesX[minLaneID], -0.125, nps[minLaneID]));
-			addGameObject(platform);
-		}
-		else {
-			// Effect platform
-			platType = mapBetweenRanges(platType, Constants::simplePlatPercent, 100, 0, 9, 1);
-
-			if (platType < 1) {
-				// Red platform - very few
-				GameEngine::GameObject platform("platform_red", glm::vec3(Constants::lanesX[minLaneID], -0.125, nps[minLaneID]));
-				addGameObject(platform);
-			}
-			else if (platType < 4) {
-				// Yellow platform - some
-				GameEngine::GameObject platform("platform_yellow", glm::vec3(Constants::lanesX[minLaneID], -0.125, nps[minLaneID]));
-				addGameObject(platform);
-			}
-			else if (platType < 6) {
-				// Green platform - few
-				GameEngine::GameObject platform("platform_green", glm::vec3(Constants::lanesX[minLaneID], -0.125, nps[minLaneID]));
-				addGameObject(platform);
-			}
-			else if (platType < 8) {
-				// Orange platform - few
-				GameEngine::GameObject platform("platform_orange", glm::vec3(Constants::lanesX[minLaneID], -0.125, nps[minLaneID]));
-				addGameObject(platform);
-			}
-			else if (platType < 9) {
-				// White platform - very few
-				GameEngine::GameObject platform("platform_white", glm::vec3(Constants::lanesX[minLaneID], -0.125, nps[minLaneID]));
-				addGameObject(platform);
-			}
-		}
+	RestoreSnapshot(history[0]);
+	nextHistoryTime = gameState.time + Constants::rewindInterval;
+}
 
-		gameState.platformCount++;
+void GameManager::RecordHistory()
+{
+	if (gameState.time < nextHistoryTime) return;
+	nextHistoryTime = gameState.time + Constants::rewindInterval;
 
-		// Update the next platform spawn for that lane
-		gameState.nextPlatformSpawn[minLaneID] -= GameEngine::ObjectConstants::platformLength + platGap;
+	// The oldest snapshot is replaced once the ring is full
+	int slot = (historyStart + historyCount) % Constants::rewindSnapshots;
+	if (historyCount == Constants::rewindSnapshots) {
+		historyStart = (historyStart + 1) % Constants::rewindSnapshots;
+	}
+	else {
+		historyCount++;
 	}
 
-	// Check what platforms are out of sight (need to be removed)
-	std::vector<int> toRemove;
-	for (auto& object : gameObjects) {
-		if (object.second.getType().rfind("platform_", 0) == 0) {
-			if (object.second.getPosition().z > gameObjects[0].getPosition().z + GameEngine::ObjectConstants::platformLength / 2 + Constants::noSpawnRange) {
-				toRemove.push_back(object.first);
-			}
-		}
+	SaveSnapshot(history[slot]);
+}
+
+void GameManager::SaveSnapshot(GameSnapshot& snapshot)
+{
+	snapshot.gameState = gameState;
+	snapshot.physicsTime = GameEngine::PhysixEngine::GetTime();
+	snapshot.trackSeed = track->GetSeed();
+	snapshot.trackPlatforms = track->GetTaken();
+	snapshot.trackRandom = track->GetPlacer().random;
+	snapshot.trackSpawns = track->GetPlacer().nextSpawns;
+
+	snapshot.objectCount = 0;
+	auto saveObject = [&snapshot](GameEngine::GameObject& object) {
+		if (snapshot.objectCount == GameSnapshot::capacity) return;
+
+		int i = snapshot.objectCount++;
+		auto type = std::find(Constants::platformTypes.begin(), Constants::platformTypes.end(), object.getType());
+		snapshot.ids[i] = object.getID();
+		snapshot.colors[i] = type != Constants::platformTypes.end() ? (PlatformColor)(type - Constants::platformTypes.begin()) : PlatformColor::BLUE;
+		snapshot.states[i] = object.getRigidBody().state;
+		snapshot.distortedTimes[i] = object.getDistortedTime();
+		snapshot.inJump[i] = object.isInJump;
+	};
+
+	// The player first, then the platforms in the order of the ring
+	saveObject(player);
+	for (int i = 0; i < platforms.Size(); i++) {
+		saveObject(platforms[i]);
 	}
-	
-	// Remove the platforms
-	for (auto& id : toRemove) {
-		gameObjects.erase(id);
-		gameState.platformCount--;
+}
+
+void GameManager::RestoreSnapshot(const GameSnapshot& snapshot, bool restoreTrack)
+{
+	gameState = snapshot.gameState;
+	GameEngine::PhysixEngine::SetTime(snapshot.physicsTime);
+	gameOver = false;
+
+	// The track goes on from the platforms spawned at the time of the snapshot
+	if (restoreTrack && (snapshot.trackSeed != track->GetSeed() || snapshot.trackPlatforms != track->GetTaken())) {
+		TrackPlacer placer;
+		placer.random = snapshot.trackRandom;
+		placer.nextSpawns = snapshot.trackSpawns;
+		track->Seek(snapshot.trackSeed, snapshot.trackPlatforms, placer);
 	}
 
-	// Update the nextPlatformSpawn in case it got too low
-	for (int i = 0; i < gameState.nextPlatformSpawn.size(); ++i) {
-		// A next platform z is too low if the distance between it's center and the player's center (on the Z axis) is greater than the despawn range 
-		if (gameState.nextPlatformSpawn[i] > gameObjects[0].getPosition().z - Constants::noSpawnRange) {
-			gameState.nextPlatformSpawn[i] = gameObjects[0].getPosition().z - 2 * Constants::noSpawnRange;
+	// The platforms are spawned again in the ring, the shadow map is drawn again under the track before and after
+	glm::vec2 invalidated(FLT_MAX, -FLT_MAX);
+	auto addToTrack = [&invalidated](float z) {
+		invalidated.x = std::min(invalidated.x, z - GameEngine::ObjectConstants::platformLength / 2);
+		invalidated.y = std::max(invalidated.y, z + GameEngine::ObjectConstants::platformLength / 2);
+	};
+	for (int i = 0; i < platforms.Size(); i++) {
+		addToTrack(platforms[i].getPosition().z);
+	}
+	platforms.Clear();
+
+	for (int i = 0; i < snapshot.objectCount; i++) {
+		GameEngine::GameObject* object = &player;
+		if (i > 0) {
+			platforms.Push(GameEngine::GameObject(Constants::platformTypes[(int)snapshot.colors[i]], snapshot.states[i].x, snapshot.ids[i]));
+			object = &platforms[platforms.Size() - 1];
+			addToTrack(snapshot.states[i].x.z);
 		}
+
+		object->setState(snapshot.states[i]);
+		object->setDistorted(snapshot.distortedTimes[i]);
+		object->isInJump = snapshot.inJump[i];
+	}
+
+	if (invalidated.x <= invalidated.y) {
+		shadowInvalidations.Add(invalidated);
+	}
+}
+
+void GameManager::PlatformManagement()
+{
+	// This function manages all the platforms, their spawning and removal
+	// The platforms are generated ahead on the workers, they are spawned once they are in sight
+	float playerZ = player.getPosition().z;
+
+	TrackPlatform next;
+	while (!platforms.IsFull() && track->Next(playerZ - Constants::viewDistance, next)) {
+		// Passed while the track was full
+		if (GameRules::IsPlatformBehind(next.position.z, playerZ)) continue;
+
+		// The slot of the platform is reused (with its collider)
+		platforms.Push(GameEngine::GameObject(Constants::platformTypes[(int)next.color], next.position));
+
+		// Only the part of the track under the new platform is drawn again in the shadow map
+		float z = next.position.z;
+		shadowInvalidations.Add(glm::vec2(z - GameEngine::ObjectConstants::platformLength / 2, z + GameEngine::ObjectConstants::platformLength / 2));
 	}
+
+	// Remove the platforms out of sight, the ring is ordered by Z so they are the first ones
+	while (platforms.Size() > 0 && GameRules::IsPlatformBehind(platforms[0].getPosition().z, playerZ)) {
+		platforms.Pop();
+	}
+
+	gameState.platformCount = platforms.Size();
 }
 
 void GameManager::OnInputUpdate(float deltaTime, int mods)
@@ -393,8 +760,6 @@ void GameManager::OnInputUpdate(float deltaTime, int mods)
 
 void GameManager::OnKeyPress(int key, int mods)
 {
-	float pSpeed = gameState.playerState.playerSpeed;
-
 	switch (key) {
 	case GLFW_KEY_C: {
 		// Change camera modes
@@ -402,33 +767,62 @@ void GameManager::OnKeyPress(int key, int mods)
 		gameState.cameraSettings.cameraRotation = glm::vec2(0);
 	} break;
 	case GLFW_KEY_W: {
-		if (!gameState.playerState.isFullSpeed) {
-			// Speed up
-			pSpeed += Constants::speedStep;
-			if (pSpeed > Constants::maxSpeed) {
-				pSpeed = Constants::maxSpeed;
-			}
-		}
+		// Speed up
+		GameRules::ChangeSpeed(gameState, 1);
 	} break;
 	case GLFW_KEY_S: {
-		if (!gameState.playerState.isFullSpeed) {
-			// Slow down
-			pSpeed -= Constants::speedStep;
-			if (pSpeed < Constants::minSpeed) {
-				pSpeed = Constants::minSpeed;
-			}
-		}
+		// Slow down
+		GameRules::ChangeSpeed(gameState, -1);
 	} break;
 	case GLFW_KEY_SPACE: {
 		// Jump
-		if (!gameObjects[0].isInJump) {
-			gameObjects[0].isInJump = true;
-			gameObjects[0].getRigidBody().state.v.y = 2.f;
+		if (!player.isInJump) {
+			player.isInJump = true;
+			player.getRigidBody().state.v.y = Constants::jumpSpeed;
 		}
 	} break;
+	case GLFW_KEY_1:
+	case GLFW_KEY_2:
+	case GLFW_KEY_3: {
+		// Toggle the post-processing passes (motion blur, bloom, tonemap)
+		unsigned int pass = 1 << (key - GLFW_KEY_1);
+		renderSettings.postProcessPasses ^= pass;
+	} break;
+	case GLFW_KEY_R: {
+		// Toggle the dynamic resolution
+		renderSettings.dynamicResolution = !renderSettings.dynamicResolution;
+		std::cout << "Dynamic resolution " << (renderSettings.dynamicResolution ? "on" : "off") << std::endl;
+	} break;
+	case GLFW_KEY_T: {
+		// Print the GPU time of the frame and of the post-processing passes (the render thread
+		// prints them with the next frame)
+		printStatistics = true;
+	} break;
+	case GLFW_KEY_P: {
+		// Toggle the depth pre-pass
+		renderSettings.depthPrepass = !renderSettings.depthPrepass;
+		std::cout << "Depth pre-pass " << (renderSettings.depthPrepass ? "on" : "off") << std::endl;
+	} break;
+	case GLFW_KEY_O: {
+		// Toggle the front to back order of the objects
+		renderSettings.sorting = !renderSettings.sorting;
+		std::cout << "Front to back sorting " << (renderSettings.sorting ? "on" : "off") << std::endl;
+	} break;
+	case GLFW_KEY_V: {
+		// Toggle the overdraw view
+		renderSettings.overdrawView = !renderSettings.overdrawView;
+	} break;
+	case GLFW_KEY_Q: {
+		// Toggle the occlusion culling of the distant objects
+		renderSettings.occlusionCulling = !renderSettings.occlusionCulling;
+		std::cout << "Occlusion culling " << (renderSettings.occlusionCulling ? "on" : "off") << std::endl;
+	} break;
+	case GLFW_KEY_B: {
+		// Toggle the recording of the lit pass in command buffers (on the workers)
+		renderSettings.commandBuffers = !renderSettings.commandBuffers;
+		std::cout << "Command buffers " << (renderSettings.commandBuffers ? "on" : "off") << std::endl;
+	} break;
 	}
-
-	gameState.playerState.playerSpeed = pSpeed;
 }
 
 void GameManager::OnKeyRelease(int key, int mods)
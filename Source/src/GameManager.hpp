@@ -1,25 +1,72 @@
 #pragma once
 
 #include <vector>
+#include <array>
 #include <iostream>
 #include <string>
 #include <chrono>
 #include <thread>
 #include <unordered_map>
 #include <list>
+#include <random>
 #include <conio.h>
 
 #include <Component/SimpleScene.h>
+#include <Core/GPU/FrameBuffer.h>
+#include <Core/GPU/FrameCapture.h>
+#include <Core/FrameArena.h>
+#include <include/triple_buffer.h>
 #include "GameEngine/GameObject.hpp"
+#include "GameEngine/ObjectRing.hpp"
 #include "GameEngine/Camera.hpp"
+#include "GameEngine/Noise.hpp"
+#include "GameEngine/Displacement.hpp"
+#include "GameEngine/Lighting.hpp"
+#include "GameEngine/PostProcess.hpp"
+#include "GameEngine/DynamicResolution.hpp"
+#include "GameEngine/SceneRenderer.hpp"
 
 namespace Skyroads {
+	class TrackGenerator;
+
 	namespace Constants {
 		const std::vector<std::string> platformTypes{ "platform_red", "platform_green", "platform_yellow", "platform_orange", "platform_purple", "platform_blue", "platform_white" };
-		const std::vector<std::string> shaderNames{ "Base", "UI", "Distorted" };
 		const std::vector<std::string> meshNames{ "box", "sphere" };
 
+		// The variants of the "Object" shader compiled when the game starts (the platforms, the UI,
+		// the player: normal, distorted and displaced, the same in the overdraw view, and the shadow
+		// maps). Every variant the frames use is here: the render thread and the jobs only look them
+		// up, a variant compiled there would be added to the shaders of the scene while they are read.
+		const std::vector<unsigned int> shaderVariants{
+			GameEngine::ShaderFeatures::LIT,
+			GameEngine::ShaderFeatures::UI,
+			GameEngine::ShaderFeatures::LIT | GameEngine::ShaderFeatures::NOISE | GameEngine::ShaderFeatures::NOISE_TEXTURE,
+			GameEngine::ShaderFeatures::LIT | GameEngine::ShaderFeatures::NOISE | GameEngine::ShaderFeatures::NOISE_TEXTURE | GameEngine::ShaderFeatures::DISTORTED,
+			GameEngine::ShaderFeatures::LIT | GameEngine::ShaderFeatures::NOISE | GameEngine::ShaderFeatures::NOISE_TEXTURE | GameEngine::ShaderFeatures::DISTORTED | GameEngine::ShaderFeatures::DISPLACED,
+			GameEngine::ShaderFeatures::LIT | GameEngine::ShaderFeatures::OVERDRAW,
+			GameEngine::ShaderFeatures::LIT | GameEngine::ShaderFeatures::NOISE | GameEngine::ShaderFeatures::NOISE_TEXTURE | GameEngine::ShaderFeatures::OVERDRAW,
+			GameEngine::ShaderFeatures::LIT | GameEngine::ShaderFeatures::NOISE | GameEngine::ShaderFeatures::NOISE_TEXTURE | GameEngine::ShaderFeatures::DISTORTED | GameEngine::ShaderFeatures::OVERDRAW,
+			GameEngine::ShaderFeatures::LIT | GameEngine::ShaderFeatures::NOISE | GameEngine::ShaderFeatures::NOISE_TEXTURE | GameEngine::ShaderFeatures::DISTORTED | GameEngine::ShaderFeatures::DISPLACED | GameEngine::ShaderFeatures::OVERDRAW,
+			GameEngine::ShaderFeatures::DEPTH_ONLY,
+			GameEngine::ShaderFeatures::DEPTH_ONLY | GameEngine::ShaderFeatures::NOISE | GameEngine::ShaderFeatures::NOISE_TEXTURE | GameEngine::ShaderFeatures::DISTORTED,
+			GameEngine::ShaderFeatures::DEPTH_ONLY | GameEngine::ShaderFeatures::NOISE | GameEngine::ShaderFeatures::NOISE_TEXTURE | GameEngine::ShaderFeatures::DISTORTED | GameEngine::ShaderFeatures::DISPLACED
+		};
+
+		// Number of distorted spheres drawn by each pass of the noise benchmark
+		const int noiseBenchmarkDraws = 100;
+
 		const glm::vec3 lightPositionOffset = glm::vec3(0., 2.75f, 0.);
+
+		// Point lights of the glowing platforms (spread along the platform) and of the player after a power-up
+		const int platformLights = 3;
+		const float platformLightHeight = 0.75f;
+		const float platformLightRadius = 6.f;
+		const float platformLightIntensity = 2.f;
+		const float powerLightRadius = 8.f;
+		const float powerLightIntensity = 4.f;
+
+		// The key light shining on the player comes from above, it is also the light casting the shadows
+		const glm::vec3 shadowLightDirection = glm::vec3(0, -1, 0);
 		const glm::vec3 playerStartingPosition = glm::vec3(0, 2.f, 25.f);
 
 		const std::vector<float> lanesX{ -3.5f, 0.f, 3.5f };
@@ -29,14 +76,20 @@ namespace Skyroads {
 		const float minSpeed = 0.0125f;
 		const float speedStep = 0.0125f;
 		const float lateralSpeed = 2.5f;	// Not continously applied
+		const float jumpSpeed = 2.f;
+		const float playerDrag = 10.f;		// Stops the lateral movement quickly
 
 		// Game Constants
 		const float forcedSpeedTime = 5;		// In seconds
 		const double powerAnimationTime = 2;	// In seconds
 		const float maxLives = 3;
-		const int maxPlatforms = 15;
 		const int minPlatformGap = 5;
 		const int maxPlatformGap = GameEngine::ObjectConstants::platformLength;
+		const float difficultyDistance = 3000.f;	// The gaps widen up to maxPlatformGap over this distance
+
+		// The track is spawned up to the far plane of the camera, at most "trackPlatforms" at once (a power of 2)
+		const float viewDistance = 200.f;
+		const int trackPlatforms = 32;
 		const int simplePlatPercent = 60;
 		const float noSpawnRange = 10.f;
 		const float outOfBoundY = -3.5f;
@@ -52,8 +105,21 @@ namespace Skyroads {
 		// Camera constants
 		const float minFov = 60.f;
 		const float maxFov = 90.f;
+
+		// The strength of the motion blur at full speed (it fades out towards the minimum speed)
+		const float motionBlurStrength = 1.f;
+
+		// Rewind constants, a snapshot of the game is kept every "rewindInterval" seconds
+		const int rewindSnapshots = 4;
+		const float rewindInterval = 1.f;
+
+		// The frames drawn before the allocations are checked (the assets and the shaders are ready, the arrays have grown)
+		const unsigned int allocationCheckWarmup = 300;
 	};
 
+	// The colors of the platforms, in the order of Constants::platformTypes
+	enum class PlatformColor : char { RED, GREEN, YELLOW, ORANGE, PURPLE, BLUE, WHITE };
+
 	// Defines variables used in the game logic
 	struct GameState {
 		struct CameraSettings {
@@ -70,46 +136,301 @@ namespace Skyroads {
 			float lives = 1;
 			float playerSpeed = 0.05f;
 			float oldPlayerSpeed = 0.05f;   // The speed of the player before the forced speed effect
+			glm::vec3 powerColor = glm::vec3(1);	// The color of the last power-up, the player glows with it while distorted
 		};
 		PlayerState playerState;
 
 		float points = 0.f;
-		std::vector<float> nextPlatformSpawn = {Constants::playerStartingPosition.z, Constants::playerStartingPosition.z + 1, Constants::playerStartingPosition.z };
+		double time = 0;		// The time the game has been running, in seconds
 		int platformCount = 0;
 	};
 
+	// The state of the simulation (the game state, the objects, the physics time and the track),
+	// saved and restored without allocating. The objects are kept in flat arrays, the player first,
+	// so copying a snapshot is a flat copy.
+	struct GameSnapshot {
+		static const int capacity = Constants::trackPlatforms + 1;
+
+		GameState gameState;
+		double physicsTime = 0;
+
+		// The track (its seed), the platforms spawned from it and the placement after them (TrackPlacer)
+		unsigned int trackSeed = 0;
+		unsigned long long trackPlatforms = 0;
+		std::minstd_rand trackRandom;
+		std::array<float, 3> trackSpawns = {};
+
+		int objectCount = 0;
+		long int ids[capacity];
+		PlatformColor colors[capacity];
+		GameEngine::State states[capacity];
+		double distortedTimes[capacity];
+		bool inJump[capacity];
+	};
+
+	// The renderer options toggled with the keys, applied by the render thread
+	struct RenderSettings {
+		unsigned int postProcessPasses = GameEngine::PostProcessPasses::ALL;
+		bool dynamicResolution = true;
+		bool depthPrepass = true;
+		bool sorting = true;
+		bool overdrawView = false;
+		bool occlusionCulling = true;
+		bool commandBuffers = true;
+	};
+
+	// The parts of the track ([zMin, zMax]) to draw again in the cached shadow map, in a fixed array so
+	// handing them to the render thread doesn't allocate. Once it is full, a part is merged into the
+	// last one (their union is drawn again).
+	struct ShadowInvalidations {
+		static const int capacity = 16;
+
+		glm::vec2 ranges[capacity];
+		int count = 0;
+
+		void Add(const glm::vec2& range)
+		{
+			if (count < capacity) {
+				ranges[count++] = range;
+				return;
+			}
+
+			glm::vec2& last = ranges[capacity - 1];
+			last = glm::vec2(glm::min(last.x, range.x), glm::max(last.y, range.y));
+		}
+	};
+
+	// Everything needed to draw a frame, copied from the game state at the end of its simulation.
+	// The render thread draws it while the next frame is simulated.
+	struct FrameSnapshot {
+		// Room for the player and a full track, so publishing a frame never grows it
+		FrameSnapshot() { objects.reserve(1 + Constants::trackPlatforms); }
+
+		// Copies of the game objects (with their colliders), the player first. The renderer reads
+		// their bounds while the originals move.
+		std::vector<GameEngine::GameObject> objects;
+
+		GameEngine::Camera camera;
+		glm::vec3 lightPosition = glm::vec3(0);
+		glm::vec3 powerColor = glm::vec3(1);
+		float motionStrength = 0;
+
+		// The UI
+		float fuel = 0;
+		int lives = 0;
+
+		// The parts of the track drawn again in the shadow map
+		ShadowInvalidations shadowInvalidations;
+
+		RenderSettings settings;
+		bool printStatistics = false;
+
+		// The heap allocations of the simulation of the frame (counted with COUNT_ALLOCATIONS)
+		unsigned long long simulationAllocations = 0;
+	};
+
 	class GameManager : public SimpleScene
 	{
 	public:
 		GameManager();
 		~GameManager();
 		void Init() override;
-		
-		void addGameObject(GameEngine::GameObject object);
 
 		/// <summary>
-		/// Get the game object with a specific id
+		/// Measure the GPU time of the vertex stage of the distorted player, with the analytic
+		/// noise and with the baked noise texture (the NOISE_TEXTURE variant). Started with
+		/// the "--bench-noise" argument, instead of running the game.
 		/// </summary>
-		/// <param name="id">The id of the game object</param>
-		/// <returns>The game object</returns>
-		GameEngine::GameObject* getGameObject(const long int id);
+		void BenchmarkNoise();
+
+		/// <summary>
+		/// Draw the frames in an off-screen frame buffer instead of the window (which can be hidden).
+		/// The frames are still copied to the window, in case it is visible.
+		/// </summary>
+		void EnableOffscreen();
+
+		/// <summary>
+		/// Record the frames, they are read back asynchronously and encoded on another thread
+		/// </summary>
+		/// <param name="path">The output directory</param>
+		/// <param name="format">One PNG per frame, or a single raw video file</param>
+		void StartCapture(const std::string& path, FrameCapture::Format format);
+
+		/// <summary>
+		/// Save the simulation in a snapshot, it doesn't allocate
+		/// </summary>
+		/// <param name="snapshot">The snapshot</param>
+		void SaveSnapshot(GameSnapshot& snapshot);
+
+		/// <summary>
+		/// Restore the simulation from a snapshot. The platforms are spawned again in the ring, in place
+		/// (with the same id).
+		/// </summary>
+		/// <param name="snapshot">The snapshot</param>
+		/// <param name="restoreTrack">False to keep the current track (already started by the caller)</param>
+		void RestoreSnapshot(const GameSnapshot& snapshot, bool restoreTrack = true);
+
+		/// <summary>
+		/// Stop the game after a number of frames (0 runs it until the window is closed)
+		/// </summary>
+		/// <param name="frames">The number of frames</param>
+		void SetFrameLimit(unsigned int frames);
+
+		/// <summary>
+		/// Check that the frames after the warm-up (Constants::allocationCheckWarmup) don't allocate:
+		/// the game stops at the first heap allocation of the process (counted with COUNT_ALLOCATIONS)
+		/// </summary>
+		void EnableAllocationCheck();
+
+		/// <summary>
+		/// Check if a frame allocated, with the allocation check
+		/// </summary>
+		bool AllocationCheckFailed() const;
 
 	private:
+		GameEngine::GameObject player;
+
 		/// <summary>
-		/// A map of all the gameobjects, using the object id as a key
+		/// The platforms on the track, from the one closest to the player (the first one removed)
+		/// to the farthest one (the last one spawned)
 		/// </summary>
-		std::unordered_map<long int, GameEngine::GameObject> gameObjects;
+		GameEngine::ObjectRing<Constants::trackPlatforms> platforms;
 
 		GameEngine::Camera* camera;
 		GameState gameState;
 
-		void LoadShader(std::string name);
+		/// <summary>
+		/// Picks the seeds of the tracks (rand is seeded when the program starts)
+		/// </summary>
+		std::minstd_rand random;
+
+		/// <summary>
+		/// Generates the track ahead of the player on the workers
+		/// </summary>
+		TrackGenerator* track;
+
+		/// <summary>
+		/// Set when the game is lost, it ends at the end of the frame
+		/// </summary>
+		bool gameOver;
+
+		/// <summary>
+		/// The game when it starts, and a snapshot every Constants::rewindInterval seconds (a ring,
+		/// historyCount are valid, the oldest one at historyStart)
+		/// </summary>
+		GameSnapshot startSnapshot;
+		std::vector<GameSnapshot> history;
+		int historyStart;
+		int historyCount;
+		double nextHistoryTime;
+
+		/// <summary>
+		/// The displaced vertices of the player sphere, computed once per frame while it is distorted
+		/// </summary>
+		GameEngine::Displacement playerDisplacement;
+
+		/// <summary>
+		/// The variants of the shader used by the game objects
+		/// </summary>
+		ShaderVariants* objectShaders;
+
+		/// <summary>
+		/// The point lights, binned in the clusters of the camera every frame
+		/// </summary>
+		GameEngine::ClusteredLighting lighting;
+
+		/// <summary>
+		/// The shadows of the key light: the platforms are cached, the player is drawn every frame
+		/// </summary>
+		GameEngine::ShadowMaps shadowMaps;
+
+		/// <summary>
+		/// The passes applied to the scene before it is shown (motion blur, bloom and tonemap)
+		/// </summary>
+		GameEngine::PostProcess postProcess;
+
+		/// <summary>
+		/// Scales the resolution of the scene to keep the GPU time of the frames under budget
+		/// </summary>
+		GameEngine::DynamicResolution dynamicResolution;
+
+		/// <summary>
+		/// Draws the game objects front to back, after a depth pre-pass
+		/// </summary>
+		GameEngine::SceneRenderer sceneRenderer;
+
+		/// <summary>
+		/// The frames simulated on the main thread and drawn on the render thread
+		/// </summary>
+		TripleBuffer<FrameSnapshot> snapshots;
+
+		/// <summary>
+		/// The renderer options, the statistics requested with the "T" key and the parts of the shadow
+		/// map to draw again, handed to the render thread with the next snapshot
+		/// </summary>
+		RenderSettings renderSettings;
+		bool printStatistics;
+		ShadowInvalidations shadowInvalidations;
+
+		/// <summary>
+		/// The memory of the short-lived arrays of a frame: one for the simulation (reset when it
+		/// starts, on the main thread) and one for the drawing (reset in FrameStart, on the render thread)
+		/// </summary>
+		FrameArena simulationArena;
+		FrameArena frameArena;
+
+		/// <summary>
+		/// The heap allocations of the simulation of the last frame, and of the render thread between
+		/// the last two FrameStart (with the count at the last one)
+		/// </summary>
+		unsigned long long simulationAllocations;
+		unsigned long long frameAllocations;
+		unsigned long long frameStartAllocations;
+
+		/// <summary>
+		/// The allocation check: the heap allocations of the whole process (the workers too) at the last
+		/// FrameStart, the frames drawn since it started, and if a frame allocated
+		/// </summary>
+		bool checkAllocations;
+		unsigned long long processStartAllocations;
+		unsigned int checkedFrames;
+		std::atomic<bool> allocationCheckFailed;
+
+		/// <summary>
+		/// The off-screen target of the frames (when enabled) and the recording of the frames
+		/// </summary>
+		bool offscreen;
+		FrameBuffer offscreenTarget;
+		FrameCapture capture;
+		unsigned int frameLimit;
+		unsigned int frameCount;
+
 		void LoadMesh(std::string name);
 
+		/// <summary>
+		/// Update the game (on the main thread) and publish the snapshot of the frame
+		/// </summary>
+		void Simulate(float deltaTimeSeconds) override;
+
+		/// <summary>
+		/// Take the newest snapshot, the next three methods draw it (on the render thread)
+		/// </summary>
+		bool AcquireFrame() override;
+
 		void FrameStart() override;
 		void Update(float deltaTimeSeconds) override;
 		void FrameEnd() override;
 
+		/// <summary>
+		/// Copy the state of the frame in the write buffer of the snapshots, and publish it
+		/// </summary>
+		void PublishFrame();
+
+		/// <summary>
+		/// Apply the renderer options of the snapshot, and print the statistics it asks for
+		/// </summary>
+		void ApplyRenderSettings(const FrameSnapshot& frame);
+
 		/// <summary>
 		/// Update the camera data
 		/// </summary>
@@ -125,16 +446,21 @@ namespace Skyroads {
 		/// </summary>
 		void UpdateGameState(const float deltaTime);
 
+		/// <summary>
+		/// Add the point lights of the frame (the glowing platforms and the power-up light of the player)
+		/// </summary>
+		void CollectLights(const FrameSnapshot& frame);
+
 		/// <summary>
 		/// Render the UI
 		/// </summary>
-		void RenderUI();
+		void RenderUI(const FrameSnapshot& frame);
 
 		/// <summary>
 		/// Check collisions and update the game state
 		/// </summary>
-		/// <param name="collided">A vector with the id's of the collided objects</param>
-		void CheckCollisions(std::vector<int> collided);
+		/// <param name="collided">The id's of the collided objects</param>
+		void CheckCollisions(Span<int> collided);
 
 		/// <summary>
 		/// Compute the score
@@ -142,10 +468,26 @@ namespace Skyroads {
 		void ComputeScore();
 
 		/// <summary>
-		/// Function that handles the game end
+		/// Function that handles the game end: the game can be played again, from the start
+		/// or from a few seconds before, or the program exits
 		/// </summary>
 		void GameOver();
 
+		/// <summary>
+		/// Start the game again, on a new track
+		/// </summary>
+		void Restart();
+
+		/// <summary>
+		/// Go back to the oldest snapshot of the history (a few seconds before)
+		/// </summary>
+		void Rewind();
+
+		/// <summary>
+		/// Save a snapshot in the history, every Constants::rewindInterval seconds
+		/// </summary>
+		void RecordHistory();
+
 		/// <summary>
 		/// Spawn/Remove platforms from the game
 		/// </summary>
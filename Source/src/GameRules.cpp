@@ -0,0 +1,154 @@
+#include "GameRules.hpp"
+
+#include <math.h>
+#include <algorithm>
+
+double Skyroads::mapBetweenRanges(double sourceNumber, double fromA, double fromB, double toA, double toB, int decimalPrecision) {
+	double deltaA = fromB - fromA;
+	double deltaB = toB - toA;
+	double scale = deltaB / deltaA;
+	double negA = -1 * fromA;
+	double offset = (negA * scale) + toA;
+	double finalNumber = (sourceNumber * scale) + offset;
+	int calcScale = (int)pow(10, decimalPrecision);
+	return (double)round(finalNumber * calcScale) / calcScale;
+}
+
+int Skyroads::GameRules::ChooseSpawnLane(const std::array<float, 3>& nextSpawns)
+{
+	auto& nps = nextSpawns;
+	return (int)(std::max_element(nps.begin(), nps.end()) - nps.begin()); // Max because the z is in descending order
+}
+
+Skyroads::PlatformColor Skyroads::GameRules::ChoosePlatformColor(int roll)
+{
+	int platType = roll % 100;
+
+	if (platType < Constants::simplePlatPercent) {
+		// Simple platform
+		return PlatformColor::BLUE;
+	}
+
+	// Effect platform
+	platType = (int)mapBetweenRanges(platType, Constants::simplePlatPercent, 100, 0, 9, 1);
+
+	if (platType < 1) {
+		// Red platform - very few
+		return PlatformColor::RED;
+	}
+	else if (platType < 4) {
+		// Yellow platform - some
+		return PlatformColor::YELLOW;
+	}
+	else if (platType < 6) {
+		// Green platform - few
+		return PlatformColor::GREEN;
+	}
+	else if (platType < 8) {
+		// Orange platform - few
+		return PlatformColor::ORANGE;
+	}
+
+	// White platform - very few
+	return PlatformColor::WHITE;
+}
+
+int Skyroads::GameRules::ChoosePlatformGap(int roll, float z)
+{
+	// Half of the gaps are possible at the start, all of them at the difficulty distance
+	float difficulty = std::min(abs(z - Constants::playerStartingPosition.z) / Constants::difficultyDistance, 1.f);
+	int gapRange = (int)((Constants::maxPlatformGap - Constants::minPlatformGap) * (0.5f + 0.5f * difficulty));
+
+	return roll % std::max(gapRange, 1) + Constants::minPlatformGap;
+}
+
+bool Skyroads::GameRules::IsPlatformBehind(float platformZ, float playerZ)
+{
+	return platformZ > playerZ + GameEngine::ObjectConstants::platformLength / 2 + Constants::noSpawnRange;
+}
+
+void Skyroads::GameRules::ChangeSpeed(GameState& state, int steps)
+{
+	if (state.playerState.isFullSpeed) return;
+
+	float pSpeed = state.playerState.playerSpeed + steps * Constants::speedStep;
+	if (pSpeed > Constants::maxSpeed) {
+		pSpeed = Constants::maxSpeed;
+	}
+	if (pSpeed < Constants::minSpeed) {
+		pSpeed = Constants::minSpeed;
+	}
+	state.playerState.playerSpeed = pSpeed;
+}
+
+bool Skyroads::GameRules::UpdateFuel(GameState& state, const float deltaTime)
+{
+	float speedFuelFactor = (float)mapBetweenRanges(state.playerState.playerSpeed, Constants::minSpeed, Constants::maxSpeed, 0.5, 1.5, 1);
+	state.playerState.fuel -= deltaTime * Constants::fuelFlow * speedFuelFactor;
+	if (state.playerState.fuel <= 0) {
+		// If all the fuel was used, a life is lost. If the game can go on
+		// (at least 1 life remaining), reset the fuel to max
+
+		state.playerState.lives--;
+		if (state.playerState.lives > 0) {
+			state.playerState.fuel = Constants::maxFuel;
+		}
+	}
+
+	return state.playerState.lives > 0;
+}
+
+void Skyroads::GameRules::UpdateForcedSpeed(GameState& state)
+{
+	if (state.playerState.isFullSpeed && state.time - state.playerState.forcedSpeedStart >= Constants::forcedSpeedTime) {
+		state.playerState.isFullSpeed = false;
+		state.playerState.playerSpeed = state.playerState.oldPlayerSpeed;
+	}
+}
+
+bool Skyroads::GameRules::ApplyPlatform(GameState& state, PlatformColor color, double& distortedTime)
+{
+	switch (color) {
+	case PlatformColor::RED: {
+		// Instant Loss
+		return false;
+	}
+	case PlatformColor::YELLOW: {
+		// Lose fuel
+		state.playerState.fuel -= Constants::fuelLoss;
+		distortedTime = Constants::powerAnimationTime;
+	} break;
+	case PlatformColor::ORANGE: {
+		// Speed up
+		state.playerState.isFullSpeed = true;
+		state.playerState.forcedSpeedStart = state.time;
+		state.playerState.oldPlayerSpeed = state.playerState.playerSpeed;
+		state.playerState.playerSpeed = Constants::maxSpeed;
+		distortedTime = Constants::forcedSpeedTime;
+	} break;
+	case PlatformColor::GREEN: {
+		// Gain fuel
+		state.playerState.fuel += Constants::fuelGain;
+		distortedTime = Constants::powerAnimationTime;
+		if (state.playerState.fuel > Constants::maxFuel) {
+			state.playerState.fuel = Constants::maxFuel;
+		}
+	} break;
+	case PlatformColor::WHITE: {
+		if (state.playerState.lives < Constants::maxLives) {
+			// Gain life
+			state.playerState.lives += 1;
+			distortedTime = Constants::powerAnimationTime;
+		}
+	} break;
+	default:
+		break;
+	}
+
+	return true;
+}
+
+void Skyroads::GameRules::ComputeScore(GameState& state, float playerZ)
+{
+	state.points = abs(playerZ - Constants::playerStartingPosition.z);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "GameManager.hpp"
+
+namespace Skyroads {
+	/// <summary>
+	/// Map a value that is in a range to another range
+	/// </summary>
+	/// <param name="sourceNumber">The value</param>
+	/// <param name="fromA">Starting value of the first range</param>
+	/// <param name="fromB">End value of the first range</param>
+	/// <param name="toA">Starting value of the second range</param>
+	/// <param name="toB">End value of the second range</param>
+	/// <param name="decimalPrecision">The number of decimals to use</param>
+	/// <returns>The mapped value</returns>
+	double mapBetweenRanges(double sourceNumber, double fromA, double fromB, double toA, double toB, int decimalPrecision);
+
+	/// <summary>
+	/// The rules of the game, shared by the game and by the headless environments (SkyroadsEnv).
+	/// They only change the game state: the caller moves the objects and draws the random numbers.
+	/// </summary>
+	namespace GameRules {
+		/// <summary>
+		/// Get the lane that hasn't spawned a platform in the longest time
+		/// </summary>
+		/// <param name="nextSpawns">The Z of the next platform of each lane</param>
+		/// <returns>The index of the lane</returns>
+		int ChooseSpawnLane(const std::array<float, 3>& nextSpawns);
+
+		/// <summary>
+		/// Get the color of a new platform (most of them are simple blue ones)
+		/// </summary>
+		/// <param name="roll">A random number</param>
+		/// <returns>The color</returns>
+		PlatformColor ChoosePlatformColor(int roll);
+
+		/// <summary>
+		/// Get the gap after a platform. The gaps widen with the distance, up to Constants::maxPlatformGap
+		/// at Constants::difficultyDistance from the start.
+		/// </summary>
+		/// <param name="roll">A random number</param>
+		/// <param name="z">The Z of the platform</param>
+		/// <returns>The gap</returns>
+		int ChoosePlatformGap(int roll, float z);
+
+		/// <summary>
+		/// Check if a platform is far enough behind the player to be removed
+		/// </summary>
+		/// <param name="platformZ">The Z of the center of the platform</param>
+		/// <param name="playerZ">The Z of the player</param>
+		/// <returns>If it should be removed</returns>
+		bool IsPlatformBehind(float platformZ, float playerZ);
+
+		/// <summary>
+		/// Change the speed of the player (it can't while the speed is forced)
+		/// </summary>
+		/// <param name="state">The game state</param>
+		/// <param name="steps">The number of speed steps to add (negative to slow down)</param>
+		void ChangeSpeed(GameState& state, int steps);
+
+		/// <summary>
+		/// Burn the fuel of the frame, a life is lost when the tank is empty
+		/// </summary>
+		/// <param name="state">The game state</param>
+		/// <param name="deltaTime">The time of the frame</param>
+		/// <returns>False if all the lives are lost</returns>
+		bool UpdateFuel(GameState& state, const float deltaTime);
+
+		/// <summary>
+		/// End the forced speed once its time is up
+		/// </summary>
+		/// <param name="state">The game state</param>
+		void UpdateForcedSpeed(GameState& state);
+
+		/// <summary>
+		/// Apply the effect of a platform the player landed on
+		/// </summary>
+		/// <param name="state">The game state</param>
+		/// <param name="color">The color of the platform (it turns purple after)</param>
+		/// <param name="distortedTime">Set to how long the player is distorted, if the effect did something</param>
+		/// <returns>False if the platform ends the game</returns>
+		bool ApplyPlatform(GameState& state, PlatformColor color, double& distortedTime);
+
+		/// <summary>
+		/// Compute the score, the distance traveled by the player
+		/// </summary>
+		/// <param name="state">The game state</param>
+		/// <param name="playerZ">The Z of the player</param>
+		void ComputeScore(GameState& state, float playerZ);
+	}
+}
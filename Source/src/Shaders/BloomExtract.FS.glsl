@@ -0,0 +1,30 @@
+#version 330
+
+// Keeps the parts of the scene brighter than the threshold, while downsampling it
+// (see GameEngine::PostProcess)
+
+in vec2 tex_coord;
+
+uniform sampler2D u_texture_0;	// The scene (HDR)
+
+// The size of a texel of the scene
+uniform vec2 source_texel;
+uniform float bloom_threshold;
+
+layout(location = 0) out vec4 out_color;
+
+void main()
+{
+	// 4 bilinear taps, they average the 4x4 texels under a texel of the target
+	vec3 colour = vec3(0);
+	colour += texture(u_texture_0, tex_coord + source_texel * vec2(-1, -1)).rgb;
+	colour += texture(u_texture_0, tex_coord + source_texel * vec2( 1, -1)).rgb;
+	colour += texture(u_texture_0, tex_coord + source_texel * vec2(-1,  1)).rgb;
+	colour += texture(u_texture_0, tex_coord + source_texel * vec2( 1,  1)).rgb;
+	colour *= 0.25;
+
+	float luminance = dot(colour, vec3(0.2126, 0.7152, 0.0722));
+	colour *= max(luminance - bloom_threshold, 0.0) / max(luminance, 1e-4);
+
+	out_color = vec4(colour, 1.0);
+}
@@ -0,0 +1,27 @@
+#version 330
+
+// One direction of a separable 9 tap gaussian blur, in 5 bilinear taps (see GameEngine::PostProcess)
+
+in vec2 tex_coord;
+
+uniform sampler2D u_texture_0;
+
+// The size of a texel along the blurred axis (the other component is 0)
+uniform vec2 direction;
+
+layout(location = 0) out vec4 out_color;
+
+const float offsets[3] = float[](0.0, 1.3846153846, 3.2307692308);
+const float weights[3] = float[](0.2270270270, 0.3162162162, 0.0702702703);
+
+void main()
+{
+	vec3 colour = texture(u_texture_0, tex_coord).rgb * weights[0];
+	for (int i = 1; i < 3; i++)
+	{
+		colour += texture(u_texture_0, tex_coord + direction * offsets[i]).rgb * weights[i];
+		colour += texture(u_texture_0, tex_coord - direction * offsets[i]).rgb * weights[i];
+	}
+
+	out_color = vec4(colour, 1.0);
+}
@@ -0,0 +1,97 @@
+#version 330
+
+// Combines the post-processing passes and tonemaps the scene (see GameEngine::PostProcess)
+
+in vec2 tex_coord;
+
+uniform sampler2D u_texture_0;	// The scene (HDR)
+uniform sampler2D u_texture_1;	// The depth of the scene
+uniform sampler2D u_texture_2;	// The motion blur (reduced resolution, a - linear depth)
+uniform sampler2D u_texture_3;	// The bloom (reduced resolution)
+
+// The enabled passes (GameEngine::PostProcessPasses)
+uniform int passes;
+
+#define MOTION_BLUR	1
+#define BLOOM		2
+#define TONEMAP		4
+
+uniform mat4 inverse_view_projection;
+uniform mat4 previous_view_projection;
+uniform mat4 inverse_projection;
+uniform float motion_strength;
+
+// The size of a texel of the motion blur target
+uniform vec2 motion_texel;
+// The motion (in texture coordinates) from which the blurred image fully replaces the scene
+uniform float motion_blend;
+
+uniform float bloom_intensity;
+uniform float exposure;
+
+layout(location = 0) out vec4 out_color;
+
+float linear_depth(vec2 uv, float depth)
+{
+	vec4 P = inverse_projection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+	return -P.z / P.w;
+}
+
+// Joint bilateral upsampling: the 4 texels around the pixel are weighted by their distance, and
+// by how close their depth is to the depth of the pixel, so the blur doesn't leak across edges
+vec3 upsample_motion_blur(float depth)
+{
+	vec2 position = tex_coord / motion_texel - 0.5;
+	vec2 base = floor(position);
+	vec2 f = position - base;
+
+	vec3 colour = vec3(0);
+	float total = 0.0;
+	for (int i = 0; i < 4; i++)
+	{
+		vec2 offset = vec2(i & 1, i >> 1);
+		vec4 texel = texture(u_texture_2, (base + offset + 0.5) * motion_texel);
+
+		vec2 bilinear = mix(1.0 - f, f, offset);
+		float weight = bilinear.x * bilinear.y / (1e-3 + abs(texel.a - depth) / depth);
+
+		colour += texel.rgb * weight;
+		total += weight;
+	}
+
+	return colour / max(total, 1e-6);
+}
+
+// ACES filmic curve (fit by Krzysztof Narkowicz)
+vec3 tonemap(vec3 x)
+{
+	return clamp((x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14), 0.0, 1.0);
+}
+
+void main()
+{
+	vec3 colour = texture(u_texture_0, tex_coord).rgb;
+
+	if ((passes & MOTION_BLUR) != 0 && motion_strength > 0.0)
+	{
+		float depth = texture(u_texture_1, tex_coord).r;
+
+		// The still parts of the image keep the full resolution scene
+		vec4 world = inverse_view_projection * vec4(vec3(tex_coord, depth) * 2.0 - 1.0, 1.0);
+		vec4 previous = previous_view_projection * vec4(world.xyz / world.w, 1.0);
+		vec2 motion = (tex_coord - (previous.xy / previous.w * 0.5 + 0.5)) * motion_strength;
+		float blend = clamp(length(motion) / motion_blend, 0.0, 1.0);
+
+		if (blend > 0.0)
+			colour = mix(colour, upsample_motion_blur(linear_depth(tex_coord, depth)), blend);
+	}
+
+	if ((passes & BLOOM) != 0)
+		colour += texture(u_texture_3, tex_coord).rgb * bloom_intensity;
+
+	colour *= exposure;
+	if ((passes & TONEMAP) != 0)
+		colour = tonemap(colour);
+
+	out_color = vec4(colour, 1.0);
+}
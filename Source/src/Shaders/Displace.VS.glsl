@@ -0,0 +1,45 @@
+#version 330
+
+layout(location = 0) in vec3 v_position;
+layout(location = 1) in vec3 v_normal;
+
+uniform float time;
+
+// Captured with transform feedback, one per vertex of the mesh
+// xyz - the displaced position (object space), w - the noise used by the lighting
+out vec4 displaced;
+
+// Periodic Perlin noise, baked on the CPU (see GameEngine::Noise)
+// The texture holds a single period of the noise, divided by 2.2 to fit a normalized format
+#define NOISE_PERIOD 10.0
+uniform sampler3D u_texture_1;
+
+float pnoise(vec3 P)
+{
+  return 2.2 * texture(u_texture_1, P / NOISE_PERIOD).r;
+}
+
+float turbulence( vec3 p ) {
+  float w = 100.0;
+  float t = -.5;
+
+  for (float f = 1.0 ; f <= 10.0 ; f++ ){
+    float power = pow( 2.0, f );
+    t += abs( pnoise( vec3( power * p ) ) / power );
+  }
+
+  return t;
+}
+
+void main()
+{
+	float adjustedTime = time / 10;
+	float noise = 10.0 *  -.10 * turbulence( .5 * v_normal +  adjustedTime);
+
+	// The analytic version uses a period of 100 here, the baked noise repeats every 10 units
+	float b = pnoise( 0.05 * v_position + vec3( 2.0 * adjustedTime ) );
+	float displacement = noise / 2.5 + b / 12.f;
+
+	// move the position along the normal
+	displaced = vec4(v_position + v_normal * displacement, noise);
+}
\ No newline at end of file
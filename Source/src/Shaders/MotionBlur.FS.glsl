@@ -0,0 +1,52 @@
+#version 330
+
+// Camera motion blur, drawn at a reduced resolution (see GameEngine::PostProcess)
+// The previous position of a pixel is found by reprojecting its depth with the view-projection
+// matrix of the previous frame, and the scene is averaged along the way.
+
+in vec2 tex_coord;
+
+uniform sampler2D u_texture_0;	// The scene (HDR)
+uniform sampler2D u_texture_1;	// The depth of the scene
+
+uniform mat4 inverse_view_projection;
+uniform mat4 previous_view_projection;
+uniform mat4 inverse_projection;
+
+// Scales the motion of a frame (0 - no blur), and the longest blur (in texture coordinates)
+uniform float motion_strength;
+uniform float max_motion;
+
+layout(location = 0) out vec4 out_color;
+
+#define SAMPLES 8
+
+// The distance along the view axis, used by the bilateral upsampling
+float linear_depth(vec2 uv, float depth)
+{
+	vec4 P = inverse_projection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+	return -P.z / P.w;
+}
+
+void main()
+{
+	float depth = texture(u_texture_1, tex_coord).r;
+
+	vec4 world = inverse_view_projection * vec4(vec3(tex_coord, depth) * 2.0 - 1.0, 1.0);
+	vec4 previous = previous_view_projection * vec4(world.xyz / world.w, 1.0);
+	vec2 motion = (tex_coord - (previous.xy / previous.w * 0.5 + 0.5)) * motion_strength;
+
+	float len = length(motion);
+	if (len > max_motion)
+		motion *= max_motion / len;
+
+	// Centered on the pixel, so the blur doesn't shift the image
+	vec3 colour = vec3(0);
+	for (int i = 0; i < SAMPLES; i++)
+	{
+		float t = float(i) / float(SAMPLES - 1) - 0.5;
+		colour += texture(u_texture_0, tex_coord + motion * t).rgb;
+	}
+
+	out_color = vec4(colour / float(SAMPLES), linear_depth(tex_coord, depth));
+}
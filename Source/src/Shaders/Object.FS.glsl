@@ -0,0 +1,166 @@
+#version 330
+
+// Feature flags, see Object.VS.glsl
+
+#ifdef LIT
+in vec3 world_position;
+in vec3 world_normal;
+
+// Uniforms for light properties
+uniform vec3 light_position;
+uniform vec3 eye_position;
+
+uniform float material_kd;
+uniform float material_ks;
+uniform float material_shininess;
+uniform float material_emission;
+
+// Clustered point lights (see GameEngine::ClusteredLighting)
+in float view_depth;
+
+// 2 texels per light: xyz - position, w - radius and rgb - color * intensity
+uniform samplerBuffer u_lights;
+// For each cluster: offset << 8 | count, in u_light_indices
+uniform usamplerBuffer u_light_grid;
+uniform usamplerBuffer u_light_indices;
+
+// xy - clusters per pixel, z - depth scale, w - depth bias (slice = log(depth) * z + w)
+uniform vec4 light_grid;
+uniform ivec3 light_clusters;
+
+// Shadows of the key light (see GameEngine::ShadowMaps)
+// The static map holds the platforms and wraps along the world Z axis, the dynamic one holds
+// the player and follows it. Both matrices map the world position to (u, v, depth).
+uniform sampler2DShadow u_shadow_static;
+uniform sampler2DShadow u_shadow_dynamic;
+uniform mat4 shadow_static_matrix;
+uniform mat4 shadow_dynamic_matrix;
+uniform float shadow_bias;
+#endif
+
+#ifdef NOISE
+in float noise;
+#endif
+
+#ifdef TEXTURED
+in vec2 texture_coord;
+
+// The small textures are layers of the texture array, the others are bound on unit 0
+uniform sampler2DArray u_texture_array;
+uniform sampler2D u_texture_0;
+uniform int texture_layer;
+#endif
+
+uniform vec3 object_color;
+
+layout(location = 0) out vec4 out_color;
+
+#ifdef LIT
+// 1 if the point is lit by the key light, 0 if it is in shadow
+float shadow_visibility(vec3 P)
+{
+	vec3 S = (shadow_static_matrix * vec4(P, 1)).xyz;
+	float visibility = texture(u_shadow_static, vec3(S.xy, S.z - shadow_bias));
+
+	// The dynamic map only covers the area around the player
+	vec3 D = (shadow_dynamic_matrix * vec4(P, 1)).xyz;
+	if (all(greaterThanEqual(D.xy, vec2(0))) && all(lessThanEqual(D.xy, vec2(1))))
+		visibility = min(visibility, texture(u_shadow_dynamic, vec3(D.xy, D.z - shadow_bias)));
+
+	return visibility;
+}
+#endif
+
+#ifdef NOISE
+float random( vec3 scale, float seed ){
+  return fract( sin( dot( gl_FragCoord.xyz + seed, scale ) ) * 43758.5453 + seed ) ;
+}
+#endif
+
+void main()
+{
+#ifndef DEPTH_ONLY
+	vec3 colour = object_color;
+
+#ifdef TEXTURED
+	if (texture_layer >= 0)
+		colour *= texture(u_texture_array, vec3(texture_coord, texture_layer)).rgb;
+	else
+		colour *= texture(u_texture_0, texture_coord).rgb;
+#endif
+
+#ifdef LIT
+	vec3 N = normalize(world_normal);
+	vec3 L = normalize(light_position - world_position);
+	vec3 V = normalize(eye_position - world_position);
+	vec3 H = normalize(L + V);
+
+	// Define ambient light component
+	float ambient_light = 0.25f;
+
+	// Compute diffuse light component
+	float diffuse_light = material_kd * max(dot(N, L), 0.f);
+
+	// Compute specular light component
+	float specular_light = 0.f;
+
+	if (diffuse_light > 0.f)
+	{
+		specular_light = material_ks * pow(max(dot(N, H), 0.), material_shininess);
+	}
+
+	// The point lights of the cluster holding the fragment
+	ivec3 cluster = ivec3(gl_FragCoord.xy * light_grid.xy, log(max(view_depth, 1e-4)) * light_grid.z + light_grid.w);
+	cluster = clamp(cluster, ivec3(0), light_clusters - 1);
+	uint cell = texelFetch(u_light_grid, (cluster.z * light_clusters.y + cluster.y) * light_clusters.x + cluster.x).r;
+	int offset = int(cell >> 8u);
+	int count = int(cell & 0xFFu);
+
+	vec3 point_light = vec3(0);
+	for (int i = 0; i < count; i++)
+	{
+		int light = int(texelFetch(u_light_indices, offset + i).r);
+		vec4 position_radius = texelFetch(u_lights, light * 2);
+		vec3 light_color = texelFetch(u_lights, light * 2 + 1).rgb;
+
+		vec3 to_light = position_radius.xyz - world_position;
+		float d = length(to_light);
+		vec3 PL = to_light / max(d, 1e-4);
+
+		// Inverse square falloff, windowed to reach 0 at the radius
+		float window = clamp(1.0 - pow(d / position_radius.w, 4.0), 0.0, 1.0);
+		float attenuation = window * window / (d * d + 1.0);
+
+		float point_diffuse = material_kd * max(dot(N, PL), 0.f);
+		float point_specular = 0.f;
+		if (point_diffuse > 0.f)
+		{
+			point_specular = material_ks * pow(max(dot(N, normalize(PL + V)), 0.), material_shininess);
+		}
+
+		point_light += light_color * attenuation * (point_diffuse + point_specular);
+	}
+
+	float visibility = shadow_visibility(world_position);
+
+	colour *= ambient_light + visibility * (diffuse_light + specular_light) + material_emission + point_light;
+#endif
+
+#ifdef NOISE
+	// Vary the intensity of the "light" using the noise
+	float r = .01 * random( vec3( 12.9898, 78.233, 151.7182 ), 0.0 );
+	float intensity = 1.3 * noise + r;
+	#ifdef DISTORTED
+	intensity *= 3.3f;
+	#endif
+	colour *= intensity;
+#endif
+
+	out_color = vec4(colour, 1.f);
+
+#ifdef OVERDRAW
+	// Added up by the blending, the brighter the more fragments were shaded on the pixel
+	out_color = vec4(0.25, 0.1, 0.04, 1.0);
+#endif
+#endif
+}
\ No newline at end of file
@@ -1,25 +1,74 @@
 #version 330
 
+// Feature flags (defined by ShaderVariants, see GameEngine::ShaderFeatures)
+// LIT           - Phong lighting, needs the world position and normal
+// UI            - the position is already in clip space (no View / Projection)
+// NOISE         - animated noise, varies the light intensity
+// NOISE_TEXTURE - sample the baked noise (GameEngine::Noise) instead of computing it
+// DISTORTED     - displace the vertices using the noise
+// DISPLACED     - the displaced vertices were computed earlier in the frame (Displace shader)
+// INSTANCED     - the model matrix is a per instance attribute
+// TEXTURED      - multiply the color by the material texture
+// DEPTH_ONLY    - only the depth is written (shadow maps, depth pre-pass)
+// OVERDRAW      - every fragment adds a constant color (overdraw view)
+
 layout(location = 0) in vec3 v_position;
 layout(location = 1) in vec3 v_normal;
 layout(location = 2) in vec2 v_texture_coord;
 layout(location = 3) in vec3 v_color;
 
+#ifdef DISPLACED
+// xyz - the displaced position (object space), w - the noise
+layout(location = 4) in vec4 v_displaced;
+#endif
+
 // Uniform properties
+#ifdef INSTANCED
+layout(location = 5) in mat4 v_model;
+#else
 uniform mat4 Model;
+#endif
+
+#ifndef UI
 uniform mat4 View;
 uniform mat4 Projection;
-
-uniform float time;
-uniform bool is_distorted;
-uniform vec3 object_color;
+#endif
 
 // Output values to fragment shader
+#ifdef LIT
 out vec3 world_position;
 out vec3 world_normal;
-out vec3 frag_color;
+out float view_depth;
+#endif
+
+#ifdef NOISE
 out float noise;
+#endif
+
+#ifdef TEXTURED
+out vec2 texture_coord;
+#endif
+
+// The depth pre-pass (DEPTH_ONLY) and the color pass must compute the exact same depth
+invariant gl_Position;
+
+#if defined(NOISE) && !defined(DISPLACED)
+uniform float time;
+
+#ifdef NOISE_TEXTURE
+// Periodic Perlin noise, baked on the CPU (see GameEngine::Noise)
+// The texture holds a single period of the noise, divided by 2.2 to fit a normalized format
+// The period of the baked noise is always 10, the one given to PNOISE is ignored
+#define NOISE_PERIOD 10.0
+uniform sampler3D u_texture_1;
+
+float pnoise(vec3 P)
+{
+  return 2.2 * texture(u_texture_1, P / NOISE_PERIOD).r;
+}
 
+#define PNOISE(P, rep) pnoise(P)
+#else
 // Perlin noise Functions - https://github.com/ashima/webgl-noise/blob/master/src/classicnoise3D.glsl
 vec3 mod289(vec3 x)
 {
@@ -115,37 +164,65 @@ float pnoise(vec3 P, vec3 rep)
   return 2.2 * n_xyz;
 }
 
+#define PNOISE(P, rep) pnoise(P, rep)
+#endif
+
 float turbulence( vec3 p ) {
-  float w = 100.0;
   float t = -.5;
 
   for (float f = 1.0 ; f <= 10.0 ; f++ ){
     float power = pow( 2.0, f );
-    t += abs( pnoise( vec3( power * p ), vec3( 10.0, 10.0, 10.0 ) ) / power );
+    t += abs( PNOISE( vec3( power * p ), vec3( 10.0, 10.0, 10.0 ) ) / power );
   }
 
   return t;
 }
+#endif
 
 void main()
 {
-	// Compute world space vertex position and normal
-	world_position = (Model * vec4(v_position, 1)).xyz;
-	world_normal = normalize( mat3(Model) * normalize(v_normal));
-
+#ifdef INSTANCED
+	mat4 model = v_model;
+#else
+	mat4 model = Model;
+#endif
+
+	vec3 position = v_position;
+
+#if defined(DISPLACED)
+	position = v_displaced.xyz;
+	#ifdef NOISE
+	noise = v_displaced.w;
+	#endif
+#elif defined(NOISE)
 	float adjustedTime = time / 10;
 	noise = 10.0 *  -.10 * turbulence( .5 * v_normal +  adjustedTime);
 
-	if(is_distorted) {
-		float b = pnoise( 0.05 * v_position + vec3( 2.0 * adjustedTime ), vec3( 100.0 ) );
-		float displacement = noise / 2.5 + b / 12.f;
+	#ifdef DISTORTED
+	float b = PNOISE( 0.05 * v_position + vec3( 2.0 * adjustedTime ), vec3( 100.0 ) );
+	float displacement = noise / 2.5 + b / 12.f;
 
-		// move the position along the normal and transform it
-		vec3 newPosition = v_position + v_normal * displacement;
+	// move the position along the normal
+	position += v_normal * displacement;
+	#endif
+#endif
 
-		gl_Position = Projection * View * Model * vec4(newPosition, 1.0);
-	} else {
-		// Render normally
-		gl_Position = Projection * View * Model * vec4(v_position, 1.0);
-	}
+#ifdef LIT
+	// Compute world space vertex position and normal
+	world_position = (model * vec4(position, 1)).xyz;
+	world_normal = normalize( mat3(model) * normalize(v_normal));
+
+	// The distance along the view axis, picks the depth slice of the light clusters
+	view_depth = -(View * vec4(world_position, 1)).z;
+#endif
+
+#ifdef TEXTURED
+	texture_coord = v_texture_coord;
+#endif
+
+#ifdef UI
+	gl_Position = model * vec4(position, 1.0);
+#else
+	gl_Position = Projection * View * model * vec4(position, 1.0);
+#endif
 }
\ No newline at end of file
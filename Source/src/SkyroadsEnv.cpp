@@ -0,0 +1,273 @@
+#include "SkyroadsEnv.hpp"
+
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+
+#include <Core/Managers/JobSystem.h>
+#include "GameEngine/CollisionManager.hpp"
+
+using namespace Skyroads;
+
+Skyroads::SkyroadsEnv::SkyroadsEnv(size_t count) :
+	games(count),
+	platformColliders(count * Constants::trackPlatforms, GameEngine::Collider(0, glm::vec3(0), GameEngine::ObjectConstants::platformScale)),
+	platforms(count * Constants::trackPlatforms),
+	observations(count * EnvConstants::observationSize),
+	rewards(count),
+	dones(count)
+{
+	Reset(0);
+}
+
+size_t Skyroads::SkyroadsEnv::GetCount() const
+{
+	return games.size();
+}
+
+void Skyroads::SkyroadsEnv::Reset(size_t index, unsigned int seed)
+{
+	Game& game = games[index];
+	game.state = GameState();
+	game.track = TrackPlacer(seed);
+	game.track.Place(game.next);
+
+	// The player starts falling on the first platforms, like in GameManager::Init
+	game.player = GameEngine::RigidBody();
+	game.player.state.x = Constants::playerStartingPosition;
+	game.player.state.gravity_coef = GameEngine::ObjectConstants::playerGravity;
+	game.player.state.drag_coef = Constants::playerDrag;
+	game.isInJump = true;
+
+	rewards[index] = 0;
+	dones[index] = 0;
+	Observe(index);
+}
+
+void Skyroads::SkyroadsEnv::Reset(unsigned int seed)
+{
+	for (size_t i = 0; i < games.size(); i++) {
+		Reset(i, seed + (unsigned int)i);
+	}
+}
+
+void Skyroads::SkyroadsEnv::CopyGame(size_t from, size_t to)
+{
+	if (from == to) return;
+
+	// Flat copies, the platforms that aren't used are copied too
+	games[to] = games[from];
+	std::copy_n(&platformColliders[from * Constants::trackPlatforms], Constants::trackPlatforms, &platformColliders[to * Constants::trackPlatforms]);
+	std::copy_n(&platforms[from * Constants::trackPlatforms], Constants::trackPlatforms, &platforms[to * Constants::trackPlatforms]);
+	std::copy_n(&observations[from * EnvConstants::observationSize], EnvConstants::observationSize, &observations[to * EnvConstants::observationSize]);
+	rewards[to] = rewards[from];
+	dones[to] = dones[from];
+}
+
+void Skyroads::SkyroadsEnv::Step(const unsigned char* actions)
+{
+	JobSystem::ParallelFor(games.size(), EnvConstants::stepGrain, [this, actions](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			if (dones[i]) {
+				rewards[i] = 0;
+				continue;
+			}
+
+			float points = games[i].state.points;
+			dones[i] = !StepGame(i, actions[i]);
+			rewards[i] = games[i].state.points - points;
+			Observe(i);
+		}
+	});
+}
+
+const float* Skyroads::SkyroadsEnv::GetObservations() const
+{
+	return observations.data();
+}
+
+const float* Skyroads::SkyroadsEnv::GetRewards() const
+{
+	return rewards.data();
+}
+
+const unsigned char* Skyroads::SkyroadsEnv::GetDones() const
+{
+	return dones.data();
+}
+
+bool Skyroads::SkyroadsEnv::StepGame(size_t index, unsigned char action)
+{
+	// The same order as GameManager::Simulate: the keys, the game state, the physics, then the collisions
+	Game& game = games[index];
+	GameState& state = game.state;
+	GameEngine::State& body = game.player.state;
+	bool alive = true;
+
+	state.time += EnvConstants::stepTime;
+
+	if (action & EnvActions::SPEED_UP) {
+		GameRules::ChangeSpeed(state, 1);
+	}
+	if (action & EnvActions::SLOW_DOWN) {
+		GameRules::ChangeSpeed(state, -1);
+	}
+	if ((action & EnvActions::JUMP) && !game.isInJump) {
+		game.isInJump = true;
+		body.v.y = Constants::jumpSpeed;
+	}
+
+	// Move the player forward
+	body.x.z -= state.playerState.playerSpeed;
+	if (action & EnvActions::LEFT) {
+		body.v.x = -Constants::lateralSpeed;
+	}
+	else if (action & EnvActions::RIGHT) {
+		body.v.x = Constants::lateralSpeed;
+	}
+
+	// Check if the player has fallen
+	if (body.x.y < Constants::outOfBoundY) {
+		alive = false;
+	}
+
+	GameRules::ComputeScore(state, body.x.z);
+	PlatformManagement(index);
+	alive &= GameRules::UpdateFuel(state, EnvConstants::stepTime);
+	GameRules::UpdateForcedSpeed(state);
+
+	GameEngine::PhysixEngine::integrate(game.player, state.time, EnvConstants::stepTime);
+
+	// The player "sticks" to the platforms it touches, like in GameObject::ManageCollisions
+	size_t base = index * Constants::trackPlatforms;
+	size_t collided[Constants::trackPlatforms];
+	GameEngine::Collider playerCollider(0, body.x, GameEngine::ObjectConstants::playerHeight / 2);
+	size_t collisions = GameEngine::CollisionManager::getCollisions(playerCollider, &platformColliders[base], state.platformCount, collided);
+
+	if (collisions > 0) {
+		body.v.y = 0;
+		body.x.y = GameEngine::ObjectConstants::platformTopHeight + GameEngine::ObjectConstants::playerHeight / 2;
+		game.isInJump = false;
+	}
+
+	for (size_t i = 0; i < collisions; i++) {
+		Platform& platform = platforms[base + collided[i]];
+
+		// The distortion of the player is only drawn
+		double distortedTime = 0;
+		alive &= GameRules::ApplyPlatform(state, platform.color, distortedTime);
+		platform.color = PlatformColor::PURPLE;
+	}
+
+	return alive;
+}
+
+void Skyroads::SkyroadsEnv::PlatformManagement(size_t index)
+{
+	Game& game = games[index];
+	GameState& state = game.state;
+	float playerZ = game.player.state.x.z;
+	size_t base = index * Constants::trackPlatforms;
+
+	// The same platforms as GameManager::PlatformManagement: the track is spawned once it is in sight,
+	// at most Constants::trackPlatforms at once (placed here as they are needed)
+	while (state.platformCount < Constants::trackPlatforms && game.next.position.z + GameEngine::ObjectConstants::platformLength / 2 >= playerZ - Constants::viewDistance) {
+		// Passed while the track was full
+		if (!GameRules::IsPlatformBehind(game.next.position.z, playerZ)) {
+			size_t slot = base + state.platformCount++;
+			platformColliders[slot] = GameEngine::Collider(0, game.next.position, GameEngine::ObjectConstants::platformScale);
+			platforms[slot] = { game.next.color, game.next.lane };
+		}
+
+		game.track.Place(game.next);
+	}
+
+	// Remove the platforms behind the player, the track is placed by Z so they are the first ones
+	int behind = 0;
+	while (behind < state.platformCount && GameRules::IsPlatformBehind(platformColliders[base + behind].getPosition().z, playerZ)) {
+		behind++;
+	}
+
+	if (behind > 0) {
+		state.platformCount -= behind;
+		std::copy_n(&platformColliders[base + behind], state.platformCount, &platformColliders[base]);
+		std::copy_n(&platforms[base + behind], state.platformCount, &platforms[base]);
+	}
+}
+
+void Skyroads::SkyroadsEnv::Observe(size_t index)
+{
+	const Game& game = games[index];
+	const GameState& state = game.state;
+	const GameEngine::State& body = game.player.state;
+	float* observation = &observations[index * EnvConstants::observationSize];
+
+	observation[0] = body.x.x;
+	observation[1] = body.x.y;
+	observation[2] = body.v.x;
+	observation[3] = body.v.y;
+	observation[4] = state.playerState.playerSpeed;
+	observation[5] = state.playerState.fuel / Constants::maxFuel;
+	observation[6] = state.playerState.lives;
+	observation[7] = game.isInJump ? 1.f : 0.f;
+	observation[8] = state.playerState.isFullSpeed ? 1.f : 0.f;
+
+	// The closest platforms of each lane, sorted by the distance to their start
+	float* lanes = observation + EnvConstants::playerValues;
+	for (int i = 0; i < 3 * EnvConstants::observedPlatforms; i++) {
+		lanes[i * EnvConstants::platformValues + 0] = EnvConstants::observationRange;
+		lanes[i * EnvConstants::platformValues + 1] = EnvConstants::observationRange;
+		lanes[i * EnvConstants::platformValues + 2] = -1;
+	}
+
+	size_t base = index * Constants::trackPlatforms;
+	for (int i = 0; i < state.platformCount; i++) {
+		// The player moves towards -Z
+		float start = body.x.z - (platformColliders[base + i].getPosition().z + GameEngine::ObjectConstants::platformLength / 2);
+		float end = start + GameEngine::ObjectConstants::platformLength;
+		if (end < 0 || start >= EnvConstants::observationRange) continue;
+
+		// Insert it in the sorted platforms of its lane
+		float* lane = lanes + platforms[base + i].lane * EnvConstants::observedPlatforms * EnvConstants::platformValues;
+		for (int slot = 0; slot < EnvConstants::observedPlatforms; slot++) {
+			float* values = lane + slot * EnvConstants::platformValues;
+			if (start >= values[0]) continue;
+
+			for (int last = EnvConstants::observedPlatforms - 1; last > slot; last--) {
+				float* to = lane + last * EnvConstants::platformValues;
+				for (int v = 0; v < EnvConstants::platformValues; v++) {
+					to[v] = to[v - EnvConstants::platformValues];
+				}
+			}
+			values[0] = start;
+			values[1] = end;
+			values[2] = (float)platforms[base + i].color;
+			break;
+		}
+	}
+}
+
+void Skyroads::SkyroadsEnv::Benchmark(unsigned int steps)
+{
+	std::vector<unsigned char> actions(games.size());
+	std::minstd_rand random;
+	unsigned int seed = (unsigned int)games.size();
+
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int step = 0; step < steps; step++) {
+		for (auto& action : actions) {
+			action = (unsigned char)(random() & (EnvActions::LEFT | EnvActions::RIGHT | EnvActions::JUMP));
+		}
+
+		Step(actions.data());
+
+		for (size_t i = 0; i < games.size(); i++) {
+			if (dones[i]) Reset(i, seed++);
+		}
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::cout << games.size() << " games, " << steps << " steps in " << seconds << " s ("
+		<< (unsigned long long)(games.size() * steps / seconds) << " steps per second, on "
+		<< JobSystem::GetThreadCount() << " threads)" << std::endl;
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <vector>
+#include <random>
+
+#include "GameRules.hpp"
+#include "TrackGenerator.hpp"
+#include "GameEngine/Colliders.hpp"
+#include "GameEngine/Physics.hpp"
+
+namespace Skyroads {
+	namespace EnvConstants {
+		/// <summary>
+		/// The time of a step, a frame of the game at 60 frames per second
+		/// </summary>
+		const float stepTime = 1.f / 60;
+
+		/// <summary>
+		/// The platforms observed in each lane (the closest ones the player hasn't passed)
+		/// </summary>
+		const int observedPlatforms = 2;
+
+		/// <summary>
+		/// The values observed for the player: position (x, y), velocity (x, y), speed, fuel (0 to 1),
+		/// lives, if it is in a jump and if its speed is forced
+		/// </summary>
+		const int playerValues = 9;
+
+		/// <summary>
+		/// The values observed for each platform: the distance to its start and to its end (ahead of the
+		/// player, the start is negative when the player is over it) and its color (-1 if there is none)
+		/// </summary>
+		const int platformValues = 3;
+
+		/// <summary>
+		/// The number of values in the observation of a game
+		/// </summary>
+		const int observationSize = playerValues + 3 * observedPlatforms * platformValues;
+
+		/// <summary>
+		/// The distance observed for a missing platform
+		/// </summary>
+		const float observationRange = 200.f;
+
+		/// <summary>
+		/// The games stepped by each job
+		/// </summary>
+		const size_t stepGrain = 64;
+
+		/// <summary>
+		/// The steps run by the "--bench-env" option
+		/// </summary>
+		const unsigned int benchmarkSteps = 10000;
+	}
+
+	/// <summary>
+	/// The actions of a step, a mask of the keys held
+	/// </summary>
+	namespace EnvActions {
+		enum : unsigned char {
+			NONE = 0,
+			LEFT = 1 << 0,
+			RIGHT = 1 << 1,
+			JUMP = 1 << 2,
+			SPEED_UP = 1 << 3,
+			SLOW_DOWN = 1 << 4,
+		};
+	}
+
+	/// <summary>
+	/// A batch of independent games without a window (for training agents). They are stepped in
+	/// lock-step, in parallel with the JobSystem (it must be initialized, Engine::Init does it): each
+	/// step takes an action per game, and fills the observations, the rewards (the distance traveled)
+	/// and the end flags, in contiguous arrays indexed by the game.
+	///
+	/// The games follow the rules of the GameManager (GameRules) with a fixed time step, on a compact
+	/// state: the player body, the game state and the platform colliders. Each game places its own
+	/// track (a TrackPlacer), so a game is replayed exactly from its seed, on the same track as the
+	/// GameManager with that seed. Everything is allocated when the batch is created, stepping doesn't
+	/// allocate.
+	/// </summary>
+	class SkyroadsEnv
+	{
+	public:
+		SkyroadsEnv(size_t count);
+
+		/// <summary>
+		/// Get the number of games
+		/// </summary>
+		size_t GetCount() const;
+
+		/// <summary>
+		/// Start a game again, its observation is updated
+		/// </summary>
+		/// <param name="index">The index of the game</param>
+		/// <param name="seed">The seed of its track</param>
+		void Reset(size_t index, unsigned int seed);
+
+		/// <summary>
+		/// Start all the games again, the game "i" is seeded with "seed + i"
+		/// </summary>
+		/// <param name="seed">The seed of the first game</param>
+		void Reset(unsigned int seed);
+
+		/// <summary>
+		/// Copy a game in another one, with its track: both go on the same way with the same
+		/// actions (to try several actions from the same state, for a look-ahead search)
+		/// </summary>
+		/// <param name="from">The index of the copied game</param>
+		/// <param name="to">The index of the game replaced by the copy</param>
+		void CopyGame(size_t from, size_t to);
+
+		/// <summary>
+		/// Step all the games once. The games that ended stay ended (without reward) until they are reset.
+		/// </summary>
+		/// <param name="actions">An EnvActions mask per game</param>
+		void Step(const unsigned char* actions);
+
+		/// <summary>
+		/// Get the observations, EnvConstants::observationSize values per game
+		/// </summary>
+		const float* GetObservations() const;
+
+		/// <summary>
+		/// Get the rewards of the last step, one per game
+		/// </summary>
+		const float* GetRewards() const;
+
+		/// <summary>
+		/// Get the end flags, one per game (1 once the game is over)
+		/// </summary>
+		const unsigned char* GetDones() const;
+
+		/// <summary>
+		/// Step the games with random actions and print the steps per second, the games that end are
+		/// reset. Started with the "--bench-env" argument, instead of running the game.
+		/// </summary>
+		/// <param name="steps">The number of steps</param>
+		void Benchmark(unsigned int steps);
+
+	private:
+		/// <summary>
+		/// What a game keeps between the steps, besides its platforms
+		/// </summary>
+		struct Game {
+			GameState state;
+			GameEngine::RigidBody player;
+			bool isInJump = false;
+
+			/// <summary>
+			/// The track, and its next platform (placed, not spawned yet)
+			/// </summary>
+			TrackPlacer track;
+			TrackPlatform next;
+		};
+
+		/// <summary>
+		/// What the colliders don't store about a platform
+		/// </summary>
+		struct Platform {
+			PlatformColor color;
+			int lane;
+		};
+
+		/// <summary>
+		/// Step a game
+		/// </summary>
+		/// <returns>False if the game is over</returns>
+		bool StepGame(size_t index, unsigned char action);
+
+		/// <summary>
+		/// Spawn/Remove the platforms of a game
+		/// </summary>
+		void PlatformManagement(size_t index);
+
+		/// <summary>
+		/// Fill the observation of a game
+		/// </summary>
+		void Observe(size_t index);
+
+		std::vector<Game> games;
+
+		/// <summary>
+		/// The platforms, Constants::trackPlatforms slots per game (GameState::platformCount are used),
+		/// in the order they were spawned
+		/// </summary>
+		std::vector<GameEngine::Collider> platformColliders;
+		std::vector<Platform> platforms;
+
+		std::vector<float> observations;
+		std::vector<float> rewards;
+		std::vector<unsigned char> dones;
+	};
+}
@@ -0,0 +1,106 @@
+#include "TrackGenerator.hpp"
+
+using namespace Skyroads;
+
+Skyroads::TrackPlacer::TrackPlacer(unsigned int seed) : random(seed)
+{
+	// The middle lane starts the track
+	float startZ = Constants::playerStartingPosition.z;
+	nextSpawns = { startZ, startZ + 1, startZ };
+}
+
+void Skyroads::TrackPlacer::Place(TrackPlatform& platform)
+{
+	int lane = GameRules::ChooseSpawnLane(nextSpawns);
+	float z = nextSpawns[lane];
+
+	platform.position = glm::vec3(Constants::lanesX[lane], GameEngine::ObjectConstants::platformTopHeight - GameEngine::ObjectConstants::platformScale.y / 2, z);
+	platform.color = GameRules::ChoosePlatformColor((int)random());
+	platform.lane = lane;
+
+	nextSpawns[lane] -= GameEngine::ObjectConstants::platformLength + GameRules::ChoosePlatformGap((int)random(), z);
+}
+
+Skyroads::TrackGenerator::TrackGenerator() : seed(0), taken(0), hasNext(false)
+{
+}
+
+Skyroads::TrackGenerator::~TrackGenerator()
+{
+	JobSystem::Wait(&generating);
+}
+
+void Skyroads::TrackGenerator::Start(unsigned int seed)
+{
+	Seek(seed, 0, TrackPlacer(seed));
+}
+
+void Skyroads::TrackGenerator::Seek(unsigned int seed, unsigned long long taken, const TrackPlacer& placer)
+{
+	// Nothing is pushed while the queue is emptied
+	JobSystem::Wait(&generating);
+
+	ReadyPlatform platform;
+	while (ready.Pop(platform));
+	hasNext = false;
+
+	this->seed = seed;
+	this->taken = taken;
+	this->placer = placer;
+	takenPlacer = placer;
+
+	GenerateChunk();
+}
+
+bool Skyroads::TrackGenerator::Next(float farthestZ, TrackPlatform& platform)
+{
+	if (!hasNext) {
+		hasNext = ready.Pop(next);
+		Refill();
+		if (!hasNext) return false;
+	}
+
+	// The track goes towards -Z, the platform is spawned once its start is closer than farthestZ
+	if (next.platform.position.z + GameEngine::ObjectConstants::platformLength / 2 < farthestZ) return false;
+
+	platform = next.platform;
+	takenPlacer = next.placer;
+	hasNext = false;
+	taken++;
+	return true;
+}
+
+unsigned int Skyroads::TrackGenerator::GetSeed() const
+{
+	return seed;
+}
+
+unsigned long long Skyroads::TrackGenerator::GetTaken() const
+{
+	return taken;
+}
+
+const TrackPlacer& Skyroads::TrackGenerator::GetPlacer() const
+{
+	return takenPlacer;
+}
+
+void Skyroads::TrackGenerator::Refill()
+{
+	// The jobs take turns pushing: the next one is only started once the last one is done
+	if (!generating.IsDone() || ready.Size() > TrackConstants::readyPlatforms - TrackConstants::chunkPlatforms) return;
+
+	JobSystem::Run([this]() {
+		GenerateChunk();
+	}, &generating);
+}
+
+void Skyroads::TrackGenerator::GenerateChunk()
+{
+	for (int i = 0; i < TrackConstants::chunkPlatforms && ready.Size() < TrackConstants::readyPlatforms; i++) {
+		ReadyPlatform platform;
+		placer.Place(platform.platform);
+		platform.placer = placer;
+		ready.Push(platform);
+	}
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <array>
+#include <random>
+
+#include <Core/Managers/JobSystem.h>
+#include <include/spsc_queue.h>
+#include "GameRules.hpp"
+
+namespace Skyroads {
+	namespace TrackConstants {
+		/// <summary>
+		/// The platforms placed by a job
+		/// </summary>
+		const int chunkPlatforms = 32;
+
+		/// <summary>
+		/// The platforms ready ahead of the player (a power of 2), a chunk is generated once there is room for it
+		/// </summary>
+		const size_t readyPlatforms = 128;
+	}
+
+	/// <summary>
+	/// A platform of the track
+	/// </summary>
+	struct TrackPlatform {
+		glm::vec3 position;
+		PlatformColor color;
+		int lane;
+	};
+
+	/// <summary>
+	/// Places the platforms of a track with the GameRules (the lane, the color and the gap after it),
+	/// in the order the track goes (by decreasing Z). The track only depends on the seed: the game
+	/// (TrackGenerator) and the headless games (SkyroadsEnv) place the same track from the same seed.
+	/// </summary>
+	struct TrackPlacer {
+		/// <summary>
+		/// Start placing a track
+		/// </summary>
+		/// <param name="seed">The seed of the track</param>
+		TrackPlacer(unsigned int seed = std::minstd_rand::default_seed);
+
+		/// <summary>
+		/// Place the next platform
+		/// </summary>
+		void Place(TrackPlatform& platform);
+
+		/// <summary>
+		/// The random numbers of the track and the Z of the next platform of each lane
+		/// </summary>
+		std::minstd_rand random;
+		std::array<float, 3> nextSpawns;
+	};
+
+	/// <summary>
+	/// Generates the track ahead of the player, in chunks of platforms placed by jobs on the workers
+	/// (with a TrackPlacer), and hands them to the main thread through a lock-free queue: spawning
+	/// them is only a pop, any number of them per frame.
+	///
+	/// Each platform is queued with the placement after it, so the generator knows the placement
+	/// after the last platform taken: a snapshot of the game keeps it, and the track goes on from it
+	/// when the snapshot is restored, without placing the platforms before it again.
+	/// </summary>
+	class TrackGenerator
+	{
+	public:
+		TrackGenerator();
+		~TrackGenerator();
+
+		/// <summary>
+		/// Start a track. The first chunk is placed right away, so the start of the track is ready.
+		/// </summary>
+		/// <param name="seed">The seed of the track</param>
+		void Start(unsigned int seed);
+
+		/// <summary>
+		/// Go back/forward in a track, to the placement after a platform taken from it (GetPlacer)
+		/// </summary>
+		/// <param name="seed">The seed of the track</param>
+		/// <param name="taken">The platforms taken from it</param>
+		/// <param name="placer">The placement after the last platform taken</param>
+		void Seek(unsigned int seed, unsigned long long taken, const TrackPlacer& placer);
+
+		/// <summary>
+		/// Take the next platform of the track, if it starts in front of a Z. Main thread only.
+		/// </summary>
+		/// <param name="farthestZ">The farthest Z spawned (the track goes towards -Z)</param>
+		/// <param name="platform">Set to the platform</param>
+		/// <returns>False if the next platform is farther, or isn't generated yet</returns>
+		bool Next(float farthestZ, TrackPlatform& platform);
+
+		/// <summary>
+		/// Get the seed of the track
+		/// </summary>
+		unsigned int GetSeed() const;
+
+		/// <summary>
+		/// Get the number of platforms taken from the track
+		/// </summary>
+		unsigned long long GetTaken() const;
+
+		/// <summary>
+		/// Get the placement after the last platform taken
+		/// </summary>
+		const TrackPlacer& GetPlacer() const;
+
+	private:
+		/// <summary>
+		/// A platform placed ahead, with the placement after it
+		/// </summary>
+		struct ReadyPlatform {
+			TrackPlatform platform;
+			TrackPlacer placer;
+		};
+
+		/// <summary>
+		/// Generate a chunk in a job, if there is room for it and none is running
+		/// </summary>
+		void Refill();
+
+		/// <summary>
+		/// Place the next platforms and queue them, on the thread of the job
+		/// </summary>
+		void GenerateChunk();
+
+		/// <summary>
+		/// The placement, used by one job at a time (or by the main thread when none is running)
+		/// </summary>
+		TrackPlacer placer;
+
+		/// <summary>
+		/// Pushed by the jobs (one at a time), popped by the main thread
+		/// </summary>
+		SPSCQueue<ReadyPlatform, TrackConstants::readyPlatforms> ready;
+		JobCounter generating;
+
+		/// <summary>
+		/// The main thread side: the track, the platforms taken (and the placement after them) and the
+		/// next one (popped but not taken yet)
+		/// </summary>
+		unsigned int seed;
+		unsigned long long taken;
+		TrackPlacer takenPlacer;
+		ReadyPlatform next;
+		bool hasNext;
+	};
+}